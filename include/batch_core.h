@@ -0,0 +1,445 @@
+#ifndef _BATCH_CORE_H
+#define _BATCH_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "nsat_core.h"
+#include "ckpt_core.h"
+#include "rng_core.h"
+#include "schedule_core.h"
+
+
+using namespace std;
+
+
+/***************************************************************************
+ * CSR_ARRAY Class - A read-only array that either owns its data (built in
+ * memory) or views data mapped from a network image (see 
+ * BATCH_CORE::COMPILE). Mapped data is never copied, so the pages of an
+ * image are shared by all the processes that load it.
+ ***************************************************************************/
+template<typename T>
+class csr_array {
+    private:
+        vector<T> own;
+        const T *ptr;
+        size_t n;
+
+    public:
+        csr_array() : ptr(NULL), n(0) {}
+        csr_array(const csr_array &o) { *this = o; }
+        csr_array &operator=(const csr_array &o) {
+            own = o.own;
+            ptr = (o.ptr == o.own.data()) ? own.data() : o.ptr;
+            n = o.n;
+            return *this;
+        }
+
+        void set(const vector<T> &v) { own = v; ptr = own.data(); n = v.size(); }
+        void map(const T *p, size_t count) { own.clear(); ptr = p; n = count; }
+
+        const T &operator[](size_t i) const { return ptr[i]; }
+        const T *data() const { return ptr; }
+        const T *begin() const { return ptr; }
+        const T *end() const { return ptr + n; }
+        size_t size() const { return n; }
+        bool empty() const { return n == 0; }
+};
+
+
+/* ----------------------------------
+ * Shared (CSR) projection struct
+ * ----------------------------------*/
+typedef struct csr_projection_s {
+    int src_grp;            // source group (inputs first, then NSAT groups)
+    int dest_grp;           // destination group
+    int src_start;          // first (global) neuron id of the source group
+    int dest_start;         // first (global) neuron id of the destination group
+    int num_pre;            // number of presynaptic neurons
+    int num_post;           // number of postsynaptic neurons
+    float sign;             // -1 for inhibitory sources, +1 otherwise
+    float prob;             // blankout probability
+    csr_array<int> row_ptr; // synapses of pre neuron i: [row_ptr[i], row_ptr[i+1])
+    csr_array<int> col_idx; // postsynaptic neuron (local, internal id) of each synapse
+    vector<float> wt;       // synaptic weight of each synapse
+    csr_array<float> pdrop; // per-synapse blankout probability (prob, std)
+    csr_array<float> row_lq;    // log(1 - q), q: skip sampling rate of each row
+    csr_array<float> row_q;     // skip sampling rate q of each row
+    csr_array<unsigned char> row_drop;  // 1: the row samples drops, 0: keeps
+    csr_array<float> row_psum;  // sum of the blankout probabilities of each row
+    csr_array<float> row_pvar;  // sum of pd * (1 - pd) of each row
+
+    // STDP (plastic projections only)
+    bool plastic;           // true if the destination group has STDP on
+    float a_pre, a_post;    // weight change per pre/post spike (x trace)
+    float tau_pre, tau_post;    // pre/post traces time constants (ms)
+    vector<int> col_ptr;    // synapses onto post neuron j: [col_ptr[j], col_ptr[j+1])
+    vector<int> col_syn;    // synapse (CSR index) of each column entry
+    vector<int> syn_pre;    // presynaptic neuron (local id) of each synapse
+    vector<float> wt_b;     // per-instance weights [synapse][batch]
+    vector<float> x_pre, x_post;    // pre/post traces [neuron][batch]
+    vector<int> t_pre, t_post;      // last update step of each trace
+} csr_projection;
+
+
+/* ----------------------------------
+ * Blankout statistics struct
+ * ----------------------------------*/
+typedef struct blankout_stats_s {
+    double events;          // synaptic events (spikes x fan-out)
+    double dropped;         // blanked out events
+    double mean;            // expected number of blanked out events
+    double var;             // variance of the number of blanked out events
+} blankout_stats;
+
+
+/* ----------------------------------
+ * Activity counters struct (per group)
+ * ----------------------------------*/
+typedef struct activity_counters_s {
+    int64_t spikes;         // spikes emitted (all instances)
+    int64_t events;         // synaptic events delivered onto the group
+    int64_t dropped;        // synaptic events onto the group blanked out
+    int64_t stdp_updates;   // STDP updates of the group's incoming weights
+} activity_counters;
+
+
+/* STDP update modes of the batch */
+#define STDP_OFF 0
+#define STDP_EAGER 1
+#define STDP_LAZY 2
+
+
+/***************************************************************************
+ * BATCH_CORE Class - This class simulates B instances of the same NSAT
+ * network in lockstep. All the instances share one read-only connectivity
+ * structure (CSR projections), while the neurons state is laid out as
+ * [neuron][batch]. This way each synaptic weight that is fetched from
+ * memory is used by all the B instances. Instances differ only in their
+ * random seeds (Poisson inputs, noise and blankout). Random numbers are
+ * counter-based (see rng_core.h), keyed by (seed, group, neuron or 
+ * synapse, step), so an instance gives the same results for any batch
+ * size.
+ *
+ * The NSAT neurons are updated (once per ms) according to:
+ *      Isyn[t+1] = alphaS * Isyn[t] + sum_j w_ij s_j[t]
+ *      V[t+1]    = alpha * V[t] + beta * Isyn[t+1] + b + sigma * N(0, 1)
+ * and a spike is emitted when V[t+1] >= v_th. Then V is set to v_reset
+ * and the neuron stays refractory (V = v_reset) for tau_ref steps. All
+ * synaptic delays are 1 ms (as in Connx::connect).
+ *
+ * Blanked out synaptic events are skip sampled: along the fan-out of a
+ * spike, the distance to the next candidate synapse is drawn from a 
+ * geometric distribution, where candidates are drops if they are rarer
+ * than the kept synapses (and keeps otherwise). With per-synapse 
+ * probabilities (prob, std) the candidate rate q is the row's highest
+ * drop (or keep) probability and candidates are thinned by p / q. So a
+ * spike costs about fan-out * min(p, 1 - p) random numbers instead of
+ * one per synapse. The per-synapse draws are kept as a reference (see
+ * SET_SKIP_BLANKOUT).
+ *
+ * STDP (exponential curves, see nsat_core.h) is optional. Plastic
+ * projections keep per-instance weights and one pre/post trace per
+ * neuron and instance. In lazy mode (STDP_LAZY) the traces decay
+ * analytically, exp(-dt/tau), and are only touched when their neuron
+ * spikes: a presynaptic spike depresses its outgoing synapses by
+ * a_pre * x_post and a postsynaptic spike potentiates its incoming
+ * synapses by a_post * x_pre, so the cost scales with the number of
+ * spikes. The eager mode (STDP_EAGER) decays all the traces and visits
+ * all the synapses at every step; it is kept as a reference.
+ *
+ * Each NSAT group is updated by a kernel specialized (at compile time)
+ * on which terms it needs: noise (sigma != 0), bias (b != 0) and 
+ * refractory period (tau_ref > 0). The kernels are selected from the
+ * groups' parameters at setup and whenever a parameter changes.
+ *
+ * A set up batch can be compiled to a network image (see COMPILE): the
+ * groups parameters (SoA), the CSR projections, the inputs and the STDP
+ * configuration, in page-aligned sections of a ckpt_core file. A batch
+ * loaded from an image maps it and views its read-only arrays in place
+ * (see csr_array), so it starts without parsing any parameters file and
+ * all the processes that load the same image share its pages.
+ *
+ * The neurons of each NSAT group can be reordered at setup (see 
+ * SET_REORDER) so that the fan-outs of the projections touch clustered
+ * state: a reverse Cuthill-McKee ordering of all the projections (as one
+ * undirected graph) ranks the neurons, and each group keeps its range of
+ * ids but sorts its neurons by rank. The state arrays and the CSR 
+ * columns use these internal ids, while the CSR rows, the synapses and
+ * the random numbers keep the original ones, so a reordered batch gives
+ * the same spikes and weights, and its spike files and weights are in
+ * the original ids. Images and checkpoints store the order.
+ *
+ * A batch can also simulate a part of the network (see SET_PARTITION
+ * and dist_core.h): only the NSAT groups it owns are updated and 
+ * written, and only the projections onto them are built. Input groups
+ * are generated by all the parts (they are cheap and counter-based), 
+ * but recorded only by part 0.
+ *
+ * Attributes:
+ *      - batch_size : Number of instances simulated in lockstep.
+ *      - num_neurons : Total number of neurons (input and NSAT).
+ *      - num_steps : Number of simulation steps (ms) per run.
+ *      - sim_step : Current simulation step (ms since the start).
+ *      - carl_p, sim_p : CARLsim and simulation parameters structs.
+ *      - inpc, nsatc : Input and NSAT cores structs.
+ *      - spike_trains : User-defined spike trains (vectorial input).
+ *      - input_rates : Rate (Hz) of each Poisson input neuron, [group][neuron].
+ *      - input_sched : Input spikes of the current run (all input types
+ *                      but poisson), ids n*B+b.
+ *      - grp_start : First global neuron id of each group (inputs first).
+ *      - reorder : If true the NSAT groups are reordered at setup.
+ *      - perm, orig : Internal id of each (original) neuron and original
+ *                     id of each internal one (identity unless reordered).
+ *      - connx : Shared CSR projections.
+ *      - init_weights : Weights of each projection right after the setup.
+ *      - seeds : Random seed of each instance.
+ *      - rng_seeds : Random seed of each instance (counter-based draws).
+ *      - draws : Random numbers of all the instances (scratch).
+ *      - v, isyn, isyn_in, ref : Neurons state, [neuron][batch].
+ *      - spk, spk_prev : Spikes of current and previous step,
+ *                        [neuron][batch].
+ *      - spk_any : Number of instances in which a neuron spiked (previous
+ *                  step) - used to skip silent presynaptic neurons.
+ *      - kernels : Update kernel of each NSAT group.
+ *      - generic_kernels : If true all groups use the generic kernel.
+ *      - skip_blankout : If false blankout draws one number per synapse.
+ *      - blk_stats : Blankout statistics since the last reset.
+ *      - stdp_mode : STDP_OFF, STDP_EAGER or STDP_LAZY.
+ *      - stdpc : STDP parameters (see nsat_core::read_stdp).
+ *      - records : Recorded (time, neuron id) spike pairs for each
+ *                  instance and monitored group.
+ *      - results_dir : Directory where the spike files are written.
+ *      - image : Mapped network image (batches loaded from an image).
+ *      - from_image : True if the batch was loaded from an image.
+ *      - grp_owner : Part that owns each group (empty: all groups).
+ *      - part_id : Part simulated by this batch.
+ *      - counters : Activity counters of each group since the last reset
+ *                   (updated by the simulating thread only).
+ *      - shared_counters : Copy of counters published at every step
+ *                   boundary (4 per group, see get_counters), readable
+ *                   from other threads during a run. Allocated once.
+ *      - cur_step : Last completed step + 1.
+ *      - run_step0, run_wall0, run_wall1 : First step, start and end wall
+ *                   time of the current/last run (-1: still running).
+ *                   They are atomic, as they are read by get_sim_rate
+ *                   during a run.
+ *      - series_fp, series_period : Time series file of the counters and
+ *                   its sampling period (steps).
+ *      - series_last, series_wall : Counters and wall time of the last
+ *                   sample.
+ *      - log, log_file : Error log stream of the batch (standard output
+ *                        by default, see set_log_file).
+ *      - last_error : Code of the last exception reported (0: none).
+ *
+ * Methods:
+ *              Construction/Destruction
+ *              ------------------------
+ *      - batch_core : BATCH Core constructor (from a NSAT Core or from a
+ *                     network image).
+ *      - ~batch_core : BATCH Core destructor.
+ *
+ *              Auxiliary Methods
+ *              -----------------
+ *      - set_seeds : Overrides the random seed of each instance.
+ *      - set_results_dir : Sets the spike files directory.
+ *      - set_log_file : Sends the error log of the batch to a file.
+ *      - error : Reports an exception to the log and keeps it.
+ *      - get_last_error : Code of the last exception reported.
+ *      - set_partition : Restricts the batch to the groups of one part.
+ *      - is_local : Checks if a group belongs to this batch's part.
+ *      - initialize_groups : Assigns global neuron ids to groups.
+ *      - set_reorder : Turns the locality reordering of neurons off/on.
+ *      - initialize_order : Computes the internal order of the neurons.
+ *      - get_fanout_lines : Mean cache lines touched by a fan-out.
+ *      - initialize_connexions : Builds the shared CSR projections.
+ *      - initialize_state : Allocates and resets the neurons state.
+ *      - build_schedule : Merges the input spikes of a run.
+ *      - generate_inputs : Emits input neurons spikes of a step.
+ *      - deliver_spikes : Accumulates synaptic inputs of a step.
+ *      - deliver_projections : Accumulates the inputs of some projections.
+ *      - deliver_skip : Delivers a blanked out spike (skip sampling).
+ *      - set_skip_blankout : Turns the skip sampling off/on.
+ *      - get_blankout_stats : Returns the blankout statistics.
+ *      - update_neurons : Updates NSAT neurons of a step.
+ *      - update_group : Update kernel of a NSAT group (template).
+ *      - select_kernels : Selects the update kernel of each NSAT group.
+ *      - set_generic_kernels : Turns the specialized kernels off/on.
+ *      - set_stdp_mode : Turns STDP off or selects its update mode.
+ *      - initialize_stdp : Sets up the plastic projections.
+ *      - update_stdp : Applies the STDP updates of a step.
+ *      - lazy_stdp, eager_stdp : Lazy and eager STDP updates (return the
+ *                                number of weight updates).
+ *      - get_weights : Returns the weights of a projection (one instance).
+ *      - record_spikes : Records spikes of monitored groups.
+ *      - write_spikes : Writes one spike file per instance and group.
+ *      - start_counting, stop_counting : Mark a run for the speed.
+ *      - count_step : Closes a step for the counters (and samples them).
+ *      - initialize_counters : Allocates the counters (once).
+ *      - publish_counters : Publishes the counters to other threads.
+ *      - sample_counters : Appends a sample to the time series file.
+ *      - set_counters_file : Starts/stops the counters time series.
+ *      - get_counters : Returns the last published activity counters.
+ *      - get_sim_rate : Simulated ms per wall second of the run.
+ *      - compile : Writes the set up network to an image file.
+ *      - checkpoint : Writes the full state of all instances to a file.
+ *      - restore : Restores a checkpoint written by checkpoint.
+ *      - set_input_rates : Sets the per-neuron rates of a Poisson group.
+ *      - set_input_vector : Swaps the spike train of a vectorial group.
+ *      - reset_state : Resets all the instances for a new trial.
+ *      - set_nsat_param : Changes a NSAT parameter of a group in place.
+ *      - set_weights : Replaces the weights of a projection in place.
+ *
+ *              Core Methods
+ *              ------------
+ *      - b_setup_state : Builds the batched network.
+ *      - b_run_state : Simulates all the instances in lockstep.
+ *
+ ***************************************************************************/
+class batch_core {
+    private:
+        int batch_size;
+        int num_neurons;
+        int num_steps;
+        int sim_step;
+
+        carlsim carl_p;
+        simulation sim_p;
+        string input_type;
+
+        vector<input_unit> inpc;
+        vector<nsat_unit> nsatc;
+        vector<projection> projs;
+        vector<vector<int>> spike_trains;
+        vector<vector<float>> input_rates;
+        spike_schedule input_sched;
+
+        // Network attributes
+        vector<int> grp_start;
+        bool reorder;
+        vector<int> perm, orig;
+        vector<csr_projection> connx;
+        vector<vector<float>> init_weights;
+
+        // Random engines attributes
+        vector<int> seeds;
+        vector<uint32_t> rng_seeds;
+        vector<float> draws;
+
+        // Neurons state attributes [neuron][batch]
+        vector<float> v, isyn, isyn_in;
+        vector<int> ref;
+        vector<unsigned char> spk, spk_prev;
+        vector<int> spk_any;
+
+        // NSAT update kernels
+        typedef void (batch_core::*nsat_kernel)(int, int);
+        vector<nsat_kernel> kernels;
+        bool generic_kernels;
+
+        // Blankout attributes
+        bool skip_blankout;
+        blankout_stats blk_stats;
+
+        // STDP attributes
+        int stdp_mode;
+        vector<stdp_unit> stdpc;
+
+        // Output attributes
+        vector<vector<int>> records;
+        string results_dir;
+
+        // Network image attributes
+        ckpt_core image;
+        bool from_image;
+
+        // Partition attributes
+        vector<int> grp_owner;
+        int part_id;
+
+        // Activity counters attributes
+        vector<activity_counters> counters;
+        vector<atomic<int64_t>> shared_counters;
+        atomic<int> cur_step, run_step0;
+        atomic<double> run_wall0, run_wall1;
+        FILE *series_fp;
+        int series_period;
+        vector<activity_counters> series_last;
+        double series_wall;
+
+        // Error reporting attributes
+        ostream *log;
+        ofstream log_file;
+        int last_error;
+
+        friend class dist_core;
+
+    public:
+        // BATCH Class constructor and destructor
+        batch_core(nsat_core *, int);       // Constructor
+        batch_core(const string &, int);    // Constructor (network image)
+        ~batch_core();                      // Destructor
+
+        // BATCH Class auxiliary methods
+        void set_seeds(const vector<int> &);
+        void set_results_dir(const string &);
+        void set_log_file(const string &);
+        int error(int);
+        int get_last_error() const { return last_error; }
+        void set_partition(const vector<int> &, int);
+        bool is_local(int g) const {
+            return grp_owner.empty() || grp_owner[g] == part_id;
+        }
+        int initialize_groups();
+        void set_reorder(bool);
+        void initialize_order();
+        double get_fanout_lines() const;
+        int initialize_connexions();
+        int initialize_state();
+        void build_schedule();
+        void generate_inputs(int);
+        void deliver_spikes(int);
+        void deliver_projections(int, int, int);
+        void deliver_skip(int, int, int);
+        void set_skip_blankout(bool);
+        const blankout_stats &get_blankout_stats() const { return blk_stats; }
+        void update_neurons(int);
+        template<bool NOISE, bool BIAS, bool REFRAC>
+        void update_group(int, int);
+        void select_kernels();
+        void set_generic_kernels(bool);
+        void set_stdp_mode(int);
+        void initialize_stdp();
+        void update_stdp(int);
+        int64_t lazy_stdp(csr_projection &, int);
+        int64_t eager_stdp(csr_projection &, int);
+        vector<float> get_weights(int, int);
+        void record_spikes(int);
+        int write_spikes();
+        void start_counting();
+        void stop_counting();
+        void count_step(int);
+        void initialize_counters();
+        void publish_counters();
+        void sample_counters();
+        int set_counters_file(const string &, int);
+        vector<activity_counters> get_counters() const;
+        double get_sim_rate() const;
+        int compile(const string &);
+        int checkpoint(const string &);
+        int restore(const string &);
+        void set_input_rates(int, const vector<float> &);
+        void set_input_vector(int, const vector<int> &);
+        int reset_state(bool);
+        void set_nsat_param(const string &, const string &, float);
+        void set_weights(int, const vector<float> &);
+
+        // BATCH Class core methods
+        int b_setup_state();
+        int b_run_state();
+};
+
+#endif // _BATCH_CORE_H
@@ -0,0 +1,111 @@
+#ifndef _CKPT_CORE_H
+#define _CKPT_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+using namespace std;
+
+
+#define CKPT_MAGIC "NSATCKPT"
+#define CKPT_VERSION 1
+#define CKPT_ALIGN 4096
+
+
+/* ----------------------------------
+ * Checkpoint file header struct
+ * ----------------------------------*/
+typedef struct ckpt_header_s {
+    char magic[8];          // "NSATCKPT"
+    uint32_t version;       // file format version
+    uint32_t num_sections;  // number of sections
+} ckpt_header;
+
+
+/* ----------------------------------
+ * Checkpoint section struct
+ * ----------------------------------*/
+typedef struct ckpt_section_s {
+    char name[24];          // section's name
+    uint32_t elem_size;     // size of one element (bytes)
+    uint32_t reserved;
+    uint64_t offset;        // offset of the data from the file start
+    uint64_t count;         // number of elements
+} ckpt_section;
+
+
+/***************************************************************************
+ * CKPT Class - This class writes and reads versioned binary checkpoint
+ * files. A file starts with a header and a table of named sections, and
+ * every section's data is aligned to CKPT_ALIGN (a page). Files are
+ * written with pwrite (errors such as a full disk are reported) and read
+ * through mmap, so large arrays (weights, neurons state) are copied
+ * straight from the page cache.
+ *
+ * Attributes:
+ *      - sections : Sections table.
+ *      - data : Pointers to the sections' data (writing).
+ *      - fd, map, map_size : The mapped file (reading).
+ *
+ * Methods:
+ *      - ckpt_core : CKPT constructor.
+ *      - ~ckpt_core : CKPT destructor (unmaps the file).
+ *      - add : Adds a section to be written.
+ *      - write : Writes all the added sections to a file.
+ *      - open : Maps a checkpoint file and reads its sections table.
+ *      - find : Returns a pointer to a section's data.
+ *      - has : Checks if the file has a section.
+ *      - view : Returns a typed pointer to a section's (mapped) data.
+ *      - get : Copies a section into a vector.
+ *      - close : Unmaps the file.
+ *
+ ***************************************************************************/
+class ckpt_core {
+    private:
+        vector<ckpt_section> sections;
+        vector<const void *> data;
+
+        int fd;
+        void *map;
+        size_t map_size;
+
+    public:
+        ckpt_core();
+        ~ckpt_core();
+
+        void add(const string &, const void *, size_t, size_t);
+        int write(const string &);
+        int open(const string &);
+        const void *find(const string &, size_t, size_t &);
+        bool has(const string &) const;
+        void close();
+
+        template<typename T>
+        void add(const string &name, const vector<T> &v) {
+            add(name, v.data(), sizeof(T), v.size());
+        }
+
+        template<typename T>
+        const T *view(const string &name, size_t &count) {
+            return (const T *) find(name, sizeof(T), count);
+        }
+
+        template<typename T>
+        void get(const string &name, vector<T> &v) {
+            size_t count;
+            const T *ptr = (const T *) find(name, sizeof(T), count);
+            v.assign(ptr, ptr + count);
+        }
+};
+
+#endif // _CKPT_CORE_H
@@ -0,0 +1,78 @@
+#ifndef _CONFIG_CORE_H
+#define _CONFIG_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "nsat_core.h"
+
+
+using namespace std;
+
+
+/***************************************************************************
+ * CONFIG Class - This class reads a base configuration file and fills the
+ * carlsim, simulation and filenames structs that NSAT Core expects. It
+ * owns all the strings the structs point to, so it has to outlive any
+ * NSAT Core built from it.
+ *
+ * Each line of the file holds a key followed by its value(s). Lines
+ * starting with # are comments. The conn_fname and finp_spikes keys can
+ * be repeated (one per connection/input group), e.g.
+ *
+ *      # key           value
+ *      sim_name        simple_net
+ *      mode            cpu
+ *      random_seed     42
+ *      sim_time_sec    1
+ *      input_type      poisson
+ *      spkg_fname      params/simple_net/spkg_params.dat
+ *      nsat_fname      params/simple_net/nsat_params.dat
+ *      stdp_fname      params/simple_net/stdp_params.dat
+ *      delay_fname     params/simple_net/delay_params.dat
+ *      conn_fname      params/simple_net/inp_exc.dat
+ *      conn_fname      params/simple_net/exc_inh.dat
+ *
+ * Attributes:
+ *      - carl_p, sim_p, fnames : The filled structs.
+ *      - sim_name, input_type, *_fname : Storage of the
+ *                       structs' strings.
+ *      - conns, finps : Storage of the connections and input spikes
+ *                       files names.
+ *      - conn_ptrs, finp_ptrs : char* arrays for the filenames struct.
+ *
+ * Methods:
+ *      - config_core : CONFIG constructors (set defaults / copy).
+ *      - load : Reads a configuration file.
+ *      - sync : Points the structs' strings to the owned storage.
+ *      - get_carlsim, get_simulation, get_filenames : Struct pointers.
+ *
+ ***************************************************************************/
+class config_core {
+    private:
+        carlsim carl_p;
+        simulation sim_p;
+        filenames fnames;
+
+        string sim_name, input_type;
+        string spkg_fname, nsat_fname, stdp_fname, delay_fname;
+        vector<string> conns, finps;
+        vector<char *> conn_ptrs, finp_ptrs;
+
+        void sync();
+
+    public:
+        config_core();
+        config_core(const config_core &);
+        config_core &operator=(const config_core &);
+
+        int load(const string &);
+
+        carlsim *get_carlsim() { return &carl_p; }
+        simulation *get_simulation() { return &sim_p; }
+        filenames *get_filenames() { return &fnames; }
+};
+
+#endif // _CONFIG_CORE_H
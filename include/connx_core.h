@@ -6,6 +6,8 @@
 
 #include <carlsim.h>
 
+#include "memory_core.h"
+
 
 using namespace std;
 
@@ -35,6 +37,8 @@ using namespace std;
  *      - setDelayMatrix  : Initializes the synaptic delays.
  *      - connect         : Connects pre- and post-synaptic neurons
  *                          according to some logical relation. 
+ *      - get_bytes       : Memory of the weights and delays matrices.
+ *      - get_weight_matrix : Weights the synapses are built from.
  *
  ***************************************************************************/
 class Connx : public ConnectionGenerator {
@@ -50,6 +54,8 @@ class Connx : public ConnectionGenerator {
         void setWeightMatrix(vector<vector<float>>);
         void setDelayMatrix(vector<vector<float>>);
         void connect(CARLsim *, int, int, int, int, float&, float&, float&, bool&);
+        int64_t get_bytes() const { return mem_bytes(_wt) + mem_bytes(_dlt); }
+        const vector<vector<float>> &get_weight_matrix() const { return _wt; }
 };
 
 #endif // _CONNX_CORE_H
@@ -0,0 +1,90 @@
+#ifndef _DIST_CORE_H
+#define _DIST_CORE_H
+
+#ifdef NSAT_MPI
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <mpi.h>
+
+#include "nsat_core.h"
+#include "batch_core.h"
+
+
+using namespace std;
+
+
+/***************************************************************************
+ * DIST Class - This class runs a batch (see batch_core.h) distributed
+ * over the ranks of an MPI communicator. The NSAT groups are split among
+ * the ranks, balanced by their cost (neurons plus incoming synapses,
+ * largest groups first, each to the least loaded rank), and every rank
+ * builds only the projections onto its own groups. Input groups are
+ * generated by all the ranks.
+ *
+ * All the synaptic delays of a batch are 1 ms, hence the minimum delay
+ * window is one step: after each step every rank sends the spikes of its
+ * groups to all the others in one aggregated message, compressed as
+ * delta-encoded varints of the sorted ids n*B+b. The exchange runs in
+ * the background while the next step generates the inputs and delivers
+ * the projections whose sources are local (or inputs). Projections are
+ * delivered in the same order as in a single process and all the random
+ * numbers are counter-based, so the spike files are identical to the
+ * ones of a single-process batch.
+ *
+ * Attributes:
+ *      - batch : The distributed batch (owned by the caller).
+ *      - comm : MPI communicator.
+ *      - rank, num_ranks : Rank of this process and number of ranks.
+ *      - owner : Rank of each group (input groups first, rank 0).
+ *      - first_remote : First projection whose source is on another rank.
+ *      - send_buf, recv_buf : Compressed spikes (outgoing/all ranks).
+ *      - recv_counts, recv_displs : Size and offset of each rank's spikes.
+ *      - request : Pending exchange.
+ *      - pending : True while an exchange is in flight.
+ *
+ * Methods:
+ *      - dist_core : DIST constructor (partitions the network).
+ *      - partition : Assigns the NSAT groups to the ranks.
+ *      - get_owner : Returns the rank of each group.
+ *      - pack_spikes : Compresses the spikes of the local groups.
+ *      - start_exchange : Starts the spikes exchange of a step.
+ *      - finish_exchange : Waits for the exchange and unpacks the spikes.
+ *      - d_setup_state : Builds the local part of the batch.
+ *      - d_run_state : Simulates the distributed batch.
+ *
+ ***************************************************************************/
+class dist_core {
+    private:
+        batch_core *batch;
+        MPI_Comm comm;
+        int rank;
+        int num_ranks;
+
+        vector<int> owner;
+        int first_remote;
+
+        vector<unsigned char> send_buf, recv_buf;
+        vector<int> recv_counts, recv_displs;
+        MPI_Request request;
+        bool pending;
+
+    public:
+        dist_core(batch_core *, MPI_Comm);
+
+        void partition();
+        const vector<int> &get_owner() const { return owner; }
+        void pack_spikes();
+        void start_exchange();
+        void finish_exchange(vector<unsigned char> &);
+
+        int d_setup_state();
+        int d_run_state();
+};
+
+#endif // NSAT_MPI
+
+#endif // _DIST_CORE_H
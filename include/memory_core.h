@@ -0,0 +1,118 @@
+#ifndef _MEMORY_CORE_H
+#define _MEMORY_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Memory accounting entry struct
+ * ----------------------------------*/
+typedef struct mem_entry_s {
+    string subsystem;       // weights, connx, inputs, monitors, carlsim
+    string name;            // owner within the subsystem (e.g. connection)
+    int64_t bytes;          // bytes owned (capacity, not size)
+} mem_entry;
+
+
+/***************************************************************************
+ * Bytes owned by a vector (and by the vectors it holds).
+ ***************************************************************************/
+template <typename T>
+int64_t mem_bytes(const vector<T> &v) {
+    return v.capacity() * sizeof(T);
+}
+
+template <typename T>
+int64_t mem_bytes(const vector<vector<T>> &v) {
+    int64_t n = v.capacity() * sizeof(vector<T>);
+    for (auto &row : v) n += mem_bytes(row);
+    return n;
+}
+
+
+/***************************************************************************
+ * MEMORY Class - This class accounts the memory owned by the subsystems
+ * of a simulation: the parsed weights of every connection, their copies
+ * in the connection generators (weights and delays), the inputs (spike
+ * trains, rates, calendar), the monitors and the growth of the resident
+ * set over the CARLsim calls (its internal arrays). Every entry is set to
+ * the current size of its owner, so the totals are the live memory.
+ *
+ * A budget (bytes, 0: none) turns the accounting into a guard: RESERVE
+ * is called before a structure is allocated and fails if the resident
+ * set plus the new bytes (or the accounted total) would exceed the
+ * budget, and CHECK fails if the resident set already does. Both print
+ * the breakdown and throw 28, so a run stops with a report instead of
+ * being killed by the OOM killer.
+ *
+ * The resident set size (RSS) and its high-water mark are read from
+ * /proc/self/status (0 where it does not exist), SAMPLE reads both in
+ * one pass. The high-water mark can be reset (/proc/self/clear_refs),
+ * but it is process-wide, so the timer never does it (that would change
+ * the peaks seen by every other instance and phase).
+ *
+ * Attributes:
+ *      - budget : Memory budget (bytes, 0: none).
+ *      - entries : Accounted owners, in the order they were first set.
+ *      - out : Stream of the budget reports (standard output by default).
+ *
+ * Methods:
+ *      - memory_core : MEMORY constructor (budget from the environment
+ *                      variable NSAT_MEMORY_BUDGET_MB, if set).
+ *      - set_budget, get_budget : Memory budget (bytes).
+ *      - set_output : Stream of the budget reports.
+ *      - set : Sets the bytes owned by an owner.
+ *      - reserve : Checks the budget, then sets the bytes of an owner.
+ *      - check : Fails if the resident set exceeds the budget.
+ *      - remove : Removes all the owners of a subsystem.
+ *      - clear : Removes all the owners.
+ *      - total : Bytes of all the owners (or of a subsystem).
+ *      - get_entries : Returns the entries.
+ *      - to_json : Returns the accounting as a JSON object.
+ *      - print : Prints the breakdown per subsystem and owner.
+ *      - rss, peak_rss : Resident set size and its high-water (bytes).
+ *      - sample : Reads both in one pass.
+ *      - reset_peak_rss : Resets the high-water to the current RSS.
+ *
+ ***************************************************************************/
+class memory_core {
+    private:
+        int64_t budget;
+        vector<mem_entry> entries;
+        ostream *out;
+
+        int find(const string &, const string &) const;
+        void exceeded(const string &, int64_t) const;
+
+    public:
+        memory_core();
+
+        void set_budget(int64_t b) { budget = (b > 0) ? b : 0; }
+        int64_t get_budget() const { return budget; }
+        void set_output(ostream &o) { out = &o; }
+
+        void set(const string &, const string &, int64_t);
+        void reserve(const string &, const string &, int64_t);
+        void check(const string &) const;
+        void remove(const string &);
+        void clear() { entries.clear(); }
+
+        int64_t total() const;
+        int64_t total(const string &) const;
+        const vector<mem_entry> &get_entries() const { return entries; }
+        string to_json() const;
+        void print(ostream &) const;
+
+        static int64_t rss();
+        static int64_t peak_rss();
+        static void sample(int64_t &, int64_t &);
+        static bool reset_peak_rss();
+};
+
+#endif // _MEMORY_CORE_H
@@ -0,0 +1,83 @@
+#ifndef _NETGEN_CORE_H
+#define _NETGEN_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "nsat_core.h"
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Synthetic network parameters struct
+ * ----------------------------------*/
+typedef struct netgen_params_s {
+    int num_groups;         // number of NSAT groups
+    int num_neurons;        // neurons per group (input group too)
+    float density;          // connection probability of a projection
+    int radius;             // 0: uniform, otherwise local connectivity
+    float rate;             // Poisson rate of the input group (Hz)
+    bool stdp;              // STDP on the excitatory groups
+    int sim_time_ms;        // simulation time of a run (ms)
+    int seed;               // seed of the connectivity and of CARLsim
+    string input_type;      // poisson or vectorial (spike trains given
+                            // through initialize_custom_input)
+} netgen_params;
+
+
+/***************************************************************************
+ * NETGEN Class - This class generates synthetic networks of any size and
+ * writes them in the usual parameters files (spkg, nsat, stdp, delays
+ * and one file per connection) plus a configuration file (see
+ * config_core.h), so they go through the same parsing as hand-written
+ * networks.
+ *
+ * A network has one Poisson input group and num_groups NSAT groups of
+ * num_neurons neurons each; every fourth group is inhibitory. The input
+ * projects onto every group and each group projects onto the next one
+ * (the last onto the first). Each synapse exists with probability
+ * density and its weight is uniform in [1, maxWt/2]. The same parameters
+ * and seed always give the same files.
+ *
+ * With a radius the connectivity is local: the neurons of each group sit
+ * on a ring in a random (hidden) order, and a synapse can only exist
+ * between neurons at most radius positions apart. The neuron ids are 
+ * therefore scattered, which is what a locality reordering of the 
+ * neurons (see batch_core::set_reorder) has to undo.
+ *
+ * Attributes:
+ *      - params : The network parameters.
+ *      - num_synapses : Number of synapses of the last written network.
+ *
+ * Methods:
+ *      - netgen_core : NETGEN constructor.
+ *      - write : Writes the network files into a directory.
+ *      - get_num_neurons : Number of neurons (input and NSAT).
+ *      - get_num_synapses : Number of (nonzero) synapses.
+ *
+ ***************************************************************************/
+class netgen_core {
+    private:
+        netgen_params params;
+        int64_t num_synapses;
+
+        string group_name(int) const;
+        vector<int> positions(int) const;
+        void write_projection(const string &, int, int, uint32_t);
+
+    public:
+        netgen_core(const netgen_params &);
+
+        int write(const string &);
+        int64_t get_num_neurons() const {
+            return static_cast<int64_t>(params.num_groups + 1) *
+                   params.num_neurons;
+        }
+        int64_t get_num_synapses() const { return num_synapses; }
+};
+
+#endif // _NETGEN_CORE_H
@@ -1,7 +1,7 @@
 #ifndef _NSAT_CORE_H
 #define _NSAT_CORE_H
 
-#define MAKE_FLAG 1
+#define MAKE_FLAG 1     // 1: shared library with the ctypes ABI (capi.cpp)
 
 #include <iostream>
 #include <iomanip>
@@ -12,11 +12,19 @@
 #include <regex>
 #include <vector>
 #include <cstdarg>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <sys/stat.h>
 
 #include <carlsim.h>
 #include <poisson_rate.h>
 
 #include "connx_core.h"
+#include "ckpt_core.h"
+#include "spkg_core.h"
+#include "timer_core.h"
+#include "memory_core.h"
 
 
 using namespace std;
@@ -117,6 +125,43 @@ typedef struct input_units_s {
 } input_unit;
 
 
+/* ----------------------------------
+ * Projection (connection) struct
+ * ----------------------------------*/
+typedef struct projection_s {
+    string src_name;        // source group's name
+    string dest_name;       // destination group's name
+    bool src_input;         // true if the source is an input group
+    int num_pre;            // number of presynaptic neurons
+    int num_post;           // number of postsynaptic neurons
+    int prob_flag;          // 4: BlankOutProb(prob), 5: BlankOutProb(prob, std)
+    float prob;             // blankout probability
+    float std;              // blankout probability standard deviation
+    vector<vector<float>> wt;   // synaptic weights [pre][post]
+} projection;
+
+
+/* ----------------------------------
+ * STDP parameters struct
+ * ----------------------------------*/
+typedef struct stdp_unit_s {
+    string unit_name;       // NSAT group's name
+    string type;            // E (excitatory) or I (inhibitory) STDP
+    string da_mode;         // STANDARD or DA_MOD
+    int stdp_fun;           // STDP curve (0: exponential, 1: timing/pulse)
+    bool is_set;            // on/off STDP
+    float alpha_plus;
+    float tau_plus;
+    float alpha_minus;
+    float tau_minus;
+    float beta_ltp;
+    float beta_ltd;
+    float lambda;
+    float delta;
+    float gamma;
+} stdp_unit;
+
+
 /***************************************************************************
  * NSAT_CORE Auxilixiary Functions Declarations
  ***************************************************************************/
@@ -126,8 +171,18 @@ bool str2bool(string);                  // Convert string to bool
 unsigned int str2nrtype(string);        // Convert string to neuronType_t 
 stdpType_t str2stdpt(string);           // Convert string to stdpType_t
 
+// File system
+void make_dirs(string);                 // Create a directory (and parents)
+
+// Parameters
+void set_nsat_param(nsat &, const string &, float); // Set a NSAT parameter
+
 // Exceptions handler
 void print_exceptions(int, ...);        // Handle custom exceptions
+void log_exceptions(ostream &, int, ...); // ... to a stream
+
+// Process-wide drand48 state (CARLsim's CPU random numbers)
+extern mutex drand48_mutex;             // Guards seed48/srand48 calls
 
 
 
@@ -154,20 +209,67 @@ void print_exceptions(int, ...);        // Handle custom exceptions
  *                  CARLsim for the NSAT neural layers.
  *      - psn_spkg : A double pointer to PoissonRate. It points to the
  *                  PoissonRate groups.
- *      - prd_spkg : A double pointer to PeriodicSpikeGenerator. It
- *                  points to periodic spike generator groups.
- *      - vec_spkg : A double pointer to SpikeGeneratorFromVector. It
- *                  points to vectorial spike generator groups. 
- *      - file_spkg : A double pointer to SpikeGeneratorFromFile. It 
- *                  points to file spike generator groups. 
+ *      - calendar : A pointer to ScheduleSpkg. It serves the spikes of
+ *                  all the generator-based (pre-generated Poisson, 
+ *                  periodical, vectorial and file) input groups.
+ *      - inp_start : First calendar id of each input group.
+ *      - input_rates : Per-neuron rates of pre-generated Poisson groups.
+ *      - train_offsets : Start time (ms) of each group's spike train.
+ *      - file_times, file_nids : Spikes read from the input spike files.
  *      - spike_train : A vector that contains user-defined spike trains
  *                       for inputs to the network. 
+ *      - projs : A vector of projection structs holding the parsed 
+ *                  synaptic connections files.
+ *      - shared_projs : A pointer to read-only projections owned by 
+ *                  someone else (e.g. parsed once by a sweep driver).
+ *                  If it is not NULL it is used instead of projs.
+ *      - stdpc : A vector of stdp_unit structs (parsed STDP file).
+ *      - results_dir : Directory of the spike monitors files ("DEFAULT"
+ *                  CARLsim names if it is empty).
+ *      - conn_ids, conn_grps, conn_mons : CARLsim ids, (pre, post) groups
+ *                  and connection monitors of the connections (monitors
+ *                  only if checkpoints are enabled).
+ *      - ckpt_enabled : If true the setup state creates the connection
+ *                  monitors that checkpoints read the weights from.
+ *      - restored_time : Simulation time of the last restored checkpoint.
+ *      - carl_state : 0 (created), 1 (configured) or 2 (set up).
+ *      - inp_smons, nsat_smons : Spike monitors of the monitored groups
+ *                  (created by the first run, reused by the next ones).
+ *      - instance_id : Unique id of the instance in the process.
+ *      - log, log_file : Stream of the instance's messages (errors,
+ *                  summaries) and its file (see set_log_file).
+ *      - last_error : Last exception of the instance (0: none).
+ *      - timer : Phase timings (construction, config, setup, run,
+ *                  cleanup), enabled by default.
+ *      - run_thread : Thread of the asynchronous run (RUN_ASYNC).
+ *      - async_slice : Slice (ms) of the asynchronous run (0: not
+ *                  running asynchronously).
+ *      - async_running, async_cancel : Run in progress / cancellation
+ *                  requested (polled between slices).
+ *      - async_ms, async_spikes : Simulation time (ms) and spikes of the
+ *                  monitored NSAT groups at the end of the last slice.
+ *      - async_rc : Return value (or exception) of the asynchronous run.
+ *      - mem : Memory accounting of the weights, connection generators,
+ *                  inputs, monitors and CARLsim, with an optional budget
+ *                  (see memory_core.h).
  *
  * Methods: 
  *              Construction/Destruction
  *              ------------------------
- *      - nsat_core : NSAT Core constructor.
+ *      - nsat_core : NSAT Core constructors (from parameters files, or
+ *                    empty for the in-memory construction).
  *      - ~nsat_core : NSAT Core destructor.
+ *      - initialize_instance : Per-instance state (ids, log, outputs).
+ *      - create_carlsim : Instantiate CARLsim.
+ *
+ *              In-memory Construction
+ *              ----------------------
+ *      - add_input_group : Declare an input group (no SPKG file).
+ *      - add_nsat_group : Declare a NSAT group (no NSAT file).
+ *      - add_projection : Add a connection from a dense weights matrix.
+ *      - add_projection_csr : Add a connection from a CSR weights matrix.
+ *      - check_projection : Validate the groups and sizes of a connection.
+ *      - new_projection : Validate and allocate a connection (zeros).
  *
  *              Auxiliary Methods
  *              -----------------
@@ -178,12 +280,15 @@ void print_exceptions(int, ...);        // Handle custom exceptions
  *      - initialize_params : Build method for NSAT, SPKG and STDP.
  *      - poisson_spikes : Construct poisson spike generator neural
  *                          groups.
- *      - periodical_spikes : Construct periodic spike generator neural
- *                              groups.
- *      - vectorial_spikes : Read spike times from a double vector of ints
- *                            and construct spike generator neural groups.
- *      - file_spikes      : Read spike times and neurons ids from a binary
- *                           CARLsim file. 
+ *      - calendar_spikes : Construct the calendar spike source of the
+ *                          input groups.
+ *      - build_calendar : Merge the inputs of a run into the calendar.
+ *      - scheduled_spikes : Set up pre-generated Poisson inputs.
+ *      - periodical_spikes : Set up periodic inputs.
+ *      - vectorial_spikes : Set up inputs from a double vector of ints
+ *                            (spike times).
+ *      - file_spikes      : Read spike times and neurons ids from binary
+ *                           CARLsim files. 
  *      - load_core_params : Load the core parameters for CARLsim. It takes
  *                          three arguments (structs) passed by Python
  *                          interface. 
@@ -198,19 +303,66 @@ void print_exceptions(int, ...);        // Handle custom exceptions
  *      - read_struct_array : Read and print to stdout a specified value
  *                          of a struct (mainly for debug).
  *      - initialize_groups : Initialize input and NSAT neural groups.
+ *      - apply_nsat : Pass the NSAT parameters of a group to CARLsim.
+ *      - read_connexions : Parse all the synaptic connections files into
+ *                          projection structs (without touching CARLsim).
  *      - initialize_connexions : Build all the neural synaptic connections
  *                                  according to some user-defined files.
  *      - initialize_synapses : Create blankout synapses for the NSAT 
  *                              neural groups.
+ *      - read_stdp : Parse the STDP parameters file into stdp_unit structs.
  *      - initialize_stdp : Assign STDP parameters to NSAT neural groups.
+ *      - apply_stdp : Pass one STDP entry to CARLsim.
+ *      - override_nsat : Override a NSAT parameter of a group.
+ *      - override_stdp : Override a STDP parameter of a group.
+ *      - update_nsat, update_stdp : Change a NSAT/STDP parameter of a 
+ *                          configured network.
+ *      - set_weights : Replace the weights of a connection.
+ *      - set_projections : Use projections parsed elsewhere (read-only).
+ *      - set_results_dir : Set the spike monitors files directory.
+ *      - monitor_fname : Spike monitor file name of a group.
+ *      - set_input_rate : Change the rate of a Poisson input group after
+ *                         the network has been set up.
+ *      - set_input_rates : Change the per-neuron rates of a Poisson
+ *                          input group after the network has been set up.
+ *      - set_input_vector : Swap the spike train of a vectorial input
+ *                           group after the network has been set up.
+ *      - reset_state : Prepare a set up network for a new trial (clear
+ *                      the monitors, optionally restore the weights).
+ *      - get_num_spikes : Spikes of the monitored NSAT groups recorded by
+ *                      the last run.
+ *      - enable_checkpoints : Request checkpoints (before the setup).
+ *      - checkpoint : Write weights, time and RNG state to a file.
+ *      - restore : Restore a checkpoint written by checkpoint.
  *      - initialize_integration_method : Choose an integration method.
  *      - initialize_conductances : Choose COBA or CUBA simulation type.
  *
+ *              Accessors
+ *              ---------
+ *      - get_carlsim_params, get_simulation_params, get_input_units,
+ *        get_nsat_units, get_projections, get_stdp_units,
+ *        get_spike_trains : Read-only
+ *        access to the loaded parameters (used by batch_core).
+ *      - get_timer : The phase timer (see timer_core.h).
+ *      - get_memory : The memory accounting (see memory_core.h).
+ *      - get_instance_id, get_last_error, get_log : Instance's id, last
+ *        exception and message stream.
+ *
+ *              Errors and Logging
+ *              ------------------
+ *      - error : Log an exception to the instance's stream, keep it as
+ *                the last error and return it.
+ *      - set_log_file : Write the instance's messages to a file.
+ *
  *              Core Methods
  *              ------------
  *      - c_config_state : Performs a CARLsim Config State.
  *      - c_setup_state : Performs a CARLsim Setup State.
  *      - c_run_state : Performs a CARLsim Run State.
+ *      - run_async : Performs the Run State on an internal thread.
+ *      - poll : Progress of the asynchronous run.
+ *      - wait : Waits for the asynchronous run.
+ *      - cancel : Stops the asynchronous run after the current slice.
  *
  *
  *              CleanUp Methods
@@ -244,16 +396,66 @@ class nsat_core {
 
         // Input attributes
         PoissonRate **psn_spkg;
-        PeriodicSpikeGenerator **prd_spkg;
-        SpikeGeneratorFromVector **vec_spkg;
-        SpikeGeneratorFromFile **file_spkg;
+        ScheduleSpkg *calendar;
+        vector<int> inp_start;
 
         vector<vector<int>> spike_trains;
+        vector<vector<float>> input_rates;
+        vector<int> train_offsets;
+        vector<vector<int>> file_times, file_nids;
+
+        // Connections attributes
+        vector<projection> projs;
+        const vector<projection> *shared_projs;
+
+        // Connections CARLsim ids, (pre, post) groups and monitors
+        vector<short int> conn_ids;
+        vector<pair<int, int>> conn_grps;
+        vector<ConnectionMonitor *> conn_mons;
+        bool ckpt_enabled;
+
+        // STDP attributes
+        vector<stdp_unit> stdpc;
+
+        // Output attributes
+        string results_dir;
+
+        // Simulation time (ms) of the last restored checkpoint
+        int restored_time;
+
+        // CARLsim state (0: created, 1: configured, 2: set up)
+        int carl_state;
+
+        // Trials attributes (spike monitors)
+        vector<SpikeMonitor *> inp_smons, nsat_smons;
+
+        // Instance's id, messages stream and last exception
+        int instance_id;
+        ostream *log;
+        ofstream log_file;
+        int last_error;
+
+        // Phase timings
+        timer_core timer;
+
+        // Memory accounting
+        memory_core mem;
+
+        // Asynchronous run
+        thread run_thread;
+        int async_slice;
+        atomic<bool> async_running, async_cancel;
+        atomic<int> async_ms;
+        atomic<int64_t> async_spikes;
+        int async_rc;
 
     public:
         // NSAT Class constructor and destructor
         nsat_core(filenames *, carlsim *, simulation *);  // Constructor
+        nsat_core(carlsim *, simulation *);  // In-memory constructor
         ~nsat_core();                        // Destructor
+        void initialize_instance();
+        void create_carlsim();
 
         // NSAT Class core params loader
         void load_core_params(carlsim *c, simulation *s, filenames *);
@@ -274,48 +476,90 @@ class nsat_core {
 
         // NSAT input generation methods
         int poisson_spikes();
+        int calendar_spikes();
+        void build_calendar(int);
+        int scheduled_spikes();
         int periodical_spikes();
         int vectorial_spikes();
         int file_spikes();
     
         // NSAT Initialization Class Methods
         int initialize_groups();
+        void apply_nsat(int);
+        int read_connexions();
         int initialize_connexions();
+        int read_stdp();
         int initialize_stdp();
+        void apply_stdp(const stdp_unit &);
         int initialize_integration_method();
         int initialize_conductances();
         void initialize_custom_input(void *, int, int);
 
+        // NSAT in-memory construction
+        int add_input_group(const string &, int, const string &,
+                            const spkg &, bool);
+        int add_nsat_group(const string &, int, const string &,
+                           const nsat &, bool);
+        void check_projection(const string &, const string &, int, int);
+        projection &new_projection(const string &, const string &, int, int,
+                                   float, float);
+        int add_projection(const string &, const string &, const float *,
+                           int, int, float, float);
+        int add_projection_csr(const string &, const string &, const int *,
+                               const int *, const float *, int, int, float,
+                               float);
+
+        // NSAT parameters overrides and shared data
+        void override_nsat(const string &, const string &, float);
+        void override_stdp(const string &, const string &, float);
+        void update_nsat(const string &, const string &, float);
+        void update_stdp(const string &, const string &, float);
+        void set_weights(int, const vector<float> &);
+        void set_projections(const vector<projection> *);
+        void set_results_dir(const string &);
+        string monitor_fname(const string &);
+        void set_input_rate(int, float);
+        void set_input_rates(int, const vector<float> &);
+        void set_input_vector(int, const vector<int> &);
+        int reset_state(bool);
+        int64_t get_num_spikes();
+
+        // NSAT checkpoints
+        void enable_checkpoints();
+        int checkpoint(const string &);
+        int restore(const string &);
+        int get_restored_time() const { return restored_time; }
+
+        // NSAT Class accessors
+        const carlsim &get_carlsim_params() const { return carl_p; }
+        const simulation &get_simulation_params() const { return sim_p; }
+        const vector<input_unit> &get_input_units() const { return inpc; }
+        const vector<nsat_unit> &get_nsat_units() const { return nsatc; }
+        const vector<projection> &get_projections() const {
+            return shared_projs ? *shared_projs : projs;
+        }
+        const vector<stdp_unit> &get_stdp_units() const { return stdpc; }
+        const vector<vector<int>> &get_spike_trains() const { return spike_trains; }
+        timer_core &get_timer() { return timer; }
+        memory_core &get_memory() { return mem; }
+        int get_instance_id() const { return instance_id; }
+        int get_last_error() const { return last_error; }
+        ostream &get_log() { return *log; }
+
+        // NSAT errors and logging
+        int error(int);
+        void set_log_file(const string &);
+
         // NSAT Main CARLsim Interface Methods
         int c_config_state();          // CARLsim config state
         int c_setup_state();           // CARLsim setup state
         int c_run_state();             // CARLsim run state
+        void run_async(int);
+        bool poll(int &, int64_t &) const;
+        int wait();
+        int cancel();
         int c_cleanup();               // Clean up memory
 };
 
 
-/***************************************************************************
- * Substitute of Python ctypes ABI (since it does not exist one for C++)
- * Set MAKE_FLAG to 0 in order to compile as standalone running software
- * Set MAKE_FLAG to 1 in order to compile as a dynamic shared library
- **************************************************************************/
-#if (MAKE_FLAG == 1)
-    extern "C" {
-        nsat_core *NSAT_Core_New(carlsim *carl, simulation *simu, filenames *files) { 
-            return new nsat_core(files, carl, simu);
-        }
-        void NSAT_Core_InitInput(nsat_core *obj, void *ptr, int nspkt, int length) {
-            obj->initialize_custom_input(ptr, nspkt, length);
-        }
-        void NSAT_Core_ReadStructArray(nsat_core *obj, void *ptr, int size) {
-            obj->read_struct_array(ptr, size);
-        }
-        int NSAT_Core_Config(nsat_core *obj){ obj->c_config_state(); }
-        int NSAT_Core_Setup(nsat_core *obj){ obj->c_setup_state(); }
-        int NSAT_Core_Run(nsat_core *obj){ obj->c_run_state(); }
-        int NSAT_Core_CleanUp(nsat_core *obj){ obj->c_cleanup(); }
-        void NSAT_Core_Exit(nsat_core *obj){ delete obj; }
-    }
-#endif
-
 #endif // _NSAT_CORE_H
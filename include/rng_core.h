@@ -0,0 +1,114 @@
+#ifndef _RNG_CORE_H
+#define _RNG_CORE_H
+
+#include <cmath>
+#include <stdint.h>
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Random streams (key of the draws)
+ * ----------------------------------*/
+#define RNG_POISSON 1       // Poisson input spikes (per input group)
+#define RNG_NOISE 2         // NSAT sigma noise (per NSAT group)
+#define RNG_BLANKOUT 3      // Blankout of synaptic events (per projection)
+#define RNG_SCHEDULE 4      // Pre-generated Poisson inputs (per input group)
+#define RNG_SKIP 5          // Skip-sampled blankout (per projection)
+
+#define RNG_STREAM(kind, idx) ((static_cast<uint32_t>(kind) << 24) | \
+                               static_cast<uint32_t>(idx))
+
+
+/***************************************************************************
+ * Counter-based random numbers (Philox4x32-10, Salmon et al., SC 2011).
+ * A draw is a pure function of a key and a counter, so it does not 
+ * depend on which draws were made before it. Here the key is a random
+ * stream (RNG_STREAM) and the counter is (id, step, seed, 0), where id
+ * is a neuron or synapse id within the stream and seed is the seed of an
+ * instance. Hence the random numbers of an instance are the same for any
+ * batch size, order of evaluation or number of threads.
+ *
+ * The batched functions draw one number per seed for the same (stream,
+ * id, step), or a sequence of numbers for the same seed. Their loops 
+ * have no dependencies between iterations, so the compiler can 
+ * vectorize them.
+ *
+ * Functions:
+ *      - philox4x32 : Philox4x32-10 block (4 x 32 random bits).
+ *      - rng_u01 : Converts 32 random bits to a float in [0, 1).
+ *      - rng_uniform1, rng_normal1 : One uniform (normal) number for one
+ *        seed (inline, for fixed-size loops).
+ *      - rng_uniform : One uniform number per seed.
+ *      - rng_normal : One standard normal number per seed (Box-Muller).
+ *      - rng_uniform_seq : A sequence of uniform numbers for one seed.
+ *      - rng_geometric : Geometric number (skip length) from a uniform.
+ *      - rng_known_answers : Checks philox4x32 against the published
+ *        Random123 known-answer vectors.
+ *
+ ***************************************************************************/
+static inline void philox4x32(uint32_t c[4], const uint32_t k[2]) {
+    uint32_t k0 = k[0], k1 = k[1];
+
+    for (int r = 0; r < 10; ++r) {
+        uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c[0];
+        uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * c[2];
+        uint32_t hi0 = p0 >> 32, lo0 = static_cast<uint32_t>(p0);
+        uint32_t hi1 = p1 >> 32, lo1 = static_cast<uint32_t>(p1);
+
+        c[0] = hi1 ^ c[1] ^ k0;
+        c[1] = lo1;
+        c[2] = hi0 ^ c[3] ^ k1;
+        c[3] = lo0;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+}
+
+
+static inline float rng_u01(uint32_t x) {
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+
+static inline float rng_uniform1(uint32_t stream, uint32_t id,
+                                 uint32_t step, uint32_t seed) {
+    const uint32_t key[2] = {stream, 0x6E534154u};
+    uint32_t c[4] = {id, step, seed, 0};
+
+    philox4x32(c, key);
+    return rng_u01(c[0]);
+}
+
+
+/* The two first words of a Philox block feed a Box-Muller transform,
+ * u1 in (0, 1] to keep log finite */
+static inline float rng_normal1(uint32_t stream, uint32_t id,
+                                uint32_t step, uint32_t seed) {
+    const uint32_t key[2] = {stream, 0x6E534154u};
+    uint32_t c[4] = {id, step, seed, 0};
+
+    philox4x32(c, key);
+    float u1 = 1.0f - rng_u01(c[0]);
+    float u2 = rng_u01(c[1]);
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.28318530718f * u2);
+}
+
+
+/* Failures before the first success of Bernoulli(q) trials, capped to cap
+ * (u uniform in [0, 1), lq = log(1 - q)) */
+static inline int rng_geometric(float u, float lq, int cap) {
+    if (lq >= 0.0f) return cap;
+    float g = logf(1.0f - u) / lq;
+    return (g < cap) ? static_cast<int>(g) : cap;
+}
+
+
+void rng_uniform(uint32_t, uint32_t, uint32_t, const uint32_t *, int, float *);
+void rng_normal(uint32_t, uint32_t, uint32_t, const uint32_t *, int, float *);
+void rng_uniform_seq(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, int,
+                     float *);
+int rng_known_answers();
+
+#endif // _RNG_CORE_H
@@ -0,0 +1,92 @@
+#ifndef _SCHEDULE_CORE_H
+#define _SCHEDULE_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <stdint.h>
+
+#include "rng_core.h"
+
+
+using namespace std;
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE Class - This class holds the spikes of a time window
+ * [t0, t0 + num_steps) as a compact time-sorted schedule: the ids that 
+ * spike at step t0 + i are ids[step_ptr[i]] ... ids[step_ptr[i+1]-1].
+ * Spikes are first added in any order and then sorted by step (counting
+ * sort) by FINALIZE, so a simulation step only walks its own spikes.
+ * This is a calendar queue with one bucket per ms: all kinds of inputs
+ * (Poisson, periodic, spike trains and spike files) of all the input
+ * groups can be merged into one schedule.
+ *
+ * Poisson spike trains are pre-generated from their inter-spike 
+ * intervals. With a rate r (Hz) and 1 ms steps a neuron spikes at each
+ * step with probability p = r / 1000, hence its intervals are geometric:
+ * 1 + floor(log(u) / log(1 - p)) steps, with u uniform in (0, 1]. The 
+ * uniform numbers are counter-based (see rng_core.h) and drawn in blocks
+ * per neuron, so the trains do not depend on the order of generation.
+ *
+ * Attributes:
+ *      - t0 : First step of the window.
+ *      - num_steps : Length of the window (steps).
+ *      - step_ptr : Spikes of step t0 + i: [step_ptr[i], step_ptr[i+1]).
+ *      - ids : Ids of the spiking neurons (sorted by step).
+ *      - pend_t, pend_id : Added spikes that have not been sorted yet.
+ *
+ * Methods:
+ *      - spike_schedule : SPIKE_SCHEDULE constructor.
+ *      - reset : Empties the schedule and sets a new window.
+ *      - add : Adds one spike.
+ *      - add_poisson : Adds Poisson spike trains of a group of neurons.
+ *      - add_periodic : Adds periodic spikes of a group of neurons.
+ *      - add_train : Adds a spike train shared by a group of neurons.
+ *      - add_events : Adds (time, neuron) spike events of a group.
+ *      - finalize : Sorts the added spikes by step.
+ *      - begin, end : Spikes of a step.
+ *
+ ***************************************************************************/
+class spike_schedule {
+    private:
+        int t0;
+        int num_steps;
+        vector<int> step_ptr;
+        vector<int> ids;
+        vector<int> pend_t, pend_id;
+
+    public:
+        spike_schedule();
+
+        void reset(int, int);
+        void add(int, int);
+        void add_poisson(const vector<float> &, int, int, int,
+                         uint32_t, uint32_t);
+        void add_periodic(int, float, bool, int, int, int);
+        void add_train(const vector<int> &, int, int, int, int, int);
+        void add_events(const vector<int> &, const vector<int> &, int,
+                        int, int, int);
+        void finalize();
+
+        int first_step() const { return t0; }
+        int length() const { return num_steps; }
+        int size() const { return ids.size(); }
+        const int *begin(int t) const {
+            return ids.data() + step_ptr[t - t0];
+        }
+        const int *end(int t) const {
+            return ids.data() + step_ptr[t - t0 + 1];
+        }
+        bool covers(int t) const {
+            return t >= t0 && t < t0 + num_steps && !step_ptr.empty();
+        }
+};
+
+
+// Spike files
+void read_spike_file(const string &, vector<int> &, vector<int> &);
+
+#endif // _SCHEDULE_CORE_H
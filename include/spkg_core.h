@@ -0,0 +1,57 @@
+#ifndef _SPKG_CORE_H
+#define _SPKG_CORE_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <carlsim.h>
+
+#include "schedule_core.h"
+
+
+using namespace std;
+
+
+/***************************************************************************
+ * SCHEDULESPKG Class - This class implements CARLsim's SpikeGenerator 
+ * interface for pre-generated spike trains (see spike_schedule). One 
+ * object serves all the input groups: each group is registered with the
+ * offset of its neurons in the schedule's ids, and nextSpikeTime finds 
+ * the group from CARLsim's group id. The time-sorted schedule is turned
+ * into one sorted list of spike times per neuron, so every call of 
+ * nextSpikeTime is a binary search in the neuron's own list (and a 
+ * neuron without spikes costs nothing).
+ *
+ * Attributes:
+ *      - _grpOffset : Offset of each group's neurons (by CARLsim id).
+ *      - _nrnPtr : Spike times of neuron i: [_nrnPtr[i], _nrnPtr[i+1]).
+ *      - _times  : Spike times (ms), grouped by neuron.
+ *
+ * Methods: 
+ *              Construction/Destruction
+ *              ------------------------
+ *      - ScheduleSpkg : ScheduleSpkg constructor.
+ *      - ~ScheduleSpkg : ScheduleSpkg destructor.
+ *
+ *              Core Methods
+ *              ------------
+ *      - addGroup : Registers an input group.
+ *      - setSchedule : Replaces the spike trains.
+ *      - nextSpikeTime : Returns the next spike time of a neuron.
+ *
+ ***************************************************************************/
+class ScheduleSpkg : public SpikeGenerator {
+    private:
+        vector<int> _grpOffset;
+        vector<int> _nrnPtr;
+        vector<int> _times;
+    public:
+        ScheduleSpkg();
+        ~ScheduleSpkg();
+        void addGroup(int, int);
+        void setSchedule(const spike_schedule &, int);
+        int nextSpikeTime(CARLsim *, int, int, int, int, int);
+};
+
+#endif // _SPKG_CORE_H
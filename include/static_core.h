@@ -0,0 +1,890 @@
+#ifndef _STATIC_CORE_H
+#define _STATIC_CORE_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <type_traits>
+#include <algorithm>
+#include <cstring>
+
+#include "nsat_core.h"
+#include "rng_core.h"
+
+
+using namespace std;
+
+
+/***************************************************************************
+ * Compile-time network description. A network is three type lists: the
+ * input groups, the NSAT groups and the projections. Groups are numbered
+ * as in batch mode (inputs first, then NSAT groups) and projections in
+ * the order of the connection files.
+ *
+ *      - static_input<N, TYPE, MONITOR> : Poisson input group of N neurons
+ *        of CARLsim type TYPE (e.g. EXCITATORY_NEURON).
+ *      - static_nsat<N, TYPE, NOISE, BIAS, REFRAC, MONITOR> : NSAT group
+ *        of N neurons. NOISE, BIAS and REFRAC state whether its sigma, b
+ *        and tau_ref are nonzero (see batch_core::update_group).
+ *      - static_projection<SRC, DEST, NNZ, BLANKOUT> : Projection from
+ *        group SRC to NSAT group DEST with NNZ synapses (nonzero
+ *        weights); BLANKOUT states whether its blankout probability is
+ *        nonzero.
+ *
+ * The parameters values (weights, rates, alpha, ...) are still read from
+ * the usual files, and checked against the description when the network
+ * is built (see STATIC_CORE). STATIC_DESCRIBE generates the description
+ * of a parsed network, synapse counts included.
+ ***************************************************************************/
+template<int N, unsigned int TYPE, bool MONITOR = true>
+struct static_input {
+    enum { size = N, type = TYPE, monitor = MONITOR };
+};
+
+template<int N, unsigned int TYPE, bool NOISE, bool BIAS, bool REFRAC,
+         bool MONITOR = true>
+struct static_nsat {
+    enum { size = N, type = TYPE, noise = NOISE, bias = BIAS,
+           refrac = REFRAC, monitor = MONITOR };
+};
+
+template<int SRC, int DEST, int NNZ, bool BLANKOUT = true>
+struct static_projection {
+    // Plain constants: they are compared with the group counts of
+    // static_core (another enum, see -Wenum-compare)
+    static constexpr int src = SRC, dest = DEST, nnz = NNZ;
+    static constexpr bool blankout = BLANKOUT;
+};
+
+template<typename... T>
+struct static_list {};
+
+
+/* ----------------------------------
+ * Type lists helpers
+ * ----------------------------------*/
+template<typename L> struct static_count;
+template<typename... T>
+struct static_count<static_list<T...>> {
+    enum { value = sizeof...(T) };
+};
+
+template<int I, typename L> struct static_at;
+template<typename H, typename... T>
+struct static_at<0, static_list<H, T...>> { typedef H type; };
+template<int I, typename H, typename... T>
+struct static_at<I, static_list<H, T...>> : static_at<I-1, static_list<T...>> {};
+
+template<typename A, typename B> struct static_concat;
+template<typename... A, typename... B>
+struct static_concat<static_list<A...>, static_list<B...>> {
+    typedef static_list<A..., B...> type;
+};
+
+// First neuron id of group I (neurons of groups 0 ... I-1)
+template<int I, typename L>
+struct static_start {
+    enum { value = static_start<I-1, L>::value + static_at<I-1, L>::type::size };
+};
+template<typename L>
+struct static_start<0, L> { enum { value = 0 }; };
+
+
+/* ----------------------------------
+ * Fixed-size CSR projection struct
+ * (NNZ synapses, at least one slot)
+ * ----------------------------------*/
+template<int PRE, int NNZ>
+struct static_csr {
+    int row_ptr[PRE + 1];       // synapses of pre neuron i: [row_ptr[i], row_ptr[i+1])
+    int col_idx[NNZ ? NNZ : 1]; // postsynaptic neuron (local id) of each synapse
+    float wt[NNZ ? NNZ : 1];    // signed weight of each synapse
+};
+
+template<typename G, typename P>
+struct static_csr_of {
+    typedef static_csr<static_at<P::src, G>::type::size, P::nnz> type;
+};
+
+template<typename G, typename L> struct static_csr_tuple;
+template<typename G, typename... P>
+struct static_csr_tuple<G, static_list<P...>> {
+    typedef tuple<typename static_csr_of<G, P>::type...> type;
+};
+
+
+/***************************************************************************
+ * STATIC_CORE Class - This class simulates one instance of a network
+ * whose topology is fixed at compile time (see static_input, static_nsat
+ * and static_projection). It follows the model of batch mode (see
+ * batch_core.h) with one instance and skip-sampled blankout, and draws
+ * the same counter-based random numbers, so its spikes are identical to
+ * those of batch_core with a batch size of 1 (STDP off).
+ *
+ * Since the groups sizes, neuron types, update terms and projections are
+ * template arguments, all the state lives in fixed-size arrays, the loops
+ * over groups and projections are unrolled (one instantiation per group
+ * and projection), the loops over neurons have constant trip counts and
+ * each group's update is inlined without the disabled terms. There is no
+ * kernel dispatch, no batch loop and no name lookup left at run time.
+ *
+ * A static core is built from a NSAT Core, which parses the parameters
+ * files as usual; the parsed network must match the description. Only
+ * Poisson inputs, uniform blankout probabilities and fixed weights (no
+ * STDP) are supported; other networks use batch_core. The arrays are
+ * members, so a large network should be allocated with new. Errors of
+ * the setup and run states are reported by the NSAT Core (see
+ * nsat_core::error).
+ *
+ * Attributes:
+ *      - core : NSAT Core the network was built from (error reports).
+ *      - seed : Random seed (carlsim::random_seed).
+ *      - num_steps : Number of simulation steps (ms) per run.
+ *      - sim_step : Current simulation step (ms since the start).
+ *      - names : Name of each group.
+ *      - grp_start : First neuron id of each group (inputs first).
+ *      - monitor : Monitor flag of each group.
+ *      - projs : Parsed projections (until the setup state).
+ *      - input_p : Spike probability per step of each input neuron.
+ *      - params : NSAT parameters of each NSAT group.
+ *      - lq, drop : log(1 - q) of the skip sampling rate q and drop/keep
+ *                   mode of each projection (see batch_core::deliver_skip).
+ *      - connx : Fixed-size CSR projections (tuple).
+ *      - v, isyn, isyn_in, ref : Neurons state.
+ *      - spk_buf, spk, spk_prev : Spikes of the current and previous step.
+ *      - num_spikes : Spikes of each group since the last reset.
+ *      - records : Recorded (time, neuron id) pairs of monitored groups.
+ *      - results_dir : Directory where the spike files are written.
+ *
+ * Methods:
+ *      - static_core : STATIC Core constructor (from a NSAT Core).
+ *      - check_groups, build_projections : Check the parsed groups and
+ *        build the projections against the description (recursive).
+ *      - set_results_dir : Sets the spike files directory.
+ *      - reset_state : Resets the neurons state and the recordings.
+ *      - generate_inputs : Emits the input spikes of a step.
+ *      - deliver_projections : Accumulates the synaptic inputs of a step.
+ *      - update_groups : Updates the NSAT neurons of a step.
+ *      - record_groups : Counts and records the spikes of a step.
+ *      - step : Simulates one step.
+ *      - run : Simulates a number of steps.
+ *      - write_spikes : Writes one spike file per monitored group.
+ *      - get_num_spikes : Spikes of a group since the last reset.
+ *      - get_sim_step : Current simulation step.
+ *      - s_setup_state, s_run_state : Setup and Run states (as in batch
+ *                                     mode).
+ *
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+class static_core {
+    public:
+        typedef typename static_concat<INPUTS, NSATS>::type groups;
+        enum {
+            num_inputs = static_count<INPUTS>::value,
+            num_nsat = static_count<NSATS>::value,
+            num_groups = num_inputs + num_nsat,
+            num_projs = static_count<PROJS>::value,
+            num_input_neurons = static_start<num_inputs, groups>::value,
+            num_neurons = static_start<num_groups, groups>::value
+        };
+
+    private:
+        nsat_core *core;
+        uint32_t seed;
+        int num_steps;
+        int sim_step;
+        vector<string> names;
+        int grp_start[num_groups + 1];
+        bool monitor[num_groups];
+        vector<projection> projs;
+
+        float input_p[num_input_neurons];
+        nsat params[num_nsat];
+        float lq[num_projs];
+        bool drop[num_projs];
+        typename static_csr_tuple<groups, PROJS>::type connx;
+
+        float v[num_neurons], isyn[num_neurons], isyn_in[num_neurons];
+        int ref[num_neurons];
+        unsigned char spk_buf[2][num_neurons];
+        unsigned char *spk, *spk_prev;
+        int64_t num_spikes[num_groups];
+        vector<int> records[num_groups];
+        string results_dir;
+
+        template<int G> using group = typename static_at<G, groups>::type;
+        template<int G> using start = static_start<G, groups>;
+
+    public:
+        static_core(nsat_core *);
+
+        template<int G>
+        typename enable_if<(G < num_inputs)>::type
+        check_groups(const vector<input_unit> &, const vector<nsat_unit> &);
+        template<int G>
+        typename enable_if<(G >= num_inputs && G < num_groups)>::type
+        check_groups(const vector<input_unit> &, const vector<nsat_unit> &);
+        template<int G>
+        typename enable_if<(G == num_groups)>::type
+        check_groups(const vector<input_unit> &, const vector<nsat_unit> &) {}
+
+        template<int P>
+        typename enable_if<(P < num_projs)>::type build_projections();
+        template<int P>
+        typename enable_if<(P == num_projs)>::type build_projections() {}
+
+        void set_results_dir(const string &dir) { results_dir = dir; }
+        void reset_state();
+
+        template<int G>
+        typename enable_if<(G < num_inputs)>::type generate_inputs(int);
+        template<int G>
+        typename enable_if<(G == num_inputs)>::type generate_inputs(int) {}
+
+        template<int P>
+        typename enable_if<(P < num_projs)>::type deliver_projections(int);
+        template<int P>
+        typename enable_if<(P == num_projs)>::type deliver_projections(int) {}
+
+        template<int G>
+        typename enable_if<(G >= num_inputs && G < num_groups)>::type
+        update_groups(int);
+        template<int G>
+        typename enable_if<(G == num_groups)>::type update_groups(int) {}
+
+        template<int G>
+        typename enable_if<(G < num_groups)>::type record_groups(int);
+        template<int G>
+        typename enable_if<(G == num_groups)>::type record_groups(int) {}
+
+        void step(int);
+        void run(int);
+        int write_spikes();
+        int64_t get_num_spikes(int g) const { return num_spikes[g]; }
+        int get_sim_step() const { return sim_step; }
+
+        int s_setup_state();
+        int s_run_state();
+};
+
+
+/***************************************************************************
+ * STATIC_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * STATIC_CORE Class Constructor - It copies the parameters already loaded
+ * by a NSAT Core (parsing the connection files if needed) and checks them
+ * against the compile-time description.
+ *
+ * Args:
+ * -----
+ *  core (nsat_core *) : A pointer to a NSAT Core instance.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between projections and description.
+ *  7  : Not a valid number of neural groups.
+ *  8  : Not a valid input type (only poisson).
+ *  29 : Not a valid group (size, neuron type or update terms).
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+static_core<INPUTS, NSATS, PROJS>::static_core(nsat_core *core) {
+    const simulation &sim_p = core->get_simulation_params();
+    const vector<input_unit> &inpc = core->get_input_units();
+    const vector<nsat_unit> &nsatc = core->get_nsat_units();
+    string input_type = static_cast<string>(sim_p.input_type);
+
+    transform(input_type.begin(), input_type.end(), input_type.begin(),
+              ::tolower);
+    if (input_type != "poisson") { throw 8; }
+    if (inpc.size() != num_inputs || nsatc.size() != num_nsat) { throw 7; }
+    check_groups<0>(inpc, nsatc);
+
+    if (core->get_projections().empty()) { core->read_connexions(); }
+    projs = core->get_projections();
+    if (projs.size() != num_projs) { throw 6; }
+
+    this->core = core;
+    seed = core->get_carlsim_params().random_seed;
+    num_steps = sim_p.sim_time_sec * 1000 + sim_p.sim_time_msec;
+    sim_step = 0;
+    results_dir = "results";
+    spk = spk_buf[0];
+    spk_prev = spk_buf[1];
+}
+
+
+/***************************************************************************
+ * STATIC_CORE CHECK_GROUPS - This method checks the parsed group G (and
+ * the next ones) against its description and keeps its name, its start,
+ * and its rates (input group) or its parameters (NSAT group).
+ *
+ * Args:
+ * -----
+ *  inpc (vector<input_unit>) : Parsed input groups.
+ *  nsatc (vector<nsat_unit>) : Parsed NSAT groups.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  29 : Not a valid group (size, neuron type or update terms).
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int G>
+typename enable_if<(G < static_core<INPUTS, NSATS, PROJS>::num_inputs)>::type
+static_core<INPUTS, NSATS, PROJS>::check_groups(const vector<input_unit> &inpc,
+                                                const vector<nsat_unit> &nsatc) {
+    typedef group<G> desc;
+    const input_unit &u = inpc[G];
+
+    if (u.num_neurons != desc::size || u.unit_type != desc::type ||
+        u.mflag != static_cast<bool>(desc::monitor)) { throw 29; }
+    for (int n = 0; n < desc::size; ++n)
+        input_p[start<G>::value + n] = u.spkg_p.rate / 1000.0;
+    names.push_back(u.unit_name);
+    grp_start[G] = start<G>::value;
+    grp_start[G+1] = start<G>::value + desc::size;
+    monitor[G] = desc::monitor;
+    check_groups<G+1>(inpc, nsatc);
+}
+
+
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int G>
+typename enable_if<(G >= static_core<INPUTS, NSATS, PROJS>::num_inputs &&
+                    G < static_core<INPUTS, NSATS, PROJS>::num_groups)>::type
+static_core<INPUTS, NSATS, PROJS>::check_groups(const vector<input_unit> &inpc,
+                                                const vector<nsat_unit> &nsatc) {
+    typedef group<G> desc;
+    const nsat_unit &u = nsatc[G - num_inputs];
+    const nsat &p = u.nsat_p;
+
+    if (u.num_neurons != desc::size || u.unit_type != desc::type ||
+        u.mflag != static_cast<bool>(desc::monitor)) { throw 29; }
+    if ((p.sigma != 0.0) != static_cast<bool>(desc::noise) ||
+        (p.b != 0.0) != static_cast<bool>(desc::bias) ||
+        (p.tau_ref > 0) != static_cast<bool>(desc::refrac)) { throw 29; }
+    params[G - num_inputs] = p;
+    names.push_back(u.unit_name);
+    grp_start[G] = start<G>::value;
+    grp_start[G+1] = start<G>::value + desc::size;
+    monitor[G] = desc::monitor;
+    check_groups<G+1>(inpc, nsatc);
+}
+
+
+/***************************************************************************
+ * STATIC_CORE BUILD_PROJECTIONS - This method checks projection P (and
+ * the next ones) against its description and converts its dense weights
+ * to the fixed-size CSR (only nonzero weights are synapses, signed by
+ * the source's type). The number of synapses has to be the one of the
+ * description. The skip sampling rate of its blankout is precomputed as
+ * in batch mode.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6 : Mismatch between projections and description (groups, number
+ *      of synapses, blankout or per-synapse blankout probabilities).
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int P>
+typename enable_if<(P < static_core<INPUTS, NSATS, PROJS>::num_projs)>::type
+static_core<INPUTS, NSATS, PROJS>::build_projections() {
+    typedef typename static_at<P, PROJS>::type desc;
+    typedef group<desc::src> src;
+    typedef group<desc::dest> dest;
+    static_assert(desc::dest >= num_inputs && desc::dest < num_groups,
+                  "the destination of a projection must be a NSAT group");
+    const projection &p = projs[P];
+    auto &c = get<P>(connx);
+    unsigned int inh_mask = ((1 << 3) | (1 << 4));
+    float sign = (src::type & inh_mask) ? -1.0 : 1.0;
+
+    if (p.src_name != names[desc::src] || p.dest_name != names[desc::dest] ||
+        p.src_input != (desc::src < num_inputs) ||
+        p.num_pre != src::size || p.num_post != dest::size ||
+        (p.prob > 0.0) != static_cast<bool>(desc::blankout) ||
+        p.prob_flag == 5) { throw 6; }
+
+    // Count first: the arrays only hold the described synapses
+    int k = 0;
+    for (int i = 0; i < src::size; ++i)
+        for (int j = 0; j < dest::size; ++j)
+            if (fabsf(p.wt[i][j]) > 0.0f) k++;
+    if (k != desc::nnz) { throw 6; }
+
+    k = 0;
+    c.row_ptr[0] = 0;
+    for (int i = 0; i < src::size; ++i) {
+        for (int j = 0; j < dest::size; ++j) {
+            if (fabsf(p.wt[i][j]) > 0.0f) {
+                c.col_idx[k] = j;
+                c.wt[k++] = sign * p.wt[i][j];
+            }
+        }
+        c.row_ptr[i+1] = k;
+    }
+
+    bool d = (p.prob <= 1.0 - p.prob);
+    float q = d ? p.prob : 1.0 - p.prob;
+    drop[P] = d;
+    lq[P] = log1pf(-q);
+    build_projections<P+1>();
+}
+
+
+/***************************************************************************
+ * STATIC_CORE RESET_STATE - This method resets the neurons state (NSAT
+ * neurons start from their reset potential), the spike counts and the
+ * recordings for a new run from step 0.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+void static_core<INPUTS, NSATS, PROJS>::reset_state() {
+    fill(v, v + num_neurons, 0.0f);
+    fill(isyn, isyn + num_neurons, 0.0f);
+    fill(isyn_in, isyn_in + num_neurons, 0.0f);
+    fill(ref, ref + num_neurons, 0);
+    memset(spk_buf, 0, sizeof(spk_buf));
+    for (int g = 0; g < num_nsat; ++g)
+        fill(v + grp_start[num_inputs+g], v + grp_start[num_inputs+g+1],
+             params[g].v_reset);
+    fill(num_spikes, num_spikes + num_groups, 0);
+    for (auto &rec : records) rec.clear();
+    sim_step = 0;
+}
+
+
+/***************************************************************************
+ * STATIC_CORE GENERATE_INPUTS - This method emits the spikes of input
+ * group G (and of the next ones) at step t: each neuron spikes with
+ * probability rate/1000.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int G>
+typename enable_if<(G < static_core<INPUTS, NSATS, PROJS>::num_inputs)>::type
+static_core<INPUTS, NSATS, PROJS>::generate_inputs(int t) {
+    const int first = start<G>::value;
+    uint32_t stream = RNG_STREAM(RNG_POISSON, G);
+
+    for (int n = 0; n < group<G>::size; ++n)
+        spk[first+n] = (rng_uniform1(stream, n, t, seed) < input_p[first+n]);
+    generate_inputs<G+1>(t);
+}
+
+
+/***************************************************************************
+ * STATIC_CORE DELIVER_PROJECTIONS - This method accumulates the synaptic
+ * inputs of step t (spikes of the previous step) through projection P
+ * (and the next ones). Blanked out projections are skip sampled exactly
+ * as in batch mode (see batch_core::deliver_skip).
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int P>
+typename enable_if<(P < static_core<INPUTS, NSATS, PROJS>::num_projs)>::type
+static_core<INPUTS, NSATS, PROJS>::deliver_projections(int t) {
+    typedef typename static_at<P, PROJS>::type desc;
+    const auto &c = get<P>(connx);
+    const unsigned char *s = &spk_prev[start<desc::src>::value];
+    float *in = &isyn_in[start<desc::dest>::value];
+    uint32_t stream = RNG_STREAM(RNG_SKIP, P);
+
+    for (int i = 0; i < group<desc::src>::size; ++i) {
+        if (s[i] == 0) continue;
+        int k0 = c.row_ptr[i], len = c.row_ptr[i+1] - k0;
+
+        if (!desc::blankout) {
+            for (int k = k0; k < k0 + len; ++k) in[c.col_idx[k]] += c.wt[k];
+            continue;
+        }
+
+        // Skip sampling: the next uniform number of the sequence
+        float u[8];
+        int used = 8;
+        uint32_t first = 0;
+        auto next = [&]() -> float {
+            if (used == 8) {
+                rng_uniform_seq(stream, i, seed, t, first, 8, u);
+                first += 8;
+                used = 0;
+            }
+            return u[used++];
+        };
+
+        int pos = rng_geometric(next(), lq[P], len);
+        if (drop[P]) {
+            for (int j = 0; j < len; ++j) {
+                if (j == pos) {
+                    pos = j + 1 + rng_geometric(next(), lq[P], len);
+                    continue;
+                }
+                in[c.col_idx[k0+j]] += c.wt[k0+j];
+            }
+        } else {
+            for (int j = pos; j < len; j += 1 + rng_geometric(next(), lq[P], len))
+                in[c.col_idx[k0+j]] += c.wt[k0+j];
+        }
+    }
+    deliver_projections<P+1>(t);
+}
+
+
+/***************************************************************************
+ * STATIC_CORE UPDATE_GROUPS - This method updates the neurons of NSAT
+ * group G (and of the next ones) for step t (see batch_core.h for the
+ * model), starting from the first NSAT group (num_inputs). The noise,
+ * bias and refractory terms of a group are compiled in only if its
+ * description has them.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int G>
+typename enable_if<(G >= static_core<INPUTS, NSATS, PROJS>::num_inputs &&
+                    G < static_core<INPUTS, NSATS, PROJS>::num_groups)>::type
+static_core<INPUTS, NSATS, PROJS>::update_groups(int t) {
+    typedef group<G> desc;
+    const nsat &p = params[G - num_inputs];
+    const int first = start<G>::value;
+    uint32_t stream = RNG_STREAM(RNG_NOISE, G - num_inputs);
+
+    for (int n = first; n < first + desc::size; ++n) {
+        float vn;
+
+        isyn[n] = p.alphaS * isyn[n] + isyn_in[n];
+
+        // Refractory period
+        if (desc::refrac && ref[n] > 0) {
+            ref[n]--;
+            v[n] = p.v_reset;
+            spk[n] = 0;
+            continue;
+        }
+
+        vn = p.alpha * v[n] + p.beta * isyn[n];
+        if (desc::bias) vn += p.b;
+        if (desc::noise) vn += p.sigma * rng_normal1(stream, n - first, t, seed);
+
+        if (vn >= p.v_th) {
+            spk[n] = 1;
+            vn = p.v_reset;
+            if (desc::refrac) ref[n] = p.tau_ref;
+        } else {
+            spk[n] = 0;
+        }
+        v[n] = vn;
+    }
+    update_groups<G+1>(t);
+}
+
+
+/***************************************************************************
+ * STATIC_CORE RECORD_GROUPS - This method counts the spikes of group G
+ * (and of the next ones) at step t and records them if the group is
+ * monitored.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+template<int G>
+typename enable_if<(G < static_core<INPUTS, NSATS, PROJS>::num_groups)>::type
+static_core<INPUTS, NSATS, PROJS>::record_groups(int t) {
+    const int first = start<G>::value;
+
+    for (int n = 0; n < group<G>::size; ++n) {
+        if (spk[first+n] == 0) continue;
+        num_spikes[G]++;
+        if (group<G>::monitor) {
+            records[G].push_back(t);
+            records[G].push_back(n);
+        }
+    }
+    record_groups<G+1>(t);
+}
+
+
+/***************************************************************************
+ * STATIC_CORE STEP - This method simulates step t: input spikes, synaptic
+ * inputs (spikes of step t-1), NSAT neurons and recordings.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+void static_core<INPUTS, NSATS, PROJS>::step(int t) {
+    swap(spk, spk_prev);
+    generate_inputs<0>(t);
+    fill(isyn_in + num_input_neurons, isyn_in + num_neurons, 0.0f);
+    deliver_projections<0>(t);
+    update_groups<num_inputs>(t);
+    record_groups<0>(t);
+}
+
+
+/***************************************************************************
+ * STATIC_CORE RUN - This method simulates a number of steps from the
+ * current one (without writing the spike files).
+ *
+ * Args:
+ * -----
+ *  steps (int) : Number of steps (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+void static_core<INPUTS, NSATS, PROJS>::run(int steps) {
+    for (int t = sim_step; t < sim_step + steps; ++t) step(t);
+    sim_step += steps;
+}
+
+
+/***************************************************************************
+ * STATIC_CORE WRITE_SPIKES - This method writes the recorded spikes of
+ * every monitored group to results_dir/spk<group name>.dat, in the format
+ * of the batch mode spike files.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if all the files are succesfully written, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write results file.
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+int static_core<INPUTS, NSATS, PROJS>::write_spikes() {
+    int signature = 206661989;
+    float version = 0.2;
+
+    make_dirs(results_dir);
+    for (int g = 0; g < num_groups; ++g) {
+        if (!monitor[g]) continue;
+        int grid[3] = {grp_start[g+1] - grp_start[g], 1, 1};
+
+        ofstream out(results_dir + "/spk" + names[g] + ".dat", ios::binary);
+        if (!out) { throw 15; }
+        out.write((char *) &signature, sizeof(int));
+        out.write((char *) &version, sizeof(float));
+        out.write((char *) grid, 3 * sizeof(int));
+        out.write((char *) records[g].data(), records[g].size() * sizeof(int));
+        out.close();
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * STATIC_CORE S_SETUP_STATE - This method builds the fixed-size
+ * projections and resets the state.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, if the network is succesfully built,
+ *  otherwise the exception's code (see nsat_core::error).
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+int static_core<INPUTS, NSATS, PROJS>::s_setup_state() {
+    int flag = 0;
+
+    try {
+        build_projections<0>();
+        projs.clear();
+        reset_state();
+    }
+    catch (int &e) {
+        flag = core->error(e);
+    }
+    return flag;
+}
+
+
+/***************************************************************************
+ * STATIC_CORE S_RUN_STATE - This method simulates sim_time_sec seconds
+ * and sim_time_msec ms from the current step and writes the spike files
+ * of the run.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, when the network has been simulated
+ *  successfully, otherwise the exception's code (see nsat_core::error).
+ ***************************************************************************/
+template<typename INPUTS, typename NSATS, typename PROJS>
+int static_core<INPUTS, NSATS, PROJS>::s_run_state() {
+    int flag = 0;
+
+    try {
+        for (auto &rec : records) rec.clear();
+        run(num_steps);
+        flag = write_spikes();
+    }
+    catch (int &e) {
+        flag = core->error(e);
+    }
+    return flag;
+}
+
+
+/***************************************************************************
+ * STATIC_DESCRIBE - This function generates the compile-time description
+ * (see static_input, static_nsat and static_projection) of a network
+ * parsed by a NSAT Core, as a typedef of static_core: the groups sizes,
+ * neuron types and update terms, and the number of synapses (nonzero
+ * weights) and the blankout of every projection.
+ *
+ * Args:
+ * -----
+ *  core (nsat_core *) : A pointer to a NSAT Core instance.
+ *  name (string)      : Name of the typedef.
+ *
+ * Returns:
+ * --------
+ *  The description (C++ source).
+ *
+ * Exceptions:
+ * -----------
+ *  6 : Mismatch between group names (projections).
+ ***************************************************************************/
+inline string static_describe(nsat_core *core, const string &name) {
+    const vector<input_unit> &inpc = core->get_input_units();
+    const vector<nsat_unit> &nsatc = core->get_nsat_units();
+    vector<string> names;
+    string out = "typedef static_core<\n";
+    char buf[256];
+
+    auto type_name = [](unsigned int type) -> string {
+        if (type == EXCITATORY_NEURON) return "EXCITATORY_NEURON";
+        if (type == INHIBITORY_NEURON) return "INHIBITORY_NEURON";
+        return to_string(type);
+    };
+    auto item = [&](int k, int n, const string &desc, const string &note) {
+        snprintf(buf, sizeof(buf), "    %s%s%s",
+                 k ? "            " : "static_list<", desc.c_str(),
+                 (k == n - 1) ? ">," : ",");
+        out += buf;
+        out += string(max<int>(1, 60 - strlen(buf)), ' ') + "// " + note + "\n";
+    };
+
+    for (auto &u : inpc) names.push_back(u.unit_name);
+    for (auto &u : nsatc) names.push_back(u.unit_name);
+
+    if (inpc.empty()) out += "    static_list<>,\n";
+    for (int k = 0; k < inpc.size(); ++k) {
+        const input_unit &u = inpc[k];
+        snprintf(buf, sizeof(buf), "static_input<%d, %s, %s>",
+                 u.num_neurons, type_name(u.unit_type).c_str(),
+                 u.mflag ? "true" : "false");
+        item(k, inpc.size(), buf, to_string(k) + ": " + u.unit_name);
+    }
+    if (nsatc.empty()) out += "    static_list<>,\n";
+    for (int k = 0; k < nsatc.size(); ++k) {
+        const nsat_unit &u = nsatc[k];
+        const nsat &p = u.nsat_p;
+        snprintf(buf, sizeof(buf), "static_nsat<%d, %s, %s, %s, %s, %s>",
+                 u.num_neurons, type_name(u.unit_type).c_str(),
+                 (p.sigma != 0.0) ? "true" : "false",
+                 (p.b != 0.0) ? "true" : "false",
+                 (p.tau_ref > 0) ? "true" : "false",
+                 u.mflag ? "true" : "false");
+        item(k, nsatc.size(), buf,
+             to_string(inpc.size() + k) + ": " + u.unit_name);
+    }
+
+    if (core->get_projections().empty()) { core->read_connexions(); }
+    const vector<projection> &projs = core->get_projections();
+    if (projs.empty()) out += "    static_list<>,\n";
+    for (int k = 0; k < projs.size(); ++k) {
+        const projection &p = projs[k];
+        int src = find(names.begin(), names.end(), p.src_name) -
+                  names.begin();
+        int dest = find(names.begin(), names.end(), p.dest_name) -
+                   names.begin();
+        if (src == names.size() || dest == names.size()) { throw 6; }
+
+        int nnz = 0;
+        for (auto &row : p.wt)
+            for (auto w : row)
+                if (fabsf(w) > 0.0f) nnz++;
+        snprintf(buf, sizeof(buf), "static_projection<%d, %d, %d, %s>",
+                 src, dest, nnz, (p.prob > 0.0) ? "true" : "false");
+        item(k, projs.size(), buf, p.src_name + " -> " + p.dest_name);
+    }
+    // The last list closes without a comma
+    size_t last = out.rfind(">,");
+    out.replace(last, 2, "> ");
+    return out + "> " + name + ";\n";
+}
+
+#endif // _STATIC_CORE_H
@@ -0,0 +1,101 @@
+#ifndef _SWEEP_CORE_H
+#define _SWEEP_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "nsat_core.h"
+#include "config_core.h"
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Sweep axis struct
+ * ----------------------------------*/
+typedef struct sweep_axis_s {
+    string target;          // nsat or stdp
+    string group;           // NSAT group's name
+    string param;           // parameter's name
+    vector<float> values;   // values of the parameter
+} sweep_axis;
+
+
+/* ----------------------------------
+ * Sweep job result struct
+ * ----------------------------------*/
+typedef struct sweep_result_s {
+    int job_id;             // job's index
+    int status;             // 0 on success, exception number otherwise
+    double wall_time;       // job's wall time (s)
+} sweep_result;
+
+
+/***************************************************************************
+ * SWEEP Class - This class runs a parameter sweep over the NSAT and STDP
+ * parameters of a base configuration using a pool of worker processes.
+ * The connections files are parsed once by the parent process, before
+ * forking, so the workers share the parsed projections (copy-on-write
+ * pages that are only read). Each job builds its own NSAT Core with the
+ * overridden parameters and writes its spike files in
+ * out_dir/job_<id>/.
+ *
+ * The sweep file holds a mode line (grid: cartesian product of all the
+ * axes, list: i-th job takes the i-th value of every axis) and one line
+ * per axis, e.g.
+ *
+ *      # target  group     param      values
+ *      mode      grid
+ *      nsat      excitat   alpha      0.8 0.9 0.95
+ *      stdp      excitat   alphaPlus  0.05 0.1
+ *
+ * Attributes:
+ *      - base : Base configuration.
+ *      - mode : grid or list.
+ *      - axes : Sweep axes.
+ *      - num_jobs : Number of jobs.
+ *      - out_dir : Output directory.
+ *      - shared : Projections parsed once by the parent process.
+ *      - results : Results of all the jobs.
+ *
+ * Methods:
+ *      - sweep_core : SWEEP constructor.
+ *      - load_sweep : Reads a sweep file.
+ *      - job_values : Values of all the axes for a job.
+ *      - run_job : Runs one job (in a worker).
+ *      - worker : Worker process loop.
+ *      - write_index : Writes out_dir/index.dat.
+ *      - run : Runs all the jobs on a pool of workers.
+ *
+ ***************************************************************************/
+class sweep_core {
+    private:
+        config_core base;
+        string mode;
+        vector<sweep_axis> axes;
+        int num_jobs;
+        string out_dir;
+
+        vector<projection> shared;
+        vector<sweep_result> results;
+
+    public:
+        sweep_core(const config_core &, const string &);
+
+        int load_sweep(const string &);
+        vector<float> job_values(int);
+        int run_job(int);
+        void worker(int, int);
+        int write_index();
+        int run(int, int);
+};
+
+#endif // _SWEEP_CORE_H
@@ -0,0 +1,141 @@
+#ifndef _TIMER_CORE_H
+#define _TIMER_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "trace_core.h"
+#include "memory_core.h"
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Phase timing record struct
+ * ----------------------------------*/
+typedef struct phase_record_s {
+    string name;            // phase's name
+    int parent;             // index of the enclosing phase (-1: top level)
+    int depth;              // nesting level (0: top level)
+    int calls;              // number of times the phase was entered
+    double wall;            // wall time (s, monotonic clock)
+    double cpu;             // CPU time of the calling thread (s)
+    int64_t bytes;          // bytes parsed within the phase
+    int64_t synapses;       // synapses created within the phase
+    int64_t rss;            // resident set size at the end (bytes)
+    int64_t rss_delta;      // growth of the resident set within (bytes)
+    int64_t peak_rss;       // peak resident set size within (bytes)
+} phase_record;
+
+
+/***************************************************************************
+ * TIMER Class - This class measures the phases of a simulation (loading
+ * the parameters, building the network, running it etc). Phases nest:
+ * BEGIN opens a phase inside the current one and END closes it. The wall
+ * time comes from a monotonic clock and the CPU time is the one of the
+ * calling thread, so concurrent instances do not count each other's
+ * work. The bytes parsed and synapses created are counted by the
+ * innermost open phase and added to its parents when it is closed. A
+ * phase entered several times (e.g. one run per trial) keeps one record
+ * with the sum of its times.
+ *
+ * The timer is off unless it is enabled (ENABLE) or the environment
+ * variable NSAT_TIMING is set (1: timing, mem: timing and memory). The
+ * resident set size is only sampled when memory reporting is enabled
+ * too (ENABLE_MEMORY): once when a phase begins and once when it ends,
+ * which gives its growth within the phase. The process' high-water mark
+ * is never reset (see memory_core.h): if it grew within the phase it is
+ * the phase's peak, otherwise the peak is the larger of the two samples.
+ *
+ * A disabled timer only tests a flag in BEGIN, END and the counters.
+ * While event tracing is on (see trace_core.h), every phase is also
+ * recorded as a trace event, whether the timer is enabled or not.
+ *
+ * Attributes:
+ *      - enabled : True if phases are measured.
+ *      - memory : True if the resident set size is sampled too.
+ *      - records : Phases, in the order they were first entered.
+ *      - open : Stack of the open phases (indices into records).
+ *      - wall0, cpu0 : Start times of the open phases.
+ *      - bytes0, syn0 : Counts of the open phases when they were entered.
+ *      - rss0, hwm0 : Resident set size and process high-water mark
+ *                     when the open phases were entered.
+ *      - traced : Names and trace start times of the open phases (-1 if
+ *                 tracing was off when they were entered).
+ *
+ * Methods:
+ *      - timer_core : TIMER constructor (enabled from the environment
+ *                     variable NSAT_TIMING, if set).
+ *      - enable : Enables or disables the timer.
+ *      - is_enabled : Returns true if the timer is enabled.
+ *      - enable_memory : Enables or disables the memory sampling.
+ *      - is_memory_enabled : Returns true if the memory is sampled.
+ *      - begin : Opens a phase.
+ *      - end : Closes the innermost open phase.
+ *      - add_bytes : Counts bytes parsed in the current phase.
+ *      - add_synapses : Counts synapses created in the current phase.
+ *      - clear : Removes all the records.
+ *      - get_records : Returns the records.
+ *      - total : Wall time of all the phases with a given name.
+ *      - to_json : Returns the records as a JSON array.
+ *      - print : Prints the records as a table.
+ *      - wall_time, cpu_time : Monotonic wall and thread CPU clocks (s).
+ *
+ ***************************************************************************/
+class timer_core {
+    private:
+        bool enabled;
+        bool memory;
+        vector<phase_record> records;
+        vector<int> open;
+        vector<double> wall0, cpu0;
+        vector<int64_t> bytes0, syn0, rss0, hwm0;
+        vector<pair<string, double>> traced;
+
+    public:
+        timer_core();
+
+        void enable(bool);
+        bool is_enabled() const { return enabled; }
+        void enable_memory(bool on) { memory = on; }
+        bool is_memory_enabled() const { return memory; }
+
+        void begin(const string &);
+        void end();
+        void add_bytes(int64_t n) {
+            if (enabled && !open.empty()) records[open.back()].bytes += n;
+        }
+        void add_synapses(int64_t n) {
+            if (enabled && !open.empty()) records[open.back()].synapses += n;
+        }
+        void clear();
+
+        const vector<phase_record> &get_records() const { return records; }
+        double total(const string &) const;
+        string to_json() const;
+        void print(ostream &) const;
+
+        static double wall_time();
+        static double cpu_time();
+};
+
+
+/***************************************************************************
+ * TIMER_SCOPE Class - Opens a phase of a timer for the lifetime of the
+ * object, so the phase is closed on exceptions too.
+ ***************************************************************************/
+class timer_scope {
+    private:
+        timer_core &timer;
+
+    public:
+        timer_scope(timer_core &t, const string &name) : timer(t) {
+            timer.begin(name);
+        }
+        ~timer_scope() { timer.end(); }
+};
+
+#endif // _TIMER_CORE_H
@@ -0,0 +1,93 @@
+#ifndef _TRACE_CORE_H
+#define _TRACE_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Trace event struct
+ * ----------------------------------*/
+typedef struct trace_event_s {
+    string name;            // event's name
+    string detail;          // optional argument (e.g. a file name)
+    char ph;                // phase: 'X' (complete) or 'i' (instant)
+    double ts;              // start time (us since the trace start)
+    double dur;             // duration (us, complete events)
+} trace_event;
+
+
+/* ----------------------------------
+ * Per-thread events buffer struct
+ * ----------------------------------*/
+typedef struct trace_buffer_s {
+    int tid;                // thread's index (order of the first event)
+    vector<trace_event> events;
+} trace_buffer;
+
+
+/***************************************************************************
+ * Event tracing in the Chrome trace-event format (JSON), which can be
+ * loaded in chrome://tracing or the Perfetto UI. Tracing starts with
+ * trace_start (or when the environment variable NSAT_TRACE names the
+ * output file) and the events are written by trace_stop, which is also
+ * registered to run at exit.
+ *
+ * Every thread records its events into its own buffer, so recording takes
+ * no lock: only the first event of a thread registers its buffer (under
+ * a mutex). The buffers are written by trace_stop, after the traced
+ * threads are done. A disabled trace costs one relaxed atomic load per
+ * event.
+ *
+ * Functions:
+ *      - trace_start : Starts tracing into a file.
+ *      - trace_stop : Writes the recorded events and stops tracing.
+ *      - trace_enabled : Returns true while tracing.
+ *      - trace_now : Time since the trace start (us).
+ *      - trace_complete : Records a complete event (start and duration).
+ *      - trace_instant : Records an instant event.
+ *
+ ***************************************************************************/
+extern atomic<bool> trace_on;
+
+void trace_start(const string &);
+int trace_stop();
+double trace_now();
+void trace_complete(const string &, double, double, const string & = "");
+void trace_instant(const string &, const string & = "");
+
+static inline bool trace_enabled() {
+    return trace_on.load(memory_order_relaxed);
+}
+
+
+/***************************************************************************
+ * TRACE_SCOPE Class - Records a complete event spanning the lifetime of
+ * the object (nothing if tracing is off when it is created).
+ ***************************************************************************/
+class trace_scope {
+    private:
+        const char *name;
+        string detail;
+        double t0;
+
+    public:
+        trace_scope(const char *n, const string &d = "") : name(NULL) {
+            if (trace_enabled()) {
+                name = n;
+                detail = d;
+                t0 = trace_now();
+            }
+        }
+        ~trace_scope() {
+            if (name) trace_complete(name, t0, trace_now() - t0, detail);
+        }
+};
+
+#endif // _TRACE_CORE_H
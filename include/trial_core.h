@@ -0,0 +1,88 @@
+#ifndef _TRIAL_CORE_H
+#define _TRIAL_CORE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "nsat_core.h"
+
+
+using namespace std;
+
+
+/* ----------------------------------
+ * Trial struct
+ * ----------------------------------*/
+typedef struct trial_s {
+    int trial_id;           // trial's index
+    int seed;               // random seed of the trial
+    vector<float> rates;    // Poisson rates, one per input group (optional)
+} trial;
+
+
+/* ----------------------------------
+ * Trial result struct
+ * ----------------------------------*/
+typedef struct trial_result_s {
+    int trial_id;           // trial's index
+    int status;             // 0 on success, exception number otherwise
+    double startup;         // time from fork() to the run state (s)
+    double wall_time;       // trial's wall time (s)
+} trial_result;
+
+
+/***************************************************************************
+ * TRIAL Class - This class runs many trials of a network that has been
+ * configured and set up once (c_config_state and c_setup_state) by the
+ * parent process. Each trial is a fork()ed child, which shares all the
+ * connectivity pages copy-on-write with the parent and starts directly
+ * from the run state with its own input rates and random seed. At most
+ * max_children children run at the same time.
+ *
+ * CARLsim draws its CPU random numbers from drand48, so each child
+ * reseeds it (srand48) with the trial's seed. Since a CUDA context cannot
+ * be shared by fork()ed processes, only CPU_MODE networks are allowed.
+ *
+ * The trials file holds one line per trial: its seed followed by an
+ * optional rate (Hz) per input group, e.g.
+ *
+ *      # seed  rate_group_0  rate_group_1
+ *      42      50.0          20.0
+ *      43      40.0          20.0
+ *
+ * Attributes:
+ *      - core : A pointer to the set up NSAT Core (owned by the caller).
+ *      - trials : Trials to run.
+ *      - out_dir : Output directory (trials write in out_dir/trial_<id>/).
+ *      - results : Results of all the trials.
+ *
+ * Methods:
+ *      - trial_core : TRIAL constructor.
+ *      - load_trials : Reads a trials file.
+ *      - add_trial : Appends a trial.
+ *      - run_trial : Runs one trial (in a child).
+ *      - run : Forks one child per trial.
+ *
+ ***************************************************************************/
+class trial_core {
+    private:
+        nsat_core *core;
+        vector<trial> trials;
+        string out_dir;
+        vector<trial_result> results;
+
+    public:
+        trial_core(nsat_core *, const string &);
+
+        int load_trials(const string &);
+        void add_trial(int, const vector<float> &);
+        int run_trial(const trial &);
+        int run(int);
+};
+
+#endif // _TRIAL_CORE_H
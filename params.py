@@ -37,6 +37,18 @@ class spkg(Structure):
                 ('on_gpu', c_bool)]
 
 
+# Layout of the C++ nsat struct (NSAT_Core_AddNSATGroups)
+class nsat_params(Structure):
+    _fields_ = [('alpha', c_float),
+                ('beta', c_float),
+                ('sigma', c_float),
+                ('v_th', c_float),
+                ('v_reset', c_float),
+                ('alphaS', c_float),
+                ('b', c_float),
+                ('tau_ref', c_int)]
+
+
 class KeepRefs(object):
     __refs__ = defaultdict(list)
     def __init__(self):
@@ -5,6 +5,11 @@
  * NSAT_CORE Auxiliary Functions
  ***************************************************************************/
 
+// CARLsim's CPU random numbers come from drand48, whose state is process-
+// wide: this mutex guards the library's own reads and writes of it
+// (seed48, srand48) against each other. CARLsim's draws are not guarded.
+mutex drand48_mutex;
+
 
 /***************************************************************************
  * str2bool - Converts a string to a bool.
@@ -100,90 +105,232 @@ stdpType_t str2stdpt(string str) {
 
 
 /***************************************************************************
- * print_exceptions - This function writes to the standard output an 
- * error message depending on the number of exception it receives as input.
+ * make_dirs - This function creates a directory and all its missing 
+ * parent directories (like mkdir -p). Existing directories are left 
+ * untouched. 
  *
  * Args:
  * -----
- *  e (int) : An integer that indicates the exception.
- *  ...     : Can receive two more inputs. The number of line of the input
- *            file, where an issue has been detected by the handler function
- *            and/or the name of the input file. 
+ *  path (string) : Directory path.
  *
  * Returns:
  * --------
- *  Void 
+ *  Void
  ***************************************************************************/
-void print_exceptions(int e, ...) {
+void make_dirs(string path) {
+    size_t pos = 0;
+
+    while ((pos = path.find('/', pos + 1)) != string::npos) {
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+    mkdir(path.c_str(), 0755);
+}
+
+
+/***************************************************************************
+ * set_nsat_param - Sets a parameter of a NSAT parameters struct by name.
+ *
+ * Args:
+ * -----
+ *  p (nsat &)     : NSAT parameters struct.
+ *  param (string) : Parameter's name (alpha, beta, sigma, v_th, v_reset,
+ *                   alphaS, b, tau_ref).
+ *  value (float)  : New value.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  17 : Not a valid parameter name.
+ ***************************************************************************/
+void set_nsat_param(nsat &p, const string &param, float value) {
+    if (param == "alpha") p.alpha = value;
+    else if (param == "beta") p.beta = value;
+    else if (param == "sigma") p.sigma = value;
+    else if (param == "v_th") p.v_th = value;
+    else if (param == "v_reset") p.v_reset = value;
+    else if (param == "alphaS") p.alphaS = value;
+    else if (param == "b") p.b = value;
+    else if (param == "tau_ref") p.tau_ref = static_cast<int>(value);
+    else throw 17;
+}
+
+
+/***************************************************************************
+ * Writes the error message of an exception to a stream (va_list form of
+ * log_exceptions).
+ ***************************************************************************/
+static void vlog_exceptions(ostream &out, int e, va_list args) {
     int tmp_int;
     char *tmp_str;
-    va_list args;
-
-    va_start(args, e);
 
     switch(e) {
         case 2:
             tmp_int = va_arg(args, int);
             tmp_str = va_arg(args, char *);
-            cout << "Exception 2: Not valid parameters found at line [" 
+            out << "Exception 2: Not valid parameters found at line [" 
                  << tmp_int << "] in file [" << static_cast<string>(tmp_str)
                  << "]" << endl;
             break;
         case 5: 
-            cout << "Exception 5: Failed to deallocate memory!" << endl;
+            out << "Exception 5: Failed to deallocate memory!" << endl;
             break;
         case 6:
-            cout << "Exception 6: Mismatch between group names (connections)!" << endl;
+            out << "Exception 6: Mismatch between group names (connections)!" << endl;
             break;
         case 7:
-            cout << "Exception 7: Not a valid number of neural groups/layers!" << endl;
+            out << "Exception 7: Not a valid number of neural groups/layers!" << endl;
             break;
         case 8:
-            cout << "Exception 8: Not a valid input type!" << endl;
+            out << "Exception 8: Not a valid input type!" << endl;
             break;
         case 9:
-            cout << "Exception 9: Mismatch of file lines and number of neurons!" << endl;
+            out << "Exception 9: Mismatch of file lines and number of neurons!" << endl;
             break;
         case 10:
-            cout << "Exception 10: Missing blankout probability!" << endl;
+            out << "Exception 10: Missing blankout probability!" << endl;
             break;
         case 11:
-            cout << "Exception 11: Wrong group/type in STDP parameters file!" << endl;
+            out << "Exception 11: Wrong group/type in STDP parameters file!" << endl;
             break;
         case 12:
-            cout << "Exception 12: Missing parameters in STDP parameters file!" << endl;
+            out << "Exception 12: Missing parameters in STDP parameters file!" << endl;
+            break;
+        case 13:
+            out << "Exception 13: Not a valid batch size!" << endl;
+            break;
+        case 14:
+            out << "Exception 14: Input type not supported in batch mode!" << endl;
+            break;
+        case 15:
+            out << "Exception 15: Cannot write results file!" << endl;
+            break;
+        case 16:
+            out << "Exception 16: Missing spike trains for input groups!" << endl;
+            break;
+        case 17:
+            out << "Exception 17: Not a valid parameter name!" << endl;
+            break;
+        case 18:
+            out << "Exception 18: Cannot open configuration/sweep file!" << endl;
+            break;
+        case 19:
+            out << "Exception 19: Not a valid sweep (mode, target or values)!" << endl;
+            break;
+        case 20:
+            out << "Exception 20: Cannot create worker process!" << endl;
+            break;
+        case 21:
+            out << "Exception 21: Forked trials need CPU mode!" << endl;
+            break;
+        case 22:
+            out << "Exception 22: Cannot read/write checkpoint file!" << endl;
+            break;
+        case 23:
+            out << "Exception 23: Not a valid (or compatible) checkpoint file!" << endl;
+            break;
+        case 24:
+            out << "Exception 24: Mismatch between input size and number of neurons!" << endl;
+            break;
+        case 25:
+            out << "Exception 25: Not allowed in the current simulation state!" << endl;
+            break;
+        case 26:
+            out << "Exception 26: Cannot read input spike file!" << endl;
+            break;
+        case 27:
+            out << "Exception 27: STDP mode/curve not supported in batch mode!" << endl;
+            break;
+        case 28:
+            out << "Exception 28: Memory budget exceeded!" << endl;
+            break;
+        case 29:
+            out << "Exception 29: Not a valid group (name, size or neuron type)!" << endl;
             break;
         case 30:
             tmp_int = va_arg(args, int);
             tmp_str = va_arg(args, char *);
-            cout << "Exception 30: Too few/more parameters are given at line ["
+            out << "Exception 30: Too few/more parameters are given at line ["
                  << tmp_int << "] in file ["
                  << static_cast<string>(tmp_str) << "]" << endl;
             break;
+        case 31:
+            out << "Exception 31: Worker process died before its result!" << endl;
+            break;
         case 40:
             tmp_int = va_arg(args, int);
             tmp_str = va_arg(args, char *);
-            cout << "Exception 40: Wrong neuron type found at line ["
+            out << "Exception 40: Wrong neuron type found at line ["
                  << tmp_int << "] in file [" << static_cast<string>(tmp_str)
                  << "]" << endl;
             break;
         case 50:
-            cout << "Exception 50: Not a valid STDP curve function!" << endl;
+            out << "Exception 50: Not a valid STDP curve function!" << endl;
             break;
         case 60:
-            cout << "Exception 60: Not a valid Integration Method!" << endl;
+            out << "Exception 60: Not a valid Integration Method!" << endl;
             break;
         case 70:
-            cout << "Exception 70: Not allowed Integration Steps Size!" << endl;
+            out << "Exception 70: Not allowed Integration Steps Size!" << endl;
             break;
         case 80:
-            cout << "Exception 80: Not a valid Conductance flag!" << endl;
+            out << "Exception 80: Not a valid Conductance flag!" << endl;
             break;
         case 90:
-            cout << "Exception 100: Not a valid Dopamine Mode!" << endl;
+            out << "Exception 100: Not a valid Dopamine Mode!" << endl;
             break;
         default:
             break;
     }
+}
+
+
+/***************************************************************************
+ * log_exceptions - This function writes to a stream an error message
+ * depending on the number of exception it receives as input (see
+ * print_exceptions). Each NSAT Core instance logs its errors to its own
+ * stream.
+ *
+ * Args:
+ * -----
+ *  out (ostream &) : Output stream.
+ *  e (int) : An integer that indicates the exception.
+ *  ...     : The line number and/or the file name (see print_exceptions).
+ *
+ * Returns:
+ * --------
+ *  Void 
+ ***************************************************************************/
+void log_exceptions(ostream &out, int e, ...) {
+    va_list args;
+
+    va_start(args, e);
+    vlog_exceptions(out, e, args);
+    va_end(args);
+}
+
+
+/***************************************************************************
+ * print_exceptions - This function writes to the standard output an 
+ * error message depending on the number of exception it receives as input.
+ *
+ * Args:
+ * -----
+ *  e (int) : An integer that indicates the exception.
+ *  ...     : Can receive two more inputs. The number of line of the input
+ *            file, where an issue has been detected by the handler function
+ *            and/or the name of the input file. 
+ *
+ * Returns:
+ * --------
+ *  Void 
+ ***************************************************************************/
+void print_exceptions(int e, ...) {
+    va_list args;
+
+    va_start(args, e);
+    vlog_exceptions(cout, e, args);
     va_end(args);
 }
@@ -0,0 +1,2487 @@
+#include "batch_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * BATCH_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * BATCH_CORE Class Constructor - It copies the parameters already loaded
+ * by a NSAT Core (groups, projections and spike trains). If the NSAT Core
+ * has not parsed its connections (or STDP) files yet, they are parsed
+ * here. STDP is off by default (see SET_STDP_MODE). The random seed of
+ * the b-th instance defaults to carlsim::random_seed + b.
+ *
+ * Args:
+ * -----
+ *  core (nsat_core *) : A pointer to a NSAT Core instance.
+ *  batch (int)        : Number of instances (B).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  13 : Not a valid batch size.
+ ***************************************************************************/
+batch_core::batch_core(nsat_core *core, int batch) {
+    if (batch <= 0) { throw 13; }
+    batch_size = batch;
+
+    // Parse the connections once - they are shared by all instances
+    if (core->get_projections().empty()) { core->read_connexions(); }
+    if (core->get_stdp_units().empty()) { core->read_stdp(); }
+
+    carl_p = core->get_carlsim_params();
+    sim_p = core->get_simulation_params();
+    inpc = core->get_input_units();
+    nsatc = core->get_nsat_units();
+    projs = core->get_projections();
+    spike_trains = core->get_spike_trains();
+    stdpc = core->get_stdp_units();
+
+    input_type = static_cast<string>(sim_p.input_type);
+    transform(input_type.begin(), input_type.end(), input_type.begin(),
+              ::tolower);
+
+    num_steps = sim_p.sim_time_sec * 1000 + sim_p.sim_time_msec;
+    sim_step = 0;
+    results_dir = "results";
+    generic_kernels = false;
+    skip_blankout = true;
+    reorder = false;
+    part_id = 0;
+    from_image = false;
+    series_fp = NULL;
+    series_period = 0;
+    cur_step = run_step0 = 0;
+    run_wall0 = run_wall1 = 0.0;
+    initialize_counters();
+    stdp_mode = STDP_OFF;
+    log = &cout;
+    last_error = 0;
+
+    for (int b = 0; b < batch_size; ++b)
+        seeds.push_back(carl_p.random_seed + b);
+}
+
+
+/***************************************************************************
+ * IMAGE_VIEW - Returns a typed view of a network image section that must
+ * hold exactly count elements (see BATCH_CORE::COMPILE).
+ *
+ * Exceptions:
+ * -----------
+ *  23 : Not a valid (or not compatible) checkpoint file.
+ ***************************************************************************/
+template<typename T>
+static const T *image_view(ckpt_core &img, const string &name, size_t count) {
+    size_t n;
+    const T *ptr = img.view<T>(name, n);
+    if (n != count) { throw 23; }
+    return ptr;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE Class Constructor - It loads a network image written by 
+ * COMPILE. The image is mapped (see ckpt_core.h) and the read-only CSR
+ * arrays view it in place; only the weights (which can change) are
+ * copied. The batch is ready for B_SETUP_STATE, which then only 
+ * allocates the neurons state. The CSR arrays are validated first (rows
+ * in order, columns within the post group), as the simulation indexes
+ * them unchecked.
+ *
+ * Args:
+ * -----
+ *  path (string) : Network image file name.
+ *  batch (int)   : Number of instances (B).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  13 : Not a valid batch size.
+ *  22 : Cannot read/write checkpoint file.
+ *  23 : Not a valid (or not compatible) checkpoint file.
+ ***************************************************************************/
+batch_core::batch_core(const string &path, int batch) {
+    vector<int> meta;
+    size_t cnt;
+
+    if (batch <= 0) { throw 13; }
+    batch_size = batch;
+
+    image.open(path);
+    image.get("image_meta", meta);
+    if (meta.size() != 9) { throw 23; }
+    int n_inp = meta[0], n_nsat = meta[1], n_proj = meta[2];
+    int n_grp = n_inp + n_nsat;
+
+    memset(&carl_p, 0, sizeof(carl_p));
+    memset(&sim_p, 0, sizeof(sim_p));
+    carl_p.random_seed = meta[3];
+    sim_p.sim_time_sec = meta[4];
+    sim_p.sim_time_msec = meta[5];
+    sim_p.num_connections = n_proj;
+    sim_p.maxWt = *image_view<float>(image, "max_wt", 1);
+    stdp_mode = meta[6];
+
+    const char *type = image.view<char>("input_type", cnt);
+    input_type.assign(type, cnt);
+
+    // Groups (SoA parameters)
+    const char *names = image.view<char>("grp_names", cnt);
+    const char *names_end = names + cnt;
+    const int *size = image_view<int>(image, "grp_size", n_grp);
+    const unsigned int *utype = image_view<unsigned int>(image, "grp_type", n_grp);
+    const unsigned char *mflag = image_view<unsigned char>(image, "grp_mflag", n_grp);
+    const float *rate = image_view<float>(image, "inp_rate", n_inp);
+    const float *freq = image_view<float>(image, "inp_freq", n_inp);
+    const unsigned char *zero = image_view<unsigned char>(image, "inp_zero", n_inp);
+    const float *alpha = image_view<float>(image, "nsat_alpha", n_nsat);
+    const float *beta = image_view<float>(image, "nsat_beta", n_nsat);
+    const float *sigma = image_view<float>(image, "nsat_sigma", n_nsat);
+    const float *v_th = image_view<float>(image, "nsat_v_th", n_nsat);
+    const float *v_reset = image_view<float>(image, "nsat_v_reset", n_nsat);
+    const float *alphaS = image_view<float>(image, "nsat_alphaS", n_nsat);
+    const float *bias = image_view<float>(image, "nsat_b", n_nsat);
+    const int *tau_ref = image_view<int>(image, "nsat_tau_ref", n_nsat);
+
+    for (int g = 0; g < n_grp; ++g) {
+        if (names >= names_end) { throw 23; }
+        string name(names, strnlen(names, names_end - names));
+        names += name.size() + 1;
+
+        if (g < n_inp) {
+            input_unit u;
+            u.unit_name = name;
+            u.unit_id = g;
+            u.num_neurons = size[g];
+            u.unit_type = utype[g];
+            u.mflag = mflag[g];
+            u.spkg_p.rate = rate[g];
+            u.spkg_p.freq = freq[g];
+            u.spkg_p.spk_at_zero = zero[g];
+            u.spkg_p.on_gpu = false;
+            inpc.push_back(u);
+        } else {
+            int k = g - n_inp;
+            nsat_unit u;
+            u.unit_name = name;
+            u.unit_id = g;
+            u.num_neurons = size[g];
+            u.unit_type = utype[g];
+            u.mflag = mflag[g];
+            u.nsat_p.alpha = alpha[k];
+            u.nsat_p.beta = beta[k];
+            u.nsat_p.sigma = sigma[k];
+            u.nsat_p.v_th = v_th[k];
+            u.nsat_p.v_reset = v_reset[k];
+            u.nsat_p.alphaS = alphaS[k];
+            u.nsat_p.b = bias[k];
+            u.nsat_p.tau_ref = tau_ref[k];
+            nsatc.push_back(u);
+        }
+    }
+    initialize_groups();
+
+    // Spike trains (vectorial inputs)
+    const int *train_ptr = image_view<int>(image, "train_ptr", meta[8] + 1);
+    if (meta[8] < 0 || train_ptr[0] != 0) { throw 23; }
+    for (int i = 0; i < meta[8]; ++i)
+        if (train_ptr[i+1] < train_ptr[i]) { throw 23; }
+    const int *train_times = image_view<int>(image, "train_times",
+                                             train_ptr[meta[8]]);
+    for (int i = 0; i < meta[8]; ++i)
+        spike_trains.push_back(vector<int>(train_times + train_ptr[i],
+                                           train_times + train_ptr[i+1]));
+
+    // STDP configuration
+    const int *stdp_i = image_view<int>(image, "stdp_int", meta[7] * 5);
+    const float *stdp_f = image_view<float>(image, "stdp_float", meta[7] * 4);
+    for (int i = 0; i < meta[7]; ++i) {
+        stdp_unit u;
+        if (stdp_i[5*i] < 0 || stdp_i[5*i] >= n_nsat) { throw 23; }
+        u.unit_name = nsatc[stdp_i[5*i]].unit_name;
+        u.type = (stdp_i[5*i+1] == 0) ? "E" : "I";
+        u.stdp_fun = stdp_i[5*i+2];
+        u.is_set = stdp_i[5*i+3];
+        u.da_mode = stdp_i[5*i+4] ? "STANDARD" : "DA_MOD";
+        u.alpha_plus = stdp_f[4*i];
+        u.tau_plus = stdp_f[4*i+1];
+        u.alpha_minus = stdp_f[4*i+2];
+        u.tau_minus = stdp_f[4*i+3];
+        u.beta_ltp = u.beta_ltd = u.lambda = u.delta = u.gamma = 0.0;
+        stdpc.push_back(u);
+    }
+
+    // Internal order of the neurons (older images have none)
+    reorder = false;
+    if (image.has("neuron_order")) {
+        const int *order = image_view<int>(image, "neuron_order", num_neurons);
+        vector<char> seen(num_neurons, 0);
+        for (int g = 0; g < n_grp; ++g) {
+            for (int n = grp_start[g]; n < grp_start[g+1]; ++n) {
+                if (order[n] < grp_start[g] || order[n] >= grp_start[g+1] ||
+                    seen[order[n]] || (g < n_inp && order[n] != n)) {
+                    throw 23;
+                }
+                seen[order[n]] = 1;
+                if (order[n] != n) reorder = true;
+            }
+        }
+        orig.assign(order, order + num_neurons);
+        perm.resize(num_neurons);
+        for (int n = 0; n < num_neurons; ++n) perm[orig[n]] = n;
+    }
+
+    // CSR projections (viewed in place, weights copied)
+    size_t n_rows, n_syn, n_pd;
+    const int *pi = image_view<int>(image, "proj_int", n_proj * 6);
+    const float *pf = image_view<float>(image, "proj_float", n_proj * 2);
+    const float *row_q = image.view<float>("row_q", n_rows);
+    const int *col_idx = image.view<int>("col_idx", n_syn);
+    const float *pdrop = image.view<float>("pdrop", n_pd);
+    const int *row_ptr = image_view<int>(image, "row_ptr", n_rows + n_proj);
+    const float *wt = image_view<float>(image, "wt", n_syn);
+    const float *row_lq = image_view<float>(image, "row_lq", n_rows);
+    const unsigned char *row_drop = image_view<unsigned char>(image, "row_drop",
+                                                               n_rows);
+    const float *row_psum = image_view<float>(image, "row_psum", n_rows);
+    const float *row_pvar = image_view<float>(image, "row_pvar", n_rows);
+    size_t kr = 0, ks = 0, kp = 0, krow = 0;
+
+    for (int p = 0; p < n_proj; ++p) {
+        csr_projection c;
+        const int *q = pi + 6 * p;
+        int num_syn = q[4];
+        if (q[0] < 0 || q[0] >= n_grp || q[1] < n_inp || q[1] >= n_grp) {
+            throw 23;
+        }
+
+        c.src_grp = q[0];
+        c.dest_grp = q[1];
+        c.src_start = grp_start[c.src_grp];
+        c.dest_start = grp_start[c.dest_grp];
+        c.num_pre = q[2];
+        c.num_post = q[3];
+        c.sign = pf[2*p];
+        c.prob = pf[2*p+1];
+        c.plastic = false;
+        if (c.num_pre != grp_start[c.src_grp+1] - c.src_start ||
+            c.num_post != grp_start[c.dest_grp+1] - c.dest_start ||
+            num_syn < 0 || krow + c.num_pre > n_rows ||
+            ks + num_syn > n_syn || (q[5] && kp + num_syn > n_pd) ||
+            row_ptr[kr] != 0 || row_ptr[kr+c.num_pre] != num_syn) {
+            throw 23;
+        }
+
+        // The CSR indices are used unchecked by the simulation
+        for (int i = 0; i < c.num_pre; ++i)
+            if (row_ptr[kr+i+1] < row_ptr[kr+i]) { throw 23; }
+        for (int k = 0; k < num_syn; ++k)
+            if (col_idx[ks+k] < 0 || col_idx[ks+k] >= c.num_post) { throw 23; }
+
+        c.row_ptr.map(row_ptr + kr, c.num_pre + 1);
+        c.col_idx.map(col_idx + ks, num_syn);
+        c.wt.assign(wt + ks, wt + ks + num_syn);
+        if (q[5]) {
+            c.pdrop.map(pdrop + kp, num_syn);
+            kp += num_syn;
+        }
+        c.row_q.map(row_q + krow, c.num_pre);
+        c.row_lq.map(row_lq + krow, c.num_pre);
+        c.row_drop.map(row_drop + krow, c.num_pre);
+        c.row_psum.map(row_psum + krow, c.num_pre);
+        c.row_pvar.map(row_pvar + krow, c.num_pre);
+        kr += c.num_pre + 1;
+        ks += num_syn;
+        krow += c.num_pre;
+        connx.push_back(c);
+    }
+    if (ks != n_syn || kp != n_pd || krow != n_rows) { throw 23; }
+
+    init_weights.clear();
+    for (auto &c : connx) init_weights.push_back(c.wt);
+
+    num_steps = sim_p.sim_time_sec * 1000 + sim_p.sim_time_msec;
+    sim_step = 0;
+    results_dir = "results";
+    generic_kernels = false;
+    skip_blankout = true;
+    part_id = 0;
+    from_image = true;
+    series_fp = NULL;
+    series_period = 0;
+    cur_step = run_step0 = 0;
+    run_wall0 = run_wall1 = 0.0;
+    initialize_counters();
+    log = &cout;
+    last_error = 0;
+
+    for (int b = 0; b < batch_size; ++b)
+        seeds.push_back(carl_p.random_seed + b);
+}
+
+
+/***************************************************************************
+ * BATCH_CORE Class Destructor.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+batch_core::~batch_core() {
+    if (series_fp != NULL) fclose(series_fp);
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_SEEDS - This method overrides the random seeds of the
+ * instances. It has to be called before B_SETUP_STATE.
+ *
+ * Args:
+ * -----
+ *  s (vector<int>) : One seed per instance.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  13 : Not a valid batch size.
+ ***************************************************************************/
+void batch_core::set_seeds(const vector<int> &s) {
+    if (s.size() != batch_size) { throw 13; }
+    seeds = s;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_RESULTS_DIR - This method sets the directory where the
+ * spike files are written. The spikes of the b-th instance are written
+ * in dir/batch<b>/spk<group name>.dat.
+ *
+ * Args:
+ * -----
+ *  dir (string) : Results directory.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::set_results_dir(const string &dir) {
+    results_dir = dir;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_LOG_FILE - This method sends the error log of the batch
+ * to a file (truncated). Batches that run concurrently should each have
+ * their own, as nsat_core instances do (see NSAT_CORE::SET_LOG_FILE).
+ *
+ * Args:
+ * -----
+ *  fname (string) : Log file name.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot open file.
+ ***************************************************************************/
+void batch_core::set_log_file(const string &fname) {
+    if (log_file.is_open()) log_file.close();
+    log = &cout;
+    log_file.open(fname.c_str(), ofstream::out | ofstream::trunc);
+    if (!log_file) { throw 15; }
+    log = &log_file;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE ERROR - This method reports an exception of the batch: it is
+ * written to the batch's log (see auxiliary.cpp) and kept as its last
+ * error.
+ *
+ * Args:
+ * -----
+ *  e (int) : Exception's code.
+ *
+ * Returns:
+ * --------
+ *  The code (int), so the callers can return it.
+ ***************************************************************************/
+int batch_core::error(int e) {
+    last_error = e;
+    log_exceptions(*log, e);
+    *log << flush;
+    return e;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_PARTITION - This method restricts the batch to the NSAT
+ * groups of one part of the network: only they are updated, recorded 
+ * and written, and only the projections onto them are built. The spikes
+ * of the other parts have to be supplied by the caller (see dist_core.h).
+ * It has to be called before B_SETUP_STATE.
+ *
+ * Args:
+ * -----
+ *  owner (vector<int>) : Part of each group (input groups first).
+ *  part (int)          : Part simulated by this batch.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural groups.
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+void batch_core::set_partition(const vector<int> &owner, int part) {
+    if (owner.size() != inpc.size() + nsatc.size()) { throw 7; }
+    if (!connx.empty()) { throw 25; }
+    grp_owner = owner;
+    part_id = part;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE INITIALIZE_GROUPS - This method assigns a contiguous range
+ * of global neuron ids to each group. Input groups come first, followed
+ * by the NSAT groups (in the order of the parameters files).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if succesfully initializes the groups, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural groups.
+ ***************************************************************************/
+int batch_core::initialize_groups() {
+    if (inpc.empty() || nsatc.empty()) { throw 7; }
+
+    grp_start.clear();
+    num_neurons = 0;
+    for (auto &u : inpc) {
+        grp_start.push_back(num_neurons);
+        num_neurons += u.num_neurons;
+    }
+    for (auto &u : nsatc) {
+        grp_start.push_back(num_neurons);
+        num_neurons += u.num_neurons;
+    }
+    grp_start.push_back(num_neurons);
+    return 0;
+}
+
+
+/***************************************************************************
+ * FIND_GROUPS - Finds the source and destination groups (inputs first,
+ * then NSAT groups) of a projection.
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ ***************************************************************************/
+static void find_groups(const projection &p,
+                        const vector<input_unit> &inpc,
+                        const vector<nsat_unit> &nsatc,
+                        int &src,
+                        int &dest) {
+    int n_inp = inpc.size();
+
+    src = dest = -1;
+    if (p.src_input) {
+        for (int i = 0; i < n_inp; ++i)
+            if (inpc[i].unit_name == p.src_name) src = i;
+    } else {
+        for (int i = 0; i < nsatc.size(); ++i)
+            if (nsatc[i].unit_name == p.src_name) src = n_inp + i;
+    }
+    for (int i = 0; i < nsatc.size(); ++i)
+        if (nsatc[i].unit_name == p.dest_name) dest = n_inp + i;
+    if (src < 0 || dest < 0) { throw 6; }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_REORDER - This method turns the locality reordering of
+ * the NSAT neurons (see INITIALIZE_ORDER) off or on. It has to be called
+ * before B_SETUP_STATE; batches loaded from an image keep the order of
+ * their image.
+ *
+ * Args:
+ * -----
+ *  flag (bool) : If true the neurons are reordered at setup.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+void batch_core::set_reorder(bool flag) {
+    if (!connx.empty() || from_image) { throw 25; }
+    reorder = flag;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE INITIALIZE_ORDER - This method computes the internal order
+ * of the neurons. Without reordering it is the identity. Otherwise all
+ * the projections (dense weights, so every part of a partitioned network
+ * gets the same order) form one undirected graph over the global neuron
+ * ids, which is ordered by reverse Cuthill-McKee: a breadth-first search
+ * from a lowest degree neuron of each connected component, visiting the
+ * neighbours by increasing degree, reversed. Each NSAT group then sorts
+ * its neurons by their rank, so neurons that share presynaptic neurons
+ * get nearby ids. Input groups keep their order. Batches loaded from an
+ * image keep the image's order.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ ***************************************************************************/
+void batch_core::initialize_order() {
+    if (from_image && !orig.empty()) return;
+
+    orig.resize(num_neurons);
+    for (int n = 0; n < num_neurons; ++n) orig[n] = n;
+
+    if (reorder) {
+        // Undirected graph (CSR) of all the projections
+        vector<int> adj_ptr(num_neurons + 1, 0), adj;
+        for (int pass = 0; pass < 2; ++pass) {
+            vector<int> pos(adj_ptr.begin(), adj_ptr.end() - 1);
+            for (auto &p : projs) {
+                int src, dest;
+                find_groups(p, inpc, nsatc, src, dest);
+                int i0 = grp_start[src], j0 = grp_start[dest];
+
+                for (int i = 0; i < p.num_pre; ++i) {
+                    for (int j = 0; j < p.num_post; ++j) {
+                        if (fabsf(p.wt[i][j]) <= 0.0f) continue;
+                        if (pass == 0) {
+                            adj_ptr[i0+i+1]++;
+                            adj_ptr[j0+j+1]++;
+                        } else {
+                            adj[pos[i0+i]++] = j0 + j;
+                            adj[pos[j0+j]++] = i0 + i;
+                        }
+                    }
+                }
+            }
+            if (pass == 0) {
+                for (int n = 0; n < num_neurons; ++n)
+                    adj_ptr[n+1] += adj_ptr[n];
+                adj.resize(adj_ptr[num_neurons]);
+            }
+        }
+
+        // Reverse Cuthill-McKee
+        auto degree = [&](int n) { return adj_ptr[n+1] - adj_ptr[n]; };
+        auto by_degree = [&](int a, int b) { return degree(a) < degree(b); };
+        vector<int> starts(orig), order, rank(num_neurons);
+        vector<char> seen(num_neurons, 0);
+        stable_sort(starts.begin(), starts.end(), by_degree);
+        order.reserve(num_neurons);
+        for (int s : starts) {
+            if (seen[s]) continue;
+            seen[s] = 1;
+            order.push_back(s);
+            for (size_t head = order.size() - 1; head < order.size(); ++head) {
+                int u = order[head];
+                size_t first = order.size();
+                for (int e = adj_ptr[u]; e < adj_ptr[u+1]; ++e) {
+                    if (seen[adj[e]]) continue;
+                    seen[adj[e]] = 1;
+                    order.push_back(adj[e]);
+                }
+                stable_sort(order.begin() + first, order.end(), by_degree);
+            }
+        }
+        for (int r = 0; r < num_neurons; ++r)
+            rank[order[num_neurons-1-r]] = r;
+
+        // Each NSAT group sorts its neurons by rank
+        for (int g = inpc.size(); g < inpc.size() + nsatc.size(); ++g)
+            sort(orig.begin() + grp_start[g], orig.begin() + grp_start[g+1],
+                 [&](int a, int b) { return rank[a] < rank[b]; });
+    }
+
+    perm.resize(num_neurons);
+    for (int n = 0; n < num_neurons; ++n) perm[orig[n]] = n;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE GET_FANOUT_LINES - This method measures the locality of the
+ * built projections: the mean number of distinct cache lines (64 bytes)
+ * of the synaptic inputs ([neuron][batch]) that the fan-out of one 
+ * presynaptic neuron touches. Reordering lowers it when the fan-outs
+ * have structure.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Mean cache lines per (nonempty) fan-out.
+ ***************************************************************************/
+double batch_core::get_fanout_lines() const {
+    int64_t rows = 0, lines = 0;
+    vector<int64_t> line;
+
+    for (auto &c : connx) {
+        for (int i = 0; i + 1 < c.row_ptr.size(); ++i) {
+            if (c.row_ptr[i+1] == c.row_ptr[i]) continue;
+            line.clear();
+            for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k) {
+                int64_t n = c.dest_start + c.col_idx[k];
+                line.push_back(n * batch_size * sizeof(float) / 64);
+            }
+            sort(line.begin(), line.end());
+            lines += unique(line.begin(), line.end()) - line.begin();
+            rows++;
+        }
+    }
+    return (rows > 0) ? static_cast<double>(lines) / rows : 0.0;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE INITIALIZE_CONNEXIONS - This method converts the dense
+ * weights matrices of the projections to CSR (only nonzero weights are
+ * synapses, as in Connx::connect). Postsynaptic neurons get their 
+ * internal ids (see INITIALIZE_ORDER). When a blankout standard deviation is
+ * given, a blankout probability is drawn once per synapse from
+ * N(prob, std) (clipped to [0, 1]) using carlsim::random_seed, so all
+ * instances share the same synapses. The skip sampling rate of each
+ * row (fan-out) is precomputed here (see DELIVER_SKIP).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if all projections are succesfully built, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ ***************************************************************************/
+int batch_core::initialize_connexions() {
+    int n_inp = inpc.size();
+    mt19937 gen(carl_p.random_seed);
+    unsigned int inh_mask = ((1 << 3) | (1 << 4));
+
+    connx.clear();
+    for (auto &p : projs) {
+        csr_projection c;
+        int src, dest;
+        unsigned int src_type;
+
+        // Find source and destination groups
+        find_groups(p, inpc, nsatc, src, dest);
+        src_type = (src < n_inp) ? inpc[src].unit_type
+                                 : nsatc[src - n_inp].unit_type;
+
+        c.src_grp = src;
+        c.dest_grp = dest;
+        c.src_start = grp_start[src];
+        c.dest_start = grp_start[dest];
+        c.num_pre = p.num_pre;
+        c.num_post = p.num_post;
+        c.sign = (src_type & inh_mask) ? -1.0 : 1.0;
+        c.prob = p.prob;
+        c.plastic = false;
+
+        // Projections onto other parts are not built (their blankout
+        // probabilities are still drawn, to keep the random sequence)
+        normal_distribution<float> pdist(p.prob, p.std);
+        if (!is_local(dest)) {
+            for (int i = 0; i < p.num_pre && p.prob_flag == 5; ++i)
+                for (int j = 0; j < p.num_post; ++j)
+                    if (fabsf(p.wt[i][j]) > 0.0f) pdist(gen);
+            connx.push_back(c);
+            continue;
+        }
+
+        // Dense to CSR (rows and synapses in the original order, columns
+        // in the internal one)
+        vector<int> rows(1, 0), cols;
+        vector<float> pdrop;
+        for (int i = 0; i < p.num_pre; ++i) {
+            for (int j = 0; j < p.num_post; ++j) {
+                if (fabsf(p.wt[i][j]) > 0.0f) {
+                    cols.push_back(perm[c.dest_start+j] - c.dest_start);
+                    c.wt.push_back(p.wt[i][j]);
+                    if (p.prob_flag == 5)
+                        pdrop.push_back(min(max(pdist(gen), 0.0f), 1.0f));
+                }
+            }
+            rows.push_back(cols.size());
+        }
+
+        // Blankout skip sampling rates
+        vector<float> row_q, row_lq, row_psum, row_pvar;
+        vector<unsigned char> row_drop;
+        for (int i = 0; i < p.num_pre; ++i) {
+            float pmin = 1.0, pmax = 0.0, psum = 0.0, pvar = 0.0;
+            for (int k = rows[i]; k < rows[i+1]; ++k) {
+                float pd = pdrop.empty() ? c.prob : pdrop[k];
+                pmin = min(pmin, pd);
+                pmax = max(pmax, pd);
+                psum += pd;
+                pvar += pd * (1.0 - pd);
+            }
+            bool drop = (pmax <= 1.0 - pmin);
+            float q = drop ? pmax : 1.0 - pmin;
+            row_drop.push_back(drop);
+            row_q.push_back(q);
+            row_lq.push_back(log1pf(-q));
+            row_psum.push_back(psum);
+            row_pvar.push_back(pvar);
+        }
+
+        c.row_ptr.set(rows);
+        c.col_idx.set(cols);
+        c.pdrop.set(pdrop);
+        c.row_q.set(row_q);
+        c.row_lq.set(row_lq);
+        c.row_drop.set(row_drop);
+        c.row_psum.set(row_psum);
+        c.row_pvar.set(row_pvar);
+        connx.push_back(c);
+    }
+
+    // Keep the initial weights - RESET_STATE may restore them
+    init_weights.clear();
+    for (auto &c : connx) init_weights.push_back(c.wt);
+    return 0;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE INITIALIZE_STATE - This method allocates the [neuron][batch]
+ * state arrays and resets them.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if succesfully initializes the state.
+ ***************************************************************************/
+int batch_core::initialize_state() {
+    int size = num_neurons * batch_size;
+
+    v.assign(size, 0.0);
+    isyn.assign(size, 0.0);
+    isyn_in.assign(size, 0.0);
+    ref.assign(size, 0);
+    spk.assign(size, 0);
+    spk_prev.assign(size, 0);
+    spk_any.assign(num_neurons, 0);
+
+    // STDP traces start empty
+    for (auto &c : connx) {
+        if (!c.plastic) continue;
+        c.x_pre.assign(c.num_pre * batch_size, 0.0);
+        c.x_post.assign(c.num_post * batch_size, 0.0);
+        c.t_pre.assign(c.num_pre * batch_size, 0);
+        c.t_post.assign(c.num_post * batch_size, 0);
+    }
+
+    // NSAT neurons start from their reset potential
+    for (int g = 0; g < nsatc.size(); ++g) {
+        int gid = inpc.size() + g;
+        for (int n = grp_start[gid]; n < grp_start[gid+1]; ++n)
+            for (int b = 0; b < batch_size; ++b)
+                v[n*batch_size+b] = nsatc[g].nsat_p.v_reset;
+    }
+
+    rng_seeds.assign(seeds.begin(), seeds.end());
+    draws.assign(batch_size, 0.0);
+    memset(&blk_stats, 0, sizeof(blk_stats));
+
+    // Activity counters (and the time series) restart, in place: they
+    // can be read during a run (see GET_COUNTERS)
+    activity_counters zero;
+    memset(&zero, 0, sizeof(zero));
+    fill(counters.begin(), counters.end(), zero);
+    publish_counters();
+    series_last = counters;
+    series_wall = timer_core::wall_time();
+
+    records.assign(batch_size * (inpc.size() + nsatc.size()), vector<int>());
+    sim_step = 0;
+    return 0;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE BUILD_SCHEDULE - This method merges the input spikes of all
+ * the input neurons and instances for the next run (steps sim_step ...
+ * sim_step + num_steps - 1) into one time-sorted schedule (calendar 
+ * queue, see schedule_core.h): pre-generated Poisson trains, periodic 
+ * spikes and spike trains. 
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::build_schedule() {
+    input_sched.reset(sim_step, num_steps);
+    for (int g = 0; g < inpc.size(); ++g) {
+        int num = inpc[g].num_neurons;
+
+        for (int b = 0; b < batch_size; ++b) {
+            if (input_type == "poisson_schedule")
+                input_sched.add_poisson(input_rates[g], grp_start[g],
+                                        batch_size, b,
+                                        RNG_STREAM(RNG_SCHEDULE, g),
+                                        rng_seeds[b]);
+            else if (input_type == "periodical")
+                input_sched.add_periodic(num, inpc[g].spkg_p.freq,
+                                         inpc[g].spkg_p.spk_at_zero,
+                                         grp_start[g], batch_size, b);
+            else
+                input_sched.add_train(spike_trains[g], num, 0,
+                                      grp_start[g], batch_size, b);
+        }
+    }
+    input_sched.finalize();
+}
+
+
+/***************************************************************************
+ * BATCH_CORE GENERATE_INPUTS - This method emits the spikes of the input
+ * neurons at step t. Poisson inputs spike with probability rate/1000
+ * (independently per instance). All the other inputs (pre-generated 
+ * Poisson, periodical and vectorial) spike at the steps of the schedule
+ * (see BUILD_SCHEDULE), so only the spikes due at step t are touched.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::generate_inputs(int t) {
+    if (input_type != "poisson") {
+        fill(spk.begin(), spk.begin() + grp_start[inpc.size()] * batch_size, 0);
+        for (const int *id = input_sched.begin(t); id != input_sched.end(t); ++id)
+            spk[*id] = 1;
+        return;
+    }
+
+    for (int g = 0; g < inpc.size(); ++g) {
+        unsigned char *s = &spk[grp_start[g]*batch_size];
+
+        for (int n = 0; n < inpc[g].num_neurons; ++n) {
+            float p = input_rates[g][n] / 1000.0;
+            rng_uniform(RNG_STREAM(RNG_POISSON, g), n, t,
+                        rng_seeds.data(), batch_size, draws.data());
+            for (int b = 0; b < batch_size; ++b)
+                s[n*batch_size+b] = (draws[b] < p);
+        }
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE DELIVER_SPIKES - This method accumulates the synaptic inputs
+ * caused by the spikes of the previous step. Every weight is fetched once
+ * and applied to all the instances in which the presynaptic neuron
+ * spiked (unless the synaptic event is blanked out). Plastic projections
+ * use the weights of each instance. Blanked out projections are skip
+ * sampled (see DELIVER_SKIP) unless SET_SKIP_BLANKOUT turned it off.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::deliver_spikes(int t) {
+    fill(isyn_in.begin(), isyn_in.end(), 0.0);
+    deliver_projections(t, 0, connx.size());
+}
+
+
+/***************************************************************************
+ * BATCH_CORE DELIVER_PROJECTIONS - This method accumulates the synaptic
+ * inputs of step t through projections first ... last - 1 (see 
+ * DELIVER_SPIKES). Projections onto other parts are skipped. Delivering
+ * the projections in order, in one or more calls, gives the same sums.
+ * The rows are visited in the original order of the presynaptic neurons
+ * (their spikes are read through perm), so reordering does not change
+ * the order of the sums.
+ *
+ * Args:
+ * -----
+ *  t (int)     : Current simulation step (ms).
+ *  first (int) : First projection.
+ *  last (int)  : One past the last projection.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::deliver_projections(int t, int first, int last) {
+    for (int p = first; p < last; ++p) {
+        const csr_projection &c = connx[p];
+        if (!is_local(c.dest_grp)) continue;
+
+        bool per_syn = !c.pdrop.empty();
+        bool blankout = per_syn || c.prob > 0.0;
+        int64_t events = 0;
+        double dropped0 = blk_stats.dropped;
+        const int *pre = &perm[c.src_start];
+        for (int i = 0; i < c.num_pre; ++i) {
+            if (spk_any[pre[i]] == 0) continue;
+            const unsigned char *s = &spk_prev[pre[i]*batch_size];
+            events += static_cast<int64_t>(spk_any[pre[i]]) *
+                      (c.row_ptr[i+1] - c.row_ptr[i]);
+
+            if (blankout && skip_blankout) {
+                deliver_skip(p, i, t);
+                continue;
+            }
+            if (blankout) {
+                for (int b = 0; b < batch_size; ++b) {
+                    if (s[b] == 0) continue;
+                    blk_stats.events += c.row_ptr[i+1] - c.row_ptr[i];
+                    blk_stats.mean += c.row_psum[i];
+                    blk_stats.var += c.row_pvar[i];
+                }
+            }
+
+            for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k) {
+                float w = c.sign * c.wt[k];
+                const float *wb = c.plastic ? &c.wt_b[k*batch_size] : NULL;
+                float pd = per_syn ? c.pdrop[k] : c.prob;
+                float *in = &isyn_in[(c.dest_start+c.col_idx[k])*batch_size];
+
+                if (pd <= 0.0) {
+                    for (int b = 0; b < batch_size; ++b)
+                        if (s[b]) in[b] += wb ? c.sign * wb[b] : w;
+                    continue;
+                }
+
+                rng_uniform(RNG_STREAM(RNG_BLANKOUT, p), k, t,
+                            rng_seeds.data(), batch_size, draws.data());
+                for (int b = 0; b < batch_size; ++b) {
+                    if (s[b] == 0) continue;
+                    if (draws[b] >= pd) in[b] += wb ? c.sign * wb[b] : w;
+                    else blk_stats.dropped++;
+                }
+            }
+        }
+
+        int64_t dropped = blk_stats.dropped - dropped0;
+        counters[c.dest_grp].events += events - dropped;
+        counters[c.dest_grp].dropped += dropped;
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE DELIVER_SKIP - This method delivers the spike of a
+ * presynaptic neuron (all the instances in which it spiked) through a 
+ * blanked out projection by skip sampling. The number of synapses to the
+ * next candidate is geometric with rate q (precomputed per row). In drop
+ * rows the candidates are dropped (with probability pd / q when the 
+ * probabilities differ per synapse) and all the other synapses are kept;
+ * in keep rows only the candidates are visited and kept (with 
+ * probability (1 - pd) / q). The random numbers of an instance are a
+ * sequence keyed by (projection, neuron, step, seed).
+ *
+ * Args:
+ * -----
+ *  p (int) : Projection's index.
+ *  i (int) : Presynaptic neuron (local, original id).
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::deliver_skip(int p, int i, int t) {
+    const csr_projection &c = connx[p];
+    const unsigned char *s = &spk_prev[perm[c.src_start+i]*batch_size];
+    int k0 = c.row_ptr[i], len = c.row_ptr[i+1] - k0;
+    float q = c.row_q[i], lq = c.row_lq[i];
+    bool per_syn = !c.pdrop.empty();
+    uint32_t stream = RNG_STREAM(RNG_SKIP, p);
+    float *in = &isyn_in[c.dest_start*batch_size];
+    float u[8];
+
+    for (int b = 0; b < batch_size; ++b) {
+        if (s[b] == 0) continue;
+        int used = 8, dropped = 0;
+        uint32_t first = 0;
+
+        // Next uniform number of the instance's sequence
+        auto next = [&]() -> float {
+            if (used == 8) {
+                rng_uniform_seq(stream, i, rng_seeds[b], t, first, 8, u);
+                first += 8;
+                used = 0;
+            }
+            return u[used++];
+        };
+
+        int pos = rng_geometric(next(), lq, len);
+        if (c.row_drop[i]) {
+            for (int j = 0; j < len; ++j) {
+                int k = k0 + j;
+                if (j == pos) {
+                    pos = j + 1 + rng_geometric(next(), lq, len);
+                    if (!per_syn || next() * q < c.pdrop[k]) {
+                        dropped++;
+                        continue;
+                    }
+                }
+                float w = c.plastic ? c.wt_b[k*batch_size+b] : c.wt[k];
+                in[c.col_idx[k]*batch_size+b] += c.sign * w;
+            }
+        } else {
+            dropped = len;
+            for (int j = pos; j < len; j += 1 + rng_geometric(next(), lq, len)) {
+                int k = k0 + j;
+                if (per_syn && next() * q >= 1.0 - c.pdrop[k]) continue;
+                float w = c.plastic ? c.wt_b[k*batch_size+b] : c.wt[k];
+                in[c.col_idx[k]*batch_size+b] += c.sign * w;
+                dropped--;
+            }
+        }
+
+        blk_stats.events += len;
+        blk_stats.dropped += dropped;
+        blk_stats.mean += c.row_psum[i];
+        blk_stats.var += c.row_pvar[i];
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_SKIP_BLANKOUT - This method turns the skip sampling of
+ * blanked out projections off (one random number per synapse and event)
+ * or on, e.g. for benchmarking.
+ *
+ * Args:
+ * -----
+ *  flag (bool) : If true blankout is skip sampled.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::set_skip_blankout(bool flag) {
+    skip_blankout = flag;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE UPDATE_NEURONS - This method updates the state of all NSAT
+ * neurons (of all instances) for one step and detects their spikes. Each
+ * group is updated by its own kernel (see SELECT_KERNELS). Groups of 
+ * other parts are skipped.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::update_neurons(int t) {
+    for (int g = 0; g < nsatc.size(); ++g)
+        if (is_local(inpc.size() + g)) (this->*kernels[g])(g, t);
+}
+
+
+/***************************************************************************
+ * BATCH_CORE UPDATE_GROUP - This is the update kernel of a NSAT group.
+ * The template flags compile the noise, bias and refractory terms in or
+ * out. With all flags on (generic kernel) the terms are still checked at
+ * run time, so it is valid for any parameters. The random numbers are
+ * counter-based (keyed by the original neuron ids), hence all kernels
+ * give identical results.
+ *
+ * Args:
+ * -----
+ *  g (int) : NSAT group's index.
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+template<bool NOISE, bool BIAS, bool REFRAC>
+void batch_core::update_group(int g, int t) {
+    const nsat &p = nsatc[g].nsat_p;
+    int gid = inpc.size() + g;
+    bool noisy = NOISE && p.sigma != 0.0;
+
+    for (int n = grp_start[gid]; n < grp_start[gid+1]; ++n) {
+        int idx = n * batch_size;
+
+        if (noisy)
+            rng_normal(RNG_STREAM(RNG_NOISE, g), orig[n] - grp_start[gid], t,
+                       rng_seeds.data(), batch_size, draws.data());
+
+        for (int b = 0; b < batch_size; ++b, ++idx) {
+            float vn;
+
+            isyn[idx] = p.alphaS * isyn[idx] + isyn_in[idx];
+
+            // Refractory period
+            if (REFRAC && ref[idx] > 0) {
+                ref[idx]--;
+                v[idx] = p.v_reset;
+                spk[idx] = 0;
+                continue;
+            }
+
+            vn = p.alpha * v[idx] + p.beta * isyn[idx];
+            if (BIAS) vn += p.b;
+            if (noisy) vn += p.sigma * draws[b];
+
+            if (vn >= p.v_th) {
+                spk[idx] = 1;
+                vn = p.v_reset;
+                if (REFRAC) ref[idx] = p.tau_ref;
+            } else {
+                spk[idx] = 0;
+            }
+            v[idx] = vn;
+        }
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SELECT_KERNELS - This method selects the update kernel of
+ * each NSAT group from its parameters. Groups without a refractory 
+ * period have their refractory counters cleared.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::select_kernels() {
+    static const nsat_kernel table[8] = {
+        &batch_core::update_group<false, false, false>,
+        &batch_core::update_group<false, false, true>,
+        &batch_core::update_group<false, true, false>,
+        &batch_core::update_group<false, true, true>,
+        &batch_core::update_group<true, false, false>,
+        &batch_core::update_group<true, false, true>,
+        &batch_core::update_group<true, true, false>,
+        &batch_core::update_group<true, true, true>
+    };
+
+    kernels.clear();
+    for (int g = 0; g < nsatc.size(); ++g) {
+        const nsat &p = nsatc[g].nsat_p;
+        int noise = (p.sigma != 0.0), bias = (p.b != 0.0);
+        int refrac = (p.tau_ref > 0);
+
+        if (generic_kernels) noise = bias = refrac = 1;
+        kernels.push_back(table[4*noise+2*bias+refrac]);
+
+        if (!refrac && !ref.empty()) {
+            int gid = inpc.size() + g;
+            fill(ref.begin() + grp_start[gid] * batch_size,
+                 ref.begin() + grp_start[gid+1] * batch_size, 0);
+        }
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_GENERIC_KERNELS - This method makes all the NSAT groups
+ * use the generic kernel (or their specialized ones again), e.g. for 
+ * benchmarking.
+ *
+ * Args:
+ * -----
+ *  flag (bool) : If true the generic kernel is used.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::set_generic_kernels(bool flag) {
+    generic_kernels = flag;
+    if (!grp_start.empty()) select_kernels();
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_STDP_MODE - This method turns STDP off (STDP_OFF) or
+ * selects how the weights are updated: only at the spikes with lazily
+ * decayed traces (STDP_LAZY) or at every step for all the synapses
+ * (STDP_EAGER). Both modes give the same weights (up to rounding). It 
+ * has to be called before B_SETUP_STATE.
+ *
+ * Args:
+ * -----
+ *  mode (int) : STDP_OFF, STDP_EAGER or STDP_LAZY.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state.
+ *  27 : STDP mode/curve not supported in batch mode.
+ ***************************************************************************/
+void batch_core::set_stdp_mode(int mode) {
+    if (mode != STDP_OFF && mode != STDP_EAGER && mode != STDP_LAZY) {
+        throw 27;
+    }
+    if (!connx.empty()) { throw 25; }
+    stdp_mode = mode;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE INITIALIZE_STDP - This method marks as plastic every 
+ * projection whose destination group has STDP on for the type of its
+ * source (E STDP for excitatory, I STDP for inhibitory sources), as
+ * CARLsim does. The curves follow NSAT_CORE::APPLY_STDP: E STDP 
+ * potentiates on post spikes and depresses on pre spikes, I STDP the 
+ * other way round. Each plastic projection gets a CSC view (incoming 
+ * synapses of each post neuron), per-instance copies of its weights and
+ * empty traces. Weights are kept in [0, maxWt].
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  27 : STDP mode/curve not supported in batch mode.
+ ***************************************************************************/
+void batch_core::initialize_stdp() {
+    int n_inp = inpc.size();
+
+    for (auto &c : connx) {
+        c.plastic = false;
+        if (stdp_mode == STDP_OFF || !is_local(c.dest_grp)) continue;
+
+        string dest, type = (c.sign < 0) ? "I" : "E";
+        for (int g = 0; g < nsatc.size(); ++g)
+            if (grp_start[n_inp+g] == c.dest_start) dest = nsatc[g].unit_name;
+
+        for (auto &u : stdpc) {
+            if (u.unit_name != dest || u.type != type || !u.is_set) continue;
+            if (u.stdp_fun != 0 || u.da_mode != "STANDARD") { throw 27; }
+
+            c.plastic = true;
+            c.a_post = (type == "E") ? u.alpha_plus : -u.alpha_plus;
+            c.a_pre = (type == "E") ? -u.alpha_minus : u.alpha_minus;
+            c.tau_pre = u.tau_plus;
+            c.tau_post = u.tau_minus;
+        }
+        if (!c.plastic) continue;
+
+        // CSC view of the CSR synapses
+        int num_syn = c.col_idx.size();
+        c.col_ptr.assign(c.num_post + 1, 0);
+        c.col_syn.resize(num_syn);
+        c.syn_pre.resize(num_syn);
+        for (int k = 0; k < num_syn; ++k) c.col_ptr[c.col_idx[k]+1]++;
+        for (int j = 0; j < c.num_post; ++j) c.col_ptr[j+1] += c.col_ptr[j];
+
+        vector<int> pos(c.col_ptr.begin(), c.col_ptr.end() - 1);
+        for (int i = 0; i < c.num_pre; ++i) {
+            for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k) {
+                c.col_syn[pos[c.col_idx[k]]++] = k;
+                c.syn_pre[k] = i;
+            }
+        }
+
+        // Per-instance weights
+        c.wt_b.resize(num_syn * batch_size);
+        for (int k = 0; k < num_syn; ++k)
+            fill(c.wt_b.begin() + k * batch_size,
+                 c.wt_b.begin() + (k + 1) * batch_size, c.wt[k]);
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE UPDATE_STDP - This method applies the STDP updates of step
+ * t to all the plastic projections. Presynaptic spikes are the ones
+ * delivered at t (emitted at t-1) and postsynaptic spikes the ones 
+ * emitted at t. Depression (pre spikes) is applied before potentiation
+ * (post spikes), so a pre spike that arrives at the step of a post spike
+ * counts as causal.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::update_stdp(int t) {
+    if (stdp_mode == STDP_OFF) return;
+
+    for (auto &c : connx) {
+        if (!c.plastic) continue;
+        counters[c.dest_grp].stdp_updates += (stdp_mode == STDP_LAZY) ?
+                                             lazy_stdp(c, t) :
+                                             eager_stdp(c, t);
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE LAZY_STDP - This method applies the STDP updates of step t
+ * to a plastic projection touching only the spiking neurons and their
+ * synapses. Each trace stores its value at its last update step and is
+ * decayed analytically, x * exp(-(t - t_last) / tau), when it is read.
+ *
+ * Args:
+ * -----
+ *  c (csr_projection &) : A plastic projection.
+ *  t (int)              : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Number of weight updates (all the instances).
+ ***************************************************************************/
+int64_t batch_core::lazy_stdp(csr_projection &c, int t) {
+    int B = batch_size;
+    float max_wt = sim_p.maxWt;
+    int64_t num_updates = 0;
+
+    // Presynaptic spikes: depression
+    for (int i = 0; i < c.num_pre; ++i) {
+        int n = perm[c.src_start+i];
+        if (spk_any[n] == 0) continue;
+        const unsigned char *s = &spk_prev[n*B];
+
+        for (int b = 0; b < B; ++b) {
+            if (s[b] == 0) continue;
+            for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k) {
+                int jb = c.col_idx[k] * B + b;
+                float x = c.x_post[jb] * expf((c.t_post[jb] - t) / c.tau_post);
+                float &w = c.wt_b[k*B+b];
+                w = min(max(w + c.a_pre * x, 0.0f), max_wt);
+            }
+            num_updates += c.row_ptr[i+1] - c.row_ptr[i];
+            int ib = i * B + b;
+            c.x_pre[ib] = c.x_pre[ib] * expf((c.t_pre[ib] - t) / c.tau_pre) + 1.0;
+            c.t_pre[ib] = t;
+        }
+    }
+
+    // Postsynaptic spikes: potentiation
+    for (int j = 0; j < c.num_post; ++j) {
+        const unsigned char *s = &spk[(c.dest_start+j)*B];
+
+        for (int b = 0; b < B; ++b) {
+            if (s[b] == 0) continue;
+            for (int e = c.col_ptr[j]; e < c.col_ptr[j+1]; ++e) {
+                int k = c.col_syn[e];
+                int ib = c.syn_pre[k] * B + b;
+                float x = c.x_pre[ib] * expf((c.t_pre[ib] - t) / c.tau_pre);
+                float &w = c.wt_b[k*B+b];
+                w = min(max(w + c.a_post * x, 0.0f), max_wt);
+            }
+            num_updates += c.col_ptr[j+1] - c.col_ptr[j];
+            int jb = j * B + b;
+            c.x_post[jb] = c.x_post[jb] * expf((c.t_post[jb] - t) / c.tau_post) + 1.0;
+            c.t_post[jb] = t;
+        }
+    }
+    return num_updates;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE EAGER_STDP - This method applies the STDP updates of step t
+ * to a plastic projection the straightforward way: all the traces decay
+ * by one step and all the synapses are visited (reference for LAZY_STDP).
+ *
+ * Args:
+ * -----
+ *  c (csr_projection &) : A plastic projection.
+ *  t (int)              : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Number of weight updates (all the instances).
+ ***************************************************************************/
+int64_t batch_core::eager_stdp(csr_projection &c, int t) {
+    int B = batch_size;
+    float max_wt = sim_p.maxWt;
+    int64_t num_updates = 0;
+    float d_pre = expf(-1.0 / c.tau_pre), d_post = expf(-1.0 / c.tau_post);
+    const int *pre = &perm[c.src_start];
+    const unsigned char *s_post = &spk[c.dest_start*B];
+
+    for (auto &x : c.x_pre) x *= d_pre;
+    for (auto &x : c.x_post) x *= d_post;
+
+    // Depression
+    for (int i = 0; i < c.num_pre; ++i) {
+        for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k) {
+            int j = c.col_idx[k];
+            for (int b = 0; b < B; ++b) {
+                float &w = c.wt_b[k*B+b];
+                if (spk_prev[pre[i]*B+b]) {
+                    w = min(max(w + c.a_pre * c.x_post[j*B+b], 0.0f), max_wt);
+                    num_updates++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < c.num_pre; ++i)
+        for (int b = 0; b < B; ++b) c.x_pre[i*B+b] += spk_prev[pre[i]*B+b];
+
+    // Potentiation
+    for (int i = 0; i < c.num_pre; ++i) {
+        for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k) {
+            int j = c.col_idx[k];
+            for (int b = 0; b < B; ++b) {
+                float &w = c.wt_b[k*B+b];
+                if (s_post[j*B+b]) {
+                    w = min(max(w + c.a_post * c.x_pre[i*B+b], 0.0f), max_wt);
+                    num_updates++;
+                }
+            }
+        }
+    }
+    for (int jb = 0; jb < c.num_post * B; ++jb) c.x_post[jb] += s_post[jb];
+    return num_updates;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE RECORD_SPIKES - This method records the spikes of step t for
+ * all the monitored groups (mflag) of all the instances. It also counts
+ * in how many instances each neuron spiked. NSAT groups of other parts
+ * are skipped and input groups are recorded only by part 0. Neurons are
+ * recorded with their original ids.
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::record_spikes(int t) {
+    int n_inp = inpc.size();
+    int n_grp = n_inp + nsatc.size();
+
+    for (int g = 0; g < n_grp; ++g) {
+        bool mflag = (g < n_inp) ? inpc[g].mflag : nsatc[g-n_inp].mflag;
+
+        if (g >= n_inp && !is_local(g)) continue;
+        mflag = mflag && is_local(g);
+        int64_t num_spikes = 0;
+        for (int n = grp_start[g]; n < grp_start[g+1]; ++n) {
+            const unsigned char *s = &spk[n*batch_size];
+            int cnt = 0;
+            for (int b = 0; b < batch_size; ++b) {
+                if (s[b] == 0) continue;
+                cnt++;
+                if (mflag) {
+                    records[b*n_grp+g].push_back(t);
+                    records[b*n_grp+g].push_back(orig[n] - grp_start[g]);
+                }
+            }
+            spk_any[n] = cnt;
+            num_spikes += cnt;
+        }
+        counters[g].spikes += num_spikes;
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE START_COUNTING, STOP_COUNTING - These methods mark the start
+ * and the end of a run for the simulation speed (see GET_SIM_RATE).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::start_counting() {
+    cur_step = run_step0 = sim_step;
+    run_wall0 = timer_core::wall_time();
+    run_wall1 = -1.0;
+}
+
+
+void batch_core::stop_counting() {
+    run_wall1 = timer_core::wall_time();
+    if (series_fp != NULL) fflush(series_fp);
+}
+
+
+/***************************************************************************
+ * BATCH_CORE COUNT_STEP - This method closes step t for the activity
+ * counters: it publishes them (see PUBLISH_COUNTERS), advances the
+ * current step and, every series_period steps, samples the counters into
+ * the time series file (see SET_COUNTERS_FILE).
+ *
+ * Args:
+ * -----
+ *  t (int) : Current simulation step (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::count_step(int t) {
+    publish_counters();
+    cur_step = t + 1;
+    if (series_fp != NULL && cur_step % series_period == 0)
+        sample_counters();
+}
+
+
+/***************************************************************************
+ * BATCH_CORE INITIALIZE_COUNTERS - This method allocates the activity
+ * counters of all the groups (constructors only). Neither they nor their
+ * published copy are reallocated afterwards, so other threads can read
+ * the copy at any time (see GET_COUNTERS).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::initialize_counters() {
+    int n = inpc.size() + nsatc.size();
+    activity_counters zero;
+
+    memset(&zero, 0, sizeof(zero));
+    counters.assign(n, zero);
+    vector<atomic<int64_t>>(4 * n).swap(shared_counters);
+    publish_counters();
+}
+
+
+/***************************************************************************
+ * BATCH_CORE PUBLISH_COUNTERS - This method copies the activity counters
+ * into their shared copy (relaxed atomic stores). It is called by the
+ * simulating thread at step boundaries.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::publish_counters() {
+    for (int g = 0; g < counters.size(); ++g) {
+        shared_counters[4*g].store(counters[g].spikes, memory_order_relaxed);
+        shared_counters[4*g+1].store(counters[g].events, memory_order_relaxed);
+        shared_counters[4*g+2].store(counters[g].dropped,
+                                     memory_order_relaxed);
+        shared_counters[4*g+3].store(counters[g].stdp_updates,
+                                     memory_order_relaxed);
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE GET_COUNTERS - This method returns the activity counters of
+ * each group as of the last completed step. It can be called from
+ * another thread during a run (e.g. NSAT_Batch_GetCounters); the 
+ * counters of different groups may then be one step apart.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  The counters of each group (vector<activity_counters>).
+ ***************************************************************************/
+vector<activity_counters> batch_core::get_counters() const {
+    vector<activity_counters> c(shared_counters.size() / 4);
+
+    for (int g = 0; g < c.size(); ++g) {
+        c[g].spikes = shared_counters[4*g].load(memory_order_relaxed);
+        c[g].events = shared_counters[4*g+1].load(memory_order_relaxed);
+        c[g].dropped = shared_counters[4*g+2].load(memory_order_relaxed);
+        c[g].stdp_updates = shared_counters[4*g+3].load(memory_order_relaxed);
+    }
+    return c;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SAMPLE_COUNTERS - This method appends one line to the time
+ * series file: the current step, the wall time since the last sample,
+ * the simulation speed over it (ms per wall second) and, for each group
+ * of this batch's part, the spikes, delivered and blanked out synaptic
+ * events and STDP updates since the last sample.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void batch_core::sample_counters() {
+    double now = timer_core::wall_time();
+    double dt = now - series_wall;
+
+    fprintf(series_fp, "%d,%.6f,%.1f", cur_step.load(), dt,
+            (dt > 0.0) ? series_period / dt : 0.0);
+    for (int g = 0; g < counters.size(); ++g) {
+        if (g >= inpc.size() && !is_local(g)) continue;
+        const activity_counters &c = counters[g], &l = series_last[g];
+        fprintf(series_fp, ",%lld,%lld,%lld,%lld",
+                static_cast<long long>(c.spikes - l.spikes),
+                static_cast<long long>(c.events - l.events),
+                static_cast<long long>(c.dropped - l.dropped),
+                static_cast<long long>(c.stdp_updates - l.stdp_updates));
+    }
+    fprintf(series_fp, "\n");
+    series_last = counters;
+    series_wall = now;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_COUNTERS_FILE - This method starts sampling the activity
+ * counters every period steps into a CSV file (one column per group and
+ * counter, see SAMPLE_COUNTERS), or stops it if the path is empty.
+ *
+ * Args:
+ * -----
+ *  path (string) : Time series file name.
+ *  period (int)  : Sampling period (steps).
+ *
+ * Returns:
+ * --------
+ *  0 if the file is succesfully opened.
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write results file.
+ ***************************************************************************/
+int batch_core::set_counters_file(const string &path, int period) {
+    if (series_fp != NULL) fclose(series_fp);
+    series_fp = NULL;
+    if (path.empty()) return 0;
+
+    if ((series_fp = fopen(path.c_str(), "w")) == NULL) { throw 15; }
+    series_period = max(period, 1);
+    series_last = counters;
+    series_wall = timer_core::wall_time();
+
+    fprintf(series_fp, "step,wall_s,sim_ms_per_s");
+    for (int g = 0; g < inpc.size() + nsatc.size(); ++g) {
+        if (g >= inpc.size() && !is_local(g)) continue;
+        const string &name = (g < inpc.size()) ? inpc[g].unit_name :
+                                                 nsatc[g-inpc.size()].unit_name;
+        fprintf(series_fp, ",%s_spikes,%s_events,%s_dropped,%s_stdp",
+                name.c_str(), name.c_str(), name.c_str(), name.c_str());
+    }
+    fprintf(series_fp, "\n");
+    return 0;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE GET_SIM_RATE - This method returns the simulation speed of
+ * the current (or last) run: simulated ms per wall second.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Simulated ms per second (0 before the first step).
+ ***************************************************************************/
+double batch_core::get_sim_rate() const {
+    int steps = cur_step - run_step0;
+    double end = run_wall1;
+    if (end < 0.0) end = timer_core::wall_time();
+    double dt = end - run_wall0;
+
+    if (steps <= 0 || dt <= 0.0) return 0.0;
+    return steps / dt;
+}
+
+
+/***************************************************************************
+ * SORT_RECORDS - Sorts the neuron ids of each step of a record of (time,
+ * neuron id) pairs, so a reordered batch writes them in the same order.
+ ***************************************************************************/
+static void sort_records(vector<int> &rec) {
+    vector<int> ids;
+
+    for (size_t k = 0; k < rec.size(); ) {
+        size_t end = k;
+        ids.clear();
+        for (; end < rec.size() && rec[end] == rec[k]; end += 2)
+            ids.push_back(rec[end+1]);
+        sort(ids.begin(), ids.end());
+        for (size_t e = 0; e < ids.size(); ++e) rec[k+2*e+1] = ids[e];
+        k = end;
+    }
+}
+
+
+/***************************************************************************
+ * BATCH_CORE WRITE_SPIKES - This method writes the recorded spikes of
+ * each instance and monitored group to dir/batch<b>/spk<group name>.dat,
+ * following the CARLsim spike file layout (signature, version and grid
+ * dimensions followed by (time, neuron id) pairs). Only the groups of
+ * this batch's part are written. The neurons that spike at the same
+ * step are written by increasing (original) id.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if all the files are succesfully written, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write a results file.
+ ***************************************************************************/
+int batch_core::write_spikes() {
+    int n_inp = inpc.size();
+    int n_grp = n_inp + nsatc.size();
+    int signature = 206661989;
+    float version = 0.2;
+
+    for (int b = 0; b < batch_size; ++b) {
+        string dir = results_dir + "/batch" + to_string(b);
+        make_dirs(dir);
+
+        for (int g = 0; g < n_grp; ++g) {
+            bool mflag = (g < n_inp) ? inpc[g].mflag : nsatc[g-n_inp].mflag;
+            if (!mflag || !is_local(g)) continue;
+
+            string name = (g < n_inp) ? inpc[g].unit_name
+                                      : nsatc[g-n_inp].unit_name;
+            int grid[3] = {grp_start[g+1] - grp_start[g], 1, 1};
+            vector<int> &rec = records[b*n_grp+g];
+            if (reorder) sort_records(rec);
+
+            ofstream out(dir + "/spk" + name + ".dat", ios::binary);
+            if (!out) { throw 15; }
+            out.write((char *) &signature, sizeof(int));
+            out.write((char *) &version, sizeof(float));
+            out.write((char *) grid, 3 * sizeof(int));
+            out.write((char *) rec.data(), rec.size() * sizeof(int));
+            out.close();
+        }
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE COMPILE - This method writes a set up (whole) network to an
+ * image file that a batch can load (see the image constructor). The
+ * image holds the groups parameters as one array per parameter (SoA),
+ * all the CSR projections (concatenated per array), the spike trains and
+ * the STDP configuration (mode and curves), plus the seed and the run
+ * length and the internal order of the neurons (see INITIALIZE_ORDER),
+ * which the loaded batch keeps. Delays are always 1 ms in a batch, so
+ * they are not stored. Sections are page-aligned and hold no pointers,
+ * so the image can be mapped anywhere.
+ *
+ * Args:
+ * -----
+ *  path (string) : Network image file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the image is succesfully written, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+int batch_core::compile(const string &path) {
+    ckpt_core ckpt;
+    int n_inp = inpc.size(), n_nsat = nsatc.size();
+    vector<int> meta, size, tau_ref, train_ptr(1, 0), train_times;
+    vector<int> proj_int, row_ptr, col_idx, stdp_int;
+    vector<unsigned int> utype;
+    vector<unsigned char> mflag, zero, row_drop;
+    vector<float> rate, freq, alpha, beta, sigma, v_th, v_reset, alphaS, bias;
+    vector<float> proj_float, wt, pdrop, row_q, row_lq, row_psum, row_pvar;
+    vector<float> stdp_float;
+    vector<char> names;
+    float max_wt = sim_p.maxWt;
+
+    if (connx.empty() || !grp_owner.empty()) { throw 25; }
+
+    // Groups
+    for (auto &u : inpc) {
+        names.insert(names.end(), u.unit_name.begin(), u.unit_name.end());
+        names.push_back('\0');
+        size.push_back(u.num_neurons);
+        utype.push_back(u.unit_type);
+        mflag.push_back(u.mflag);
+        rate.push_back(u.spkg_p.rate);
+        freq.push_back(u.spkg_p.freq);
+        zero.push_back(u.spkg_p.spk_at_zero);
+    }
+    for (auto &u : nsatc) {
+        names.insert(names.end(), u.unit_name.begin(), u.unit_name.end());
+        names.push_back('\0');
+        size.push_back(u.num_neurons);
+        utype.push_back(u.unit_type);
+        mflag.push_back(u.mflag);
+        alpha.push_back(u.nsat_p.alpha);
+        beta.push_back(u.nsat_p.beta);
+        sigma.push_back(u.nsat_p.sigma);
+        v_th.push_back(u.nsat_p.v_th);
+        v_reset.push_back(u.nsat_p.v_reset);
+        alphaS.push_back(u.nsat_p.alphaS);
+        bias.push_back(u.nsat_p.b);
+        tau_ref.push_back(u.nsat_p.tau_ref);
+    }
+
+    // Spike trains
+    for (auto &train : spike_trains) {
+        train_times.insert(train_times.end(), train.begin(), train.end());
+        train_ptr.push_back(train_times.size());
+    }
+
+    // STDP curves
+    for (auto &u : stdpc) {
+        int g = -1;
+        for (int k = 0; k < n_nsat; ++k)
+            if (nsatc[k].unit_name == u.unit_name) g = k;
+        if (g < 0) continue;
+        stdp_int.push_back(g);
+        stdp_int.push_back(u.type == "E" ? 0 : 1);
+        stdp_int.push_back(u.stdp_fun);
+        stdp_int.push_back(u.is_set);
+        stdp_int.push_back(u.da_mode == "STANDARD");
+        stdp_float.push_back(u.alpha_plus);
+        stdp_float.push_back(u.tau_plus);
+        stdp_float.push_back(u.alpha_minus);
+        stdp_float.push_back(u.tau_minus);
+    }
+
+    // Projections
+    for (auto &c : connx) {
+        proj_int.push_back(c.src_grp);
+        proj_int.push_back(c.dest_grp);
+        proj_int.push_back(c.num_pre);
+        proj_int.push_back(c.num_post);
+        proj_int.push_back(c.col_idx.size());
+        proj_int.push_back(!c.pdrop.empty());
+        proj_float.push_back(c.sign);
+        proj_float.push_back(c.prob);
+
+        row_ptr.insert(row_ptr.end(), c.row_ptr.begin(), c.row_ptr.end());
+        col_idx.insert(col_idx.end(), c.col_idx.begin(), c.col_idx.end());
+        wt.insert(wt.end(), c.wt.begin(), c.wt.end());
+        pdrop.insert(pdrop.end(), c.pdrop.begin(), c.pdrop.end());
+        row_q.insert(row_q.end(), c.row_q.begin(), c.row_q.end());
+        row_lq.insert(row_lq.end(), c.row_lq.begin(), c.row_lq.end());
+        row_drop.insert(row_drop.end(), c.row_drop.begin(), c.row_drop.end());
+        row_psum.insert(row_psum.end(), c.row_psum.begin(), c.row_psum.end());
+        row_pvar.insert(row_pvar.end(), c.row_pvar.begin(), c.row_pvar.end());
+    }
+
+    meta.push_back(n_inp);
+    meta.push_back(n_nsat);
+    meta.push_back(connx.size());
+    meta.push_back(carl_p.random_seed);
+    meta.push_back(sim_p.sim_time_sec);
+    meta.push_back(sim_p.sim_time_msec);
+    meta.push_back(stdp_mode);
+    meta.push_back(stdp_int.size() / 5);
+    meta.push_back(spike_trains.size());
+
+    ckpt.add("image_meta", meta);
+    ckpt.add("max_wt", &max_wt, sizeof(float), 1);
+    ckpt.add("input_type", input_type.data(), 1, input_type.size());
+    ckpt.add("grp_names", names);
+    ckpt.add("grp_size", size);
+    ckpt.add("grp_type", utype);
+    ckpt.add("grp_mflag", mflag);
+    ckpt.add("inp_rate", rate);
+    ckpt.add("inp_freq", freq);
+    ckpt.add("inp_zero", zero);
+    ckpt.add("nsat_alpha", alpha);
+    ckpt.add("nsat_beta", beta);
+    ckpt.add("nsat_sigma", sigma);
+    ckpt.add("nsat_v_th", v_th);
+    ckpt.add("nsat_v_reset", v_reset);
+    ckpt.add("nsat_alphaS", alphaS);
+    ckpt.add("nsat_b", bias);
+    ckpt.add("nsat_tau_ref", tau_ref);
+    ckpt.add("train_ptr", train_ptr);
+    ckpt.add("train_times", train_times);
+    ckpt.add("stdp_int", stdp_int);
+    ckpt.add("stdp_float", stdp_float);
+    ckpt.add("proj_int", proj_int);
+    ckpt.add("proj_float", proj_float);
+    ckpt.add("row_ptr", row_ptr);
+    ckpt.add("col_idx", col_idx);
+    ckpt.add("wt", wt);
+    ckpt.add("pdrop", pdrop);
+    ckpt.add("row_q", row_q);
+    ckpt.add("row_lq", row_lq);
+    ckpt.add("row_drop", row_drop);
+    ckpt.add("row_psum", row_psum);
+    ckpt.add("row_pvar", row_pvar);
+    ckpt.add("neuron_order", orig);
+    return ckpt.write(path);
+}
+
+
+/***************************************************************************
+ * BATCH_CORE B_SETUP_STATE - This method builds the batched network: the
+ * groups, the shared projections and the per-instance state. Batches 
+ * loaded from an image already have their projections.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, if successfully builds the network,
+ *  otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  14 : Input type not supported in batch mode.
+ *  16 : Missing spike trains for input groups.
+ *  27 : STDP mode/curve not supported in batch mode.
+ *  See auxiliary.cpp for more about exceptions.
+ ***************************************************************************/
+int batch_core::b_setup_state() {
+    int flag = 0;
+    trace_scope scope("b_setup_state");
+
+    try {
+        if (input_type != "poisson" && input_type != "poisson_schedule" &&
+            input_type != "periodical" && input_type != "vectorial") {
+            throw 14;
+        }
+        if (input_type == "vectorial") {
+            if (spike_trains.size() < inpc.size()) { throw 16; }
+            for (auto &train : spike_trains) sort(train.begin(), train.end());
+        }
+
+        input_rates.clear();
+        for (auto &u : inpc)
+            input_rates.push_back(vector<float>(u.num_neurons, u.spkg_p.rate));
+
+        flag = initialize_groups();
+        initialize_order();
+        if (!from_image) flag = initialize_connexions();
+        initialize_stdp();
+        flag = initialize_state();
+        select_kernels();
+    }
+    catch (int &e) {
+        flag = error(e);
+    }
+    return flag;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE B_RUN_STATE - This method simulates all the instances in
+ * lockstep for sim_time_sec seconds and sim_time_msec ms (continuing from
+ * the current step, e.g. a restored checkpoint) and writes their spike
+ * files.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, when the network has been simulated
+ *  successfully. Otherwise it throws an exception.
+ ***************************************************************************/
+int batch_core::b_run_state() {
+    int flag = 0;
+    trace_scope scope("b_run_state");
+
+    try {
+        // Every run writes only its own spikes
+        for (auto &rec : records) rec.clear();
+        if (input_type != "poisson") build_schedule();
+
+        double t_slice = trace_enabled() ? trace_now() : 0.0;
+        start_counting();
+        for (int t = sim_step; t < sim_step + num_steps; ++t) {
+            spk.swap(spk_prev);
+            generate_inputs(t);
+            deliver_spikes(t);
+            update_neurons(t);
+            update_stdp(t);
+            record_spikes(t);
+            count_step(t);
+
+            // One trace event per simulated second
+            if (trace_enabled() &&
+                ((t + 1) % 1000 == 0 || t + 1 == sim_step + num_steps)) {
+                double now = trace_now();
+                trace_complete("slice", t_slice, now - t_slice,
+                               to_string(t + 1) + " ms");
+                t_slice = now;
+            }
+        }
+        stop_counting();
+        sim_step += num_steps;
+
+        trace_scope write_scope("write_spikes");
+        flag = write_spikes();
+    }
+    catch (int &e) {
+        flag = error(e);
+    }
+    return flag;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE CHECKPOINT - This method writes the full state of all the
+ * instances to a checkpoint file (see ckpt_core.h): the simulation step,
+ * membrane potentials, synaptic currents, refractory counters, last
+ * spikes, the random seeds and the current synaptic weights (random
+ * numbers are counter-based, so they need no other state). Plastic 
+ * projections add their per-instance weights and STDP traces. The state
+ * is stored in the internal order, along with the order itself.
+ *
+ * Args:
+ * -----
+ *  path (string) : Checkpoint file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the checkpoint is succesfully written, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ ***************************************************************************/
+int batch_core::checkpoint(const string &path) {
+    ckpt_core ckpt;
+    vector<int> meta, trace_steps;
+    vector<float> weights, stdp_wt, traces;
+
+    meta.push_back(sim_step);
+    meta.push_back(batch_size);
+    meta.push_back(num_neurons);
+    meta.push_back(connx.size());
+
+    for (auto &c : connx) {
+        weights.insert(weights.end(), c.wt.begin(), c.wt.end());
+        if (!c.plastic) continue;
+        stdp_wt.insert(stdp_wt.end(), c.wt_b.begin(), c.wt_b.end());
+        traces.insert(traces.end(), c.x_pre.begin(), c.x_pre.end());
+        traces.insert(traces.end(), c.x_post.begin(), c.x_post.end());
+        trace_steps.insert(trace_steps.end(), c.t_pre.begin(), c.t_pre.end());
+        trace_steps.insert(trace_steps.end(), c.t_post.begin(), c.t_post.end());
+    }
+
+    ckpt.add("meta", meta);
+    ckpt.add("v", v);
+    ckpt.add("isyn", isyn);
+    ckpt.add("ref", ref);
+    ckpt.add("spk", spk);
+    ckpt.add("spk_any", spk_any);
+    ckpt.add("weights", weights);
+    ckpt.add("seeds", rng_seeds);
+    ckpt.add("stdp_wt", stdp_wt);
+    ckpt.add("traces", traces);
+    ckpt.add("trace_steps", trace_steps);
+    ckpt.add("neuron_order", orig);
+    return ckpt.write(path);
+}
+
+
+/***************************************************************************
+ * BATCH_CORE RESTORE - This method restores a checkpoint (see CHECKPOINT)
+ * on a set up batch (B_SETUP_STATE) of the same network, batch size,
+ * STDP mode and neuron order (see SET_REORDER). The next B_RUN_STATE
+ * continues from the checkpoint's step.
+ *
+ * Args:
+ * -----
+ *  path (string) : Checkpoint file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the checkpoint is succesfully restored, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ *  23 : Not a valid (or not compatible) checkpoint file.
+ ***************************************************************************/
+int batch_core::restore(const string &path) {
+    ckpt_core ckpt;
+    vector<int> meta, trace_steps;
+    vector<float> weights, stdp_wt, traces;
+    vector<float> v_c, isyn_c;
+    vector<int> ref_c, spk_any_c;
+    vector<unsigned char> spk_c;
+    vector<uint32_t> s;
+    size_t size = num_neurons * batch_size;
+    size_t k = 0, kw = 0, kx = 0;
+
+    ckpt.open(path);
+    ckpt.get("meta", meta);
+    if (meta.size() != 4 || meta[1] != batch_size ||
+        meta[2] != num_neurons || meta[3] != connx.size()) { throw 23; }
+
+    // The state is in the internal order (older checkpoints: identity)
+    vector<int> order;
+    if (ckpt.has("neuron_order")) ckpt.get("neuron_order", order);
+    else for (int n = 0; n < num_neurons; ++n) order.push_back(n);
+    if (order != orig) { throw 23; }
+
+    // Check every section's size before touching the batch
+    ckpt.get("v", v_c);
+    ckpt.get("isyn", isyn_c);
+    ckpt.get("ref", ref_c);
+    ckpt.get("spk", spk_c);
+    ckpt.get("spk_any", spk_any_c);
+    if (v_c.size() != size || isyn_c.size() != size ||
+        ref_c.size() != size || spk_c.size() != size ||
+        spk_any_c.size() != num_neurons) { throw 23; }
+    ckpt.get("seeds", s);
+    if (s.size() != batch_size) { throw 23; }
+
+    ckpt.get("weights", weights);
+    ckpt.get("stdp_wt", stdp_wt);
+    ckpt.get("traces", traces);
+    ckpt.get("trace_steps", trace_steps);
+    for (auto &c : connx) {
+        k += c.wt.size();
+        if (!c.plastic) continue;
+        kw += c.wt_b.size();
+        kx += c.x_pre.size() + c.x_post.size();
+    }
+    if (k != weights.size() || kw != stdp_wt.size() ||
+        kx != traces.size() || kx != trace_steps.size()) { throw 23; }
+
+    k = kw = kx = 0;
+    for (auto &c : connx) {
+        copy(weights.begin() + k, weights.begin() + k + c.wt.size(),
+             c.wt.begin());
+        k += c.wt.size();
+        if (!c.plastic) continue;
+
+        size_t nx = c.x_pre.size(), ny = c.x_post.size();
+        copy(stdp_wt.begin() + kw, stdp_wt.begin() + kw + c.wt_b.size(),
+             c.wt_b.begin());
+        copy(traces.begin() + kx, traces.begin() + kx + nx, c.x_pre.begin());
+        copy(traces.begin() + kx + nx, traces.begin() + kx + nx + ny,
+             c.x_post.begin());
+        copy(trace_steps.begin() + kx, trace_steps.begin() + kx + nx,
+             c.t_pre.begin());
+        copy(trace_steps.begin() + kx + nx, trace_steps.begin() + kx + nx + ny,
+             c.t_post.begin());
+        kw += c.wt_b.size();
+        kx += nx + ny;
+    }
+
+    v.swap(v_c);
+    isyn.swap(isyn_c);
+    ref.swap(ref_c);
+    spk.swap(spk_c);
+    spk_any.swap(spk_any_c);
+    rng_seeds = s;
+    seeds.assign(s.begin(), s.end());
+
+    sim_step = meta[0];
+    return 0;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_INPUT_RATES - This method sets one rate per neuron of a
+ * Poisson input group (the same for all the instances). It can be called
+ * between runs.
+ *
+ * Args:
+ * -----
+ *  grp (int)             : Input group's index.
+ *  rates (vector<float>) : New rates (Hz), one per neuron of the group.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  8  : Not a valid input type.
+ *  24 : Mismatch between input size and number of neurons.
+ ***************************************************************************/
+void batch_core::set_input_rates(int grp, const vector<float> &rates) {
+    if (input_type != "poisson" && input_type != "poisson_schedule") {
+        throw 8;
+    }
+    if (grp < 0 || grp >= inpc.size()) { throw 6; }
+    if (rates.size() != inpc[grp].num_neurons) { throw 24; }
+
+    input_rates[grp] = rates;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_INPUT_VECTOR - This method swaps the spike train of a
+ * vectorial input group. The spike times are steps since the start (or
+ * since the last RESET_STATE).
+ *
+ * Args:
+ * -----
+ *  grp (int)           : Input group's index.
+ *  times (vector<int>) : New spike times (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  8  : Not a valid input type.
+ ***************************************************************************/
+void batch_core::set_input_vector(int grp, const vector<int> &times) {
+    if (input_type != "vectorial") { throw 8; }
+    if (grp < 0 || grp >= spike_trains.size()) { throw 6; }
+
+    spike_trains[grp] = times;
+    sort(spike_trains[grp].begin(), spike_trains[grp].end());
+}
+
+
+/***************************************************************************
+ * BATCH_CORE RESET_STATE - This method prepares a set up batch for a new
+ * trial without rebuilding the projections: membrane potentials, 
+ * synaptic currents, refractory counters, spikes and records are reset
+ * and the simulation step goes back to 0, so the random numbers start 
+ * over (unless new seeds are set). STDP traces are cleared. The weights
+ * (including the per-instance plastic ones) are either kept or set back
+ * to their initial values.
+ *
+ * Args:
+ * -----
+ *  keep_weights (bool) : If false the initial weights are restored.
+ *
+ * Returns:
+ * --------
+ *  0 if the state is succesfully reset.
+ ***************************************************************************/
+int batch_core::reset_state(bool keep_weights) {
+    if (!keep_weights) {
+        for (int c = 0; c < connx.size(); ++c) connx[c].wt = init_weights[c];
+        initialize_stdp();
+    }
+    return initialize_state();
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_NSAT_PARAM - This method changes a NSAT parameter of a
+ * group (all the instances). The neurons read their parameters at every
+ * step, so the new value applies from the next step on.
+ *
+ * Args:
+ * -----
+ *  group (string) : NSAT group's name.
+ *  param (string) : Parameter's name (alpha, beta, sigma, v_th, v_reset,
+ *                   alphaS, b, tau_ref).
+ *  value (float)  : New value.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  17 : Not a valid parameter name.
+ ***************************************************************************/
+void batch_core::set_nsat_param(const string &group,
+                                const string &param,
+                                float value) {
+    for (auto &u : nsatc) {
+        if (u.unit_name != group) continue;
+        ::set_nsat_param(u.nsat_p, param, value);
+        select_kernels();
+        return;
+    }
+    throw 6;
+}
+
+
+/***************************************************************************
+ * BATCH_CORE SET_WEIGHTS - This method replaces the weights of a shared
+ * projection from a dense [pre][post] (row-major) buffer. The CSR 
+ * structure is kept: only the weights of the existing synapses are 
+ * changed and the rest of the buffer is ignored. Plastic projections
+ * get the new weights in all the instances.
+ *
+ * Args:
+ * -----
+ *  proj (int)         : Projection's index (order of the connections
+ *                       files).
+ *  wt (vector<float>) : New weights, num_pre * num_post values.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  24 : Mismatch between input size and number of neurons.
+ *  25 : Not allowed in the current simulation state (other part).
+ ***************************************************************************/
+void batch_core::set_weights(int proj, const vector<float> &wt) {
+    if (proj < 0 || proj >= connx.size()) { throw 6; }
+
+    csr_projection &c = connx[proj];
+    if (!is_local(c.dest_grp)) { throw 25; }
+    if (wt.size() != c.num_pre * c.num_post) { throw 24; }
+
+    const int *post = &orig[c.dest_start];
+    for (int i = 0; i < c.num_pre; ++i)
+        for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k)
+            c.wt[k] = wt[i*c.num_post+post[c.col_idx[k]]-c.dest_start];
+
+    for (int k = 0; k < c.wt_b.size(); ++k)
+        c.wt_b[k] = c.wt[k/batch_size];
+}
+
+
+/***************************************************************************
+ * BATCH_CORE GET_WEIGHTS - This method returns the weights of a 
+ * projection in one instance as a dense [pre][post] (row-major) buffer
+ * (zero where there is no synapse). Only plastic projections differ 
+ * between instances.
+ *
+ * Args:
+ * -----
+ *  proj (int) : Projection's index (order of the connections files).
+ *  b (int)    : Instance's index.
+ *
+ * Returns:
+ * --------
+ *  The weights (vector<float>), num_pre * num_post values.
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  13 : Not a valid batch size.
+ *  25 : Not allowed in the current simulation state (other part).
+ ***************************************************************************/
+vector<float> batch_core::get_weights(int proj, int b) {
+    if (proj < 0 || proj >= connx.size()) { throw 6; }
+    if (b < 0 || b >= batch_size) { throw 13; }
+
+    const csr_projection &c = connx[proj];
+    if (!is_local(c.dest_grp)) { throw 25; }
+    vector<float> wt(c.num_pre * c.num_post, 0.0);
+    const int *post = &orig[c.dest_start];
+    for (int i = 0; i < c.num_pre; ++i)
+        for (int k = c.row_ptr[i]; k < c.row_ptr[i+1]; ++k)
+            wt[i*c.num_post+post[c.col_idx[k]]-c.dest_start] =
+                c.plastic ? c.wt_b[k*batch_size+b] : c.wt[k];
+    return wt;
+}
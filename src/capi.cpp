@@ -0,0 +1,322 @@
+#include "nsat_core.h"
+#include "batch_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * Substitute of Python ctypes ABI (since it does not exist one for C++)
+ * Set MAKE_FLAG to 0 in order to compile as standalone running software
+ * Set MAKE_FLAG to 1 in order to compile as a dynamic shared library
+ * (this file is compiled only into the shared library, see unity.cpp)
+ **************************************************************************/
+#if (MAKE_FLAG == 1)
+    extern "C" {
+        nsat_core *NSAT_Core_New(carlsim *carl, simulation *simu, filenames *files) { 
+            return new nsat_core(files, carl, simu);
+        }
+        // In-memory construction: an empty core, then the groups (struct
+        // arrays) and the connections (row-major [pre][post] or CSR
+        // buffers) - see the nsat_core methods
+        nsat_core *NSAT_Core_NewInMemory(carlsim *carl, simulation *simu) {
+            return new nsat_core(carl, simu);
+        }
+        int NSAT_Core_AddInputGroups(nsat_core *obj, int n, char **names,
+                                     int *num_neurons, char **types,
+                                     spkg *params, bool *mflags) {
+            try {
+                for (int i = 0; i < n; ++i)
+                    obj->add_input_group(names[i], num_neurons[i], types[i],
+                                         params[i], mflags[i]);
+            }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_AddNSATGroups(nsat_core *obj, int n, char **names,
+                                    int *num_neurons, char **types,
+                                    nsat *params, bool *mflags) {
+            try {
+                for (int i = 0; i < n; ++i)
+                    obj->add_nsat_group(names[i], num_neurons[i], types[i],
+                                        params[i], mflags[i]);
+            }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_AddProjection(nsat_core *obj, char *src, char *dest,
+                                    float *wt, int num_pre, int num_post,
+                                    float prob, float std) {
+            try {
+                obj->add_projection(src, dest, wt, num_pre, num_post, prob,
+                                    std);
+            }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_AddProjectionCSR(nsat_core *obj, char *src, char *dest,
+                                       int *indptr, int *indices, float *data,
+                                       int num_pre, int num_post, float prob,
+                                       float std) {
+            try {
+                obj->add_projection_csr(src, dest, indptr, indices, data,
+                                        num_pre, num_post, prob, std);
+            }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_InitInput(nsat_core *obj, void *ptr, int nspkt, int length) {
+            try { obj->initialize_custom_input(ptr, nspkt, length); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_ReadStructArray(nsat_core *obj, void *ptr, int size) {
+            try { obj->read_struct_array(ptr, size); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_Config(nsat_core *obj) {
+            try { return obj->c_config_state(); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_Setup(nsat_core *obj) {
+            try { return obj->c_setup_state(); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_Run(nsat_core *obj) {
+            try { return obj->c_run_state(); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_CleanUp(nsat_core *obj) {
+            try { return obj->c_cleanup(); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_EnableCheckpoints(nsat_core *obj) {
+            try { obj->enable_checkpoints(); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_Checkpoint(nsat_core *obj, char *path) {
+            try { return obj->checkpoint(path); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_Restore(nsat_core *obj, char *path) {
+            try { return obj->restore(path); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_Reset(nsat_core *obj, int keep_weights) {
+            try { return obj->reset_state(keep_weights != 0); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Core_SetInputRates(nsat_core *obj, int grp, float *rates,
+                                    int size) {
+            try { obj->set_input_rates(grp, vector<float>(rates, rates + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_SetInputVector(nsat_core *obj, int grp, int *times,
+                                     int size) {
+            try { obj->set_input_vector(grp, vector<int>(times, times + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_SetNSATParam(nsat_core *obj, char *group, char *param,
+                                   float value) {
+            try { obj->update_nsat(group, param, value); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_SetSTDPParam(nsat_core *obj, char *group, char *param,
+                                   float value) {
+            try { obj->update_stdp(group, param, value); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_SetWeights(nsat_core *obj, int conn, float *wt,
+                                 int size) {
+            try { obj->set_weights(conn, vector<float>(wt, wt + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        // Phase timings (off by default): 0 off, 1 on, 2 with memory
+        void NSAT_Core_EnableTimings(nsat_core *obj, int on) {
+            obj->get_timer().enable(on != 0);
+            obj->get_timer().enable_memory(on == 2);
+        }
+        // Copies the timings (JSON) into buf and returns their length
+        // (call with size 0 to get the size of the buffer)
+        int NSAT_Core_GetTimings(nsat_core *obj, char *buf, int size) {
+            string json = obj->get_timer().to_json();
+            if (size > 0) {
+                int n = min(static_cast<int>(json.size()), size - 1);
+                memcpy(buf, json.data(), n);
+                buf[n] = '\0';
+            }
+            return json.size();
+        }
+        // Memory budget (MB, 0: none) and accounting (JSON, like
+        // NSAT_Core_GetTimings)
+        void NSAT_Core_SetMemoryBudget(nsat_core *obj, double mb) {
+            obj->get_memory().set_budget(mb * 1024.0 * 1024.0);
+        }
+        int NSAT_Core_GetMemory(nsat_core *obj, char *buf, int size) {
+            string json = obj->get_memory().to_json();
+            if (size > 0) {
+                int n = min(static_cast<int>(json.size()), size - 1);
+                memcpy(buf, json.data(), n);
+                buf[n] = '\0';
+            }
+            return json.size();
+        }
+        // Per-instance outputs (results and log file) and the last error
+        // of the instance (0: none)
+        int NSAT_Core_SetResultsDir(nsat_core *obj, char *dir) {
+            try { obj->set_results_dir(dir); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_SetLogFile(nsat_core *obj, char *path) {
+            try { obj->set_log_file(path); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_GetLastError(nsat_core *obj) {
+            return obj->get_last_error();
+        }
+        // Chrome trace-event timeline (see trace_core.h)
+        void NSAT_Trace_Start(char *path) { trace_start(path); }
+        int NSAT_Trace_Stop() { return trace_stop(); }
+        // Asynchronous run: the run state on an internal thread in slices
+        // of slice_ms (Poll: 1 while running, simulated time and spikes
+        // at the end of the last slice; Wait/Cancel: the run's result)
+        int NSAT_Core_RunAsync(nsat_core *obj, int slice_ms) {
+            try { obj->run_async(slice_ms); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Core_Poll(nsat_core *obj, int *sim_ms, long long *spikes) {
+            int ms;
+            int64_t n;
+            bool running = obj->poll(ms, n);
+            if (sim_ms) *sim_ms = ms;
+            if (spikes) *spikes = n;
+            return running;
+        }
+        int NSAT_Core_Wait(nsat_core *obj) { return obj->wait(); }
+        int NSAT_Core_Cancel(nsat_core *obj) { return obj->cancel(); }
+        void NSAT_Core_Exit(nsat_core *obj){ delete obj; }
+    }
+#endif
+
+
+/***************************************************************************
+ * Batch mode Python ctypes ABI (see above)
+ **************************************************************************/
+#if (MAKE_FLAG == 1)
+    extern "C" {
+        batch_core *NSAT_Batch_New(nsat_core *obj, int batch_size) {
+            try { return new batch_core(obj, batch_size); }
+            catch (int &e) { obj->error(e); return NULL; }
+        }
+        batch_core *NSAT_Batch_Load(char *path, int batch_size) {
+            // No instance to report to yet (standard output)
+            try { return new batch_core(string(path), batch_size); }
+            catch (int &e) { print_exceptions(e); return NULL; }
+        }
+        int NSAT_Batch_Compile(batch_core *obj, char *path) {
+            try { return obj->compile(path); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Batch_SetSeeds(batch_core *obj, int *seeds, int size) {
+            try { obj->set_seeds(vector<int>(seeds, seeds + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_SetReorder(batch_core *obj, int flag) {
+            try { obj->set_reorder(flag != 0); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_SetLogFile(batch_core *obj, char *path) {
+            try { obj->set_log_file(path); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_GetLastError(batch_core *obj) {
+            return obj->get_last_error();
+        }
+        int NSAT_Batch_Setup(batch_core *obj){ return obj->b_setup_state(); }
+        int NSAT_Batch_Run(batch_core *obj){ return obj->b_run_state(); }
+        int NSAT_Batch_Checkpoint(batch_core *obj, char *path) {
+            try { return obj->checkpoint(path); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Batch_Restore(batch_core *obj, char *path) {
+            try { return obj->restore(path); }
+            catch (int &e) { return obj->error(e); }
+        }
+        int NSAT_Batch_Reset(batch_core *obj, int keep_weights) {
+            return obj->reset_state(keep_weights != 0);
+        }
+        int NSAT_Batch_SetInputRates(batch_core *obj, int grp, float *rates,
+                                     int size) {
+            try { obj->set_input_rates(grp, vector<float>(rates, rates + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_SetInputVector(batch_core *obj, int grp, int *times,
+                                      int size) {
+            try { obj->set_input_vector(grp, vector<int>(times, times + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_SetNSATParam(batch_core *obj, char *group,
+                                    char *param, float value) {
+            try { obj->set_nsat_param(group, param, value); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_SetWeights(batch_core *obj, int proj, float *wt,
+                                  int size) {
+            try { obj->set_weights(proj, vector<float>(wt, wt + size)); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_SetSTDPMode(batch_core *obj, int mode) {
+            try { obj->set_stdp_mode(mode); }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        int NSAT_Batch_GetWeights(batch_core *obj, int proj, int b,
+                                  float *wt, int size) {
+            try {
+                vector<float> w = obj->get_weights(proj, b);
+                if (w.size() != size) { throw 24; }
+                copy(w.begin(), w.end(), wt);
+            }
+            catch (int &e) { return obj->error(e); }
+            return 0;
+        }
+        // Copies the counters (spikes, events, dropped, STDP updates of
+        // each group, as of the last completed step - it can be polled
+        // during a run) into buf and returns the number of groups
+        int NSAT_Batch_GetCounters(batch_core *obj, long long *buf, int size) {
+            vector<activity_counters> c = obj->get_counters();
+            for (int g = 0; g < c.size() && 4 * g + 3 < size; ++g) {
+                buf[4*g] = c[g].spikes;
+                buf[4*g+1] = c[g].events;
+                buf[4*g+2] = c[g].dropped;
+                buf[4*g+3] = c[g].stdp_updates;
+            }
+            return c.size();
+        }
+        double NSAT_Batch_GetSimRate(batch_core *obj) {
+            return obj->get_sim_rate();
+        }
+        int NSAT_Batch_SetCountersFile(batch_core *obj, char *path,
+                                       int period) {
+            try { return obj->set_counters_file(path, period); }
+            catch (int &e) { return obj->error(e); }
+        }
+        void NSAT_Batch_Exit(batch_core *obj){ delete obj; }
+    }
+#endif
@@ -0,0 +1,254 @@
+#include "ckpt_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * CKPT_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * CKPT_CORE Class Constructor.
+ ***************************************************************************/
+ckpt_core::ckpt_core() {
+    fd = -1;
+    map = NULL;
+    map_size = 0;
+}
+
+
+/***************************************************************************
+ * CKPT_CORE Class Destructor - It unmaps the file (if any).
+ ***************************************************************************/
+ckpt_core::~ckpt_core() {
+    close();
+}
+
+
+/***************************************************************************
+ * CKPT_CORE ADD - This method adds a section to be written. The data are
+ * not copied, so they have to stay alive until WRITE.
+ *
+ * Args:
+ * -----
+ *  name (string)     : Section's name (up to 23 characters).
+ *  ptr (void *)      : Section's data.
+ *  elem_size (int)   : Size of one element (bytes).
+ *  count (int)       : Number of elements.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void ckpt_core::add(const string &name,
+                    const void *ptr,
+                    size_t elem_size,
+                    size_t count) {
+    ckpt_section sec;
+
+    memset(&sec, 0, sizeof(sec));
+    strncpy(sec.name, name.c_str(), sizeof(sec.name) - 1);
+    sec.elem_size = elem_size;
+    sec.count = count;
+    sections.push_back(sec);
+    data.push_back(ptr);
+}
+
+
+/***************************************************************************
+ * CKPT_WRITE_ALL - This function writes a whole buffer at an offset of a
+ * file, retrying short (or interrupted) writes.
+ *
+ * Args:
+ * -----
+ *  fd (int)          : File descriptor.
+ *  buf (void *)      : Data.
+ *  size (size_t)     : Number of bytes.
+ *  offset (uint64_t) : Offset from the file start.
+ *
+ * Returns:
+ * --------
+ *  0 on success, -1 on a write error (e.g. the disk is full).
+ ***************************************************************************/
+static int ckpt_write_all(int fd, const void *buf, size_t size,
+                          uint64_t offset) {
+    const char *p = (const char *) buf;
+
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * CKPT_CORE WRITE - This method writes the header, the sections table and
+ * the (page aligned) sections' data to a file with pwrite, so a full disk
+ * is reported as an error. It is written to path.tmp, synced and renamed
+ * at the end, so a crash or a failed write never leaves a half-written
+ * checkpoint behind (the .tmp file is removed on errors).
+ *
+ * Args:
+ * -----
+ *  path (string) : Checkpoint file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the file is succesfully written, otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ ***************************************************************************/
+int ckpt_core::write(const string &path) {
+    ckpt_header head;
+    string tmp = path + ".tmp";
+    uint64_t offset;
+    int ok;
+
+    // Layout: header, sections table, aligned data
+    offset = sizeof(ckpt_header) + sections.size() * sizeof(ckpt_section);
+    for (auto &sec : sections) {
+        offset = (offset + CKPT_ALIGN - 1) / CKPT_ALIGN * CKPT_ALIGN;
+        sec.offset = offset;
+        offset += sec.elem_size * sec.count;
+    }
+
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) { throw 22; }
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, CKPT_MAGIC, sizeof(head.magic));
+    head.version = CKPT_VERSION;
+    head.num_sections = sections.size();
+    ok = ckpt_write_all(out, &head, sizeof(head), 0) == 0 &&
+         ckpt_write_all(out, sections.data(),
+                        sections.size() * sizeof(ckpt_section),
+                        sizeof(head)) == 0;
+    for (int i = 0; ok && i < sections.size(); ++i) {
+        if (sections[i].count > 0)
+            ok = ckpt_write_all(out, data[i],
+                                sections[i].elem_size * sections[i].count,
+                                sections[i].offset) == 0;
+    }
+    // The last section may be empty: the file still spans the layout
+    ok = ok && ftruncate(out, offset) == 0 && fsync(out) == 0;
+    ok = ::close(out) == 0 && ok;
+
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        throw 22;
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * CKPT_CORE OPEN - This method maps a checkpoint file (read-only) and
+ * checks its magic number and version.
+ *
+ * Args:
+ * -----
+ *  path (string) : Checkpoint file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the file is succesfully mapped, otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ *  23 : Not a valid (or not compatible) checkpoint file.
+ ***************************************************************************/
+int ckpt_core::open(const string &path) {
+    struct stat st;
+    ckpt_header head;
+
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) { throw 22; }
+    if (st.st_size < sizeof(ckpt_header)) { throw 23; }
+
+    map_size = st.st_size;
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        map = NULL;
+        throw 22;
+    }
+
+    memcpy(&head, map, sizeof(head));
+    if (memcmp(head.magic, CKPT_MAGIC, sizeof(head.magic)) != 0 ||
+        head.version != CKPT_VERSION) { throw 23; }
+    if (head.num_sections > (map_size - sizeof(head)) / sizeof(ckpt_section))
+        throw 23;
+
+    sections.resize(head.num_sections);
+    memcpy(sections.data(), (char *) map + sizeof(head),
+           head.num_sections * sizeof(ckpt_section));
+    // Compare against the remaining size (a crafted file cannot overflow)
+    for (auto &sec : sections) {
+        if (sec.offset > map_size) { throw 23; }
+        if (sec.elem_size > 0 &&
+            sec.count > (map_size - sec.offset) / sec.elem_size) { throw 23; }
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * CKPT_CORE FIND - This method returns a pointer to the (mapped) data of
+ * a section.
+ *
+ * Args:
+ * -----
+ *  name (string)   : Section's name.
+ *  elem_size (int) : Expected size of one element (bytes).
+ *  count (int &)   : Number of elements (output).
+ *
+ * Returns:
+ * --------
+ *  A pointer to the data, otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  23 : Not a valid (or not compatible) checkpoint file.
+ ***************************************************************************/
+const void *ckpt_core::find(const string &name,
+                            size_t elem_size,
+                            size_t &count) {
+    for (auto &sec : sections) {
+        if (name != sec.name) continue;
+        if (sec.elem_size != elem_size) { throw 23; }
+        count = sec.count;
+        return (char *) map + sec.offset;
+    }
+    throw 23;
+}
+
+
+/***************************************************************************
+ * CKPT_CORE HAS - This method checks if the (mapped) file has a section,
+ * e.g. an optional one that older files lack.
+ ***************************************************************************/
+bool ckpt_core::has(const string &name) const {
+    for (auto &sec : sections)
+        if (name == sec.name) return true;
+    return false;
+}
+
+
+/***************************************************************************
+ * CKPT_CORE CLOSE - This method unmaps the file (if any).
+ ***************************************************************************/
+void ckpt_core::close() {
+    if (map != NULL) munmap(map, map_size);
+    if (fd >= 0) ::close(fd);
+    map = NULL;
+    map_size = 0;
+    fd = -1;
+}
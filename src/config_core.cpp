@@ -0,0 +1,203 @@
+#include "config_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * CONFIG_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * CONFIG_CORE Class Constructor - It sets the same defaults as the test
+ * program (main_test_nsat.cpp): CPU mode, seed 42, Forward Euler with 2
+ * steps per ms, 1 second of Poisson input and CUBA synapses.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+config_core::config_core() {
+    sim_name = "nsat";
+    input_type = "poisson";
+
+    carl_p.mode = CPU_MODE;
+    carl_p.logger = USER;
+    carl_p.gpu_index = 0;
+    carl_p.random_seed = 42;
+
+    sim_p.int_method = FORWARD_EULER;
+    sim_p.maxWt = 10.0;
+    sim_p.sim_time_sec = 1;
+    sim_p.sim_time_msec = 0;
+    sim_p.int_num_steps = 2;
+    sim_p.num_connections = 0;
+    sim_p.print_summary = false;
+    sim_p.copy_state = false;
+    sim_p.remove_tmp_mem = true;
+    sim_p.coba_enabled = false;
+
+    sync();
+}
+
+
+/***************************************************************************
+ * CONFIG_CORE Class Copy Constructor - The structs of the copy point to
+ * the copy's own strings.
+ ***************************************************************************/
+config_core::config_core(const config_core &other) {
+    *this = other;
+}
+
+
+config_core &config_core::operator=(const config_core &other) {
+    carl_p = other.carl_p;
+    sim_p = other.sim_p;
+    sim_name = other.sim_name;
+    input_type = other.input_type;
+    spkg_fname = other.spkg_fname;
+    nsat_fname = other.nsat_fname;
+    stdp_fname = other.stdp_fname;
+    delay_fname = other.delay_fname;
+    conns = other.conns;
+    finps = other.finps;
+    sync();
+    return *this;
+}
+
+
+/***************************************************************************
+ * CONFIG_CORE SYNC - This method points all the char* fields of the
+ * structs to the owned strings.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void config_core::sync() {
+    carl_p.sim_name = const_cast<char *>(sim_name.c_str());
+    sim_p.input_type = const_cast<char *>(input_type.c_str());
+    sim_p.num_connections = conns.size();
+
+    fnames.spkg_fname = const_cast<char *>(spkg_fname.c_str());
+    fnames.nsat_fname = const_cast<char *>(nsat_fname.c_str());
+    fnames.stdp_fname = const_cast<char *>(stdp_fname.c_str());
+    fnames.delay_fname = const_cast<char *>(delay_fname.c_str());
+
+    conn_ptrs.clear();
+    for (auto &c : conns) conn_ptrs.push_back(const_cast<char *>(c.c_str()));
+    finp_ptrs.clear();
+    for (auto &f : finps) finp_ptrs.push_back(const_cast<char *>(f.c_str()));
+    fnames.conn_fname = conn_ptrs.empty() ? NULL : conn_ptrs.data();
+    fnames.finp_spikes = finp_ptrs.empty() ? NULL : finp_ptrs.data();
+}
+
+
+/***************************************************************************
+ * CONFIG_CORE LOAD - This method reads a configuration file (see
+ * config_core.h for the format).
+ *
+ * Args:
+ * -----
+ *  fname (string) : Configuration file name.
+ *
+ * Returns:
+ * --------
+ *  0 if succesfully reads the file, otherwise the number of the 
+ *  exception (which is printed along with the line of the file).
+ *
+ * Exceptions:
+ * -----------
+ *  2  : Not valid parameters found (a number that cannot be parsed or is
+ *       out of range).
+ *  17 : Not a valid parameter name.
+ *  18 : Cannot open a configuration/sweep file.
+ *  30 : Too few/more parameters are given at a line.
+ *  60 : Not a valid Integration Method.
+ ***************************************************************************/
+int config_core::load(const string &fname) {
+    int count_lines = 0;
+    string line;
+    ifstream infile(fname);
+
+    if (!infile) {
+        print_exceptions(18);
+        return 18;
+    }
+
+    try {
+        while (getline(infile, line)) {
+            count_lines++;
+            istringstream iss(line);
+            vector<string> tokens{istream_iterator<string>{iss},
+                                  istream_iterator<string>{}};
+
+            if (tokens.empty() || tokens[0][0] == '#') { continue; }
+            if (tokens.size() != 2) { throw 30; }
+
+            string &key = tokens[0];
+            string val = tokens[1];
+            string low = val;
+            transform(low.begin(), low.end(), low.begin(), ::tolower);
+
+            // CARLsim parameters
+            if (key == "sim_name") sim_name = val;
+            else if (key == "mode") carl_p.mode = (low == "gpu") ? GPU_MODE : CPU_MODE;
+            else if (key == "logger") {
+                if (low == "developer") carl_p.logger = DEVELOPER;
+                else if (low == "showtime") carl_p.logger = SHOWTIME;
+                else if (low == "silent") carl_p.logger = SILENT;
+                else carl_p.logger = USER;
+            }
+            else if (key == "gpu_index") carl_p.gpu_index = stoi(val);
+            else if (key == "random_seed") carl_p.random_seed = stoi(val);
+            // Simulation parameters
+            else if (key == "int_method") {
+                if (low == "forward_euler") sim_p.int_method = FORWARD_EULER;
+                else if (low == "runge_kutta4") sim_p.int_method = RUNGE_KUTTA4;
+                else throw 60;
+            }
+            else if (key == "maxWt") sim_p.maxWt = stof(val);
+            else if (key == "sim_time_sec") sim_p.sim_time_sec = stoi(val);
+            else if (key == "sim_time_msec") sim_p.sim_time_msec = stoi(val);
+            else if (key == "int_num_steps") sim_p.int_num_steps = stoi(val);
+            else if (key == "input_type") input_type = val;
+            else if (key == "print_summary") sim_p.print_summary = str2bool(val);
+            else if (key == "copy_state") sim_p.copy_state = str2bool(val);
+            else if (key == "remove_tmp_mem") sim_p.remove_tmp_mem = str2bool(val);
+            else if (key == "coba_enabled") sim_p.coba_enabled = str2bool(val);
+            // Parameters files
+            else if (key == "spkg_fname") spkg_fname = val;
+            else if (key == "nsat_fname") nsat_fname = val;
+            else if (key == "stdp_fname") stdp_fname = val;
+            else if (key == "delay_fname") delay_fname = val;
+            else if (key == "conn_fname") conns.push_back(val);
+            else if (key == "finp_spikes") finps.push_back(val);
+            else { throw 17; }
+        }
+    }
+    catch (int &e) {
+        print_exceptions(e, count_lines, fname.c_str());
+        return e;
+    }
+    // stoi and stof reject values that are not numbers or do not fit
+    catch (invalid_argument &) {
+        print_exceptions(2, count_lines, fname.c_str());
+        return 2;
+    }
+    catch (out_of_range &) {
+        print_exceptions(2, count_lines, fname.c_str());
+        return 2;
+    }
+    infile.close();
+
+    sync();
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include "dist_core.h"
+
+#ifdef NSAT_MPI
+
+using namespace std;
+
+
+/***************************************************************************
+ * DIST_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * DIST_CORE Class Constructor - It partitions the network of a batch over
+ * the ranks of a communicator (see PARTITION). The batch must not be set
+ * up yet.
+ *
+ * Args:
+ * -----
+ *  b (batch_core *) : A pointer to a (not set up) batch.
+ *  c (MPI_Comm)     : MPI communicator.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+dist_core::dist_core(batch_core *b, MPI_Comm c) {
+    batch = b;
+    comm = c;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &num_ranks);
+
+    first_remote = 0;
+    pending = false;
+    partition();
+}
+
+
+/***************************************************************************
+ * DIST_CORE PARTITION - This method assigns each NSAT group to a rank.
+ * The cost of a group is its number of neurons plus its number of
+ * incoming synapses. Groups are taken from the most to the least costly
+ * and each goes to the least loaded rank (lowest rank on ties), so all
+ * the ranks compute the same partition. Input groups belong to rank 0.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void dist_core::partition() {
+    int n_inp = batch->inpc.size();
+    int n_grp = n_inp + batch->nsatc.size();
+    vector<double> cost(n_grp, 0.0), load(num_ranks, 0.0);
+    vector<int> order;
+
+    for (int g = 0; g < batch->nsatc.size(); ++g) {
+        cost[n_inp+g] = batch->nsatc[g].num_neurons;
+        order.push_back(n_inp + g);
+    }
+    for (auto &p : batch->projs) {
+        int num_syn = 0;
+        for (auto &row : p.wt)
+            for (auto w : row) num_syn += (fabsf(w) > 0.0f);
+        for (int g = 0; g < batch->nsatc.size(); ++g)
+            if (batch->nsatc[g].unit_name == p.dest_name)
+                cost[n_inp+g] += num_syn;
+    }
+
+    stable_sort(order.begin(), order.end(),
+                [&](int a, int b) { return cost[a] > cost[b]; });
+
+    owner.assign(n_grp, 0);
+    for (int g : order) {
+        int r = min_element(load.begin(), load.end()) - load.begin();
+        owner[g] = r;
+        load[r] += cost[g];
+    }
+    batch->set_partition(owner, rank);
+}
+
+
+/***************************************************************************
+ * DIST_CORE PACK_SPIKES - This method compresses the spikes of the last
+ * step of the local NSAT groups: the sorted ids n*B+b are stored as the
+ * differences between consecutive ids, each as a varint (7 bits per
+ * byte, the high bit marks that more bytes follow).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void dist_core::pack_spikes() {
+    int n_inp = batch->inpc.size();
+    int B = batch->batch_size;
+    uint32_t prev = 0;
+
+    send_buf.clear();
+    for (int g = n_inp; g < owner.size(); ++g) {
+        if (owner[g] != rank) continue;
+        for (uint32_t id = batch->grp_start[g] * B;
+             id < batch->grp_start[g+1] * B; ++id) {
+            if (batch->spk[id] == 0) continue;
+            uint32_t delta = id - prev;
+            prev = id;
+            while (delta >= 0x80) {
+                send_buf.push_back((delta & 0x7F) | 0x80);
+                delta >>= 7;
+            }
+            send_buf.push_back(delta);
+        }
+    }
+}
+
+
+/***************************************************************************
+ * DIST_CORE START_EXCHANGE - This method packs the local spikes of the
+ * last step and starts sending them to (and receiving the spikes of) all
+ * the other ranks. Only the message sizes are exchanged synchronously.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void dist_core::start_exchange() {
+    int size, total = 0;
+
+    pack_spikes();
+    size = send_buf.size();
+    recv_counts.resize(num_ranks);
+    recv_displs.resize(num_ranks);
+    MPI_Allgather(&size, 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    for (int r = 0; r < num_ranks; ++r) {
+        recv_displs[r] = total;
+        total += recv_counts[r];
+    }
+    recv_buf.resize(max(total, 1));
+
+    MPI_Iallgatherv(send_buf.data(), size, MPI_UNSIGNED_CHAR,
+                    recv_buf.data(), recv_counts.data(), recv_displs.data(),
+                    MPI_UNSIGNED_CHAR, comm, &request);
+    pending = true;
+}
+
+
+/***************************************************************************
+ * DIST_CORE FINISH_EXCHANGE - This method waits for the pending exchange
+ * (if any) and writes the spikes of the remote NSAT groups into a spikes
+ * buffer of the batch, updating their spike counts (spk_any).
+ *
+ * Args:
+ * -----
+ *  s (vector<unsigned char> &) : Spikes buffer ([neuron][batch]).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void dist_core::finish_exchange(vector<unsigned char> &s) {
+    int n_inp = batch->inpc.size();
+    int B = batch->batch_size;
+
+    if (!pending) return;
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    pending = false;
+
+    for (int g = n_inp; g < owner.size(); ++g) {
+        if (owner[g] == rank) continue;
+        int n0 = batch->grp_start[g], n1 = batch->grp_start[g+1];
+        fill(s.begin() + n0 * B, s.begin() + n1 * B, 0);
+        fill(batch->spk_any.begin() + n0, batch->spk_any.begin() + n1, 0);
+    }
+
+    for (int r = 0; r < num_ranks; ++r) {
+        if (r == rank) continue;
+        const unsigned char *ptr = recv_buf.data() + recv_displs[r];
+        const unsigned char *end = ptr + recv_counts[r];
+        uint32_t id = 0;
+
+        while (ptr < end) {
+            uint32_t delta = 0;
+            int shift = 0;
+            do {
+                delta |= static_cast<uint32_t>(*ptr & 0x7F) << shift;
+                shift += 7;
+            } while (*ptr++ & 0x80);
+            id += delta;
+            s[id] = 1;
+            batch->spk_any[id / B]++;
+        }
+    }
+}
+
+
+/***************************************************************************
+ * DIST_CORE D_SETUP_STATE - This method builds the local part of the
+ * batch (see BATCH_CORE::B_SETUP_STATE) and finds the first projection
+ * onto a local group whose source is on another rank: the projections
+ * before it can be delivered while the spikes are still in flight.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, if successfully builds the network.
+ ***************************************************************************/
+int dist_core::d_setup_state() {
+    int flag = batch->b_setup_state();
+    int n_inp = batch->inpc.size();
+
+    first_remote = batch->connx.size();
+    for (int p = 0; p < batch->connx.size(); ++p) {
+        const csr_projection &c = batch->connx[p];
+        if (batch->is_local(c.dest_grp) && c.src_grp >= n_inp &&
+            !batch->is_local(c.src_grp)) {
+            first_remote = p;
+            break;
+        }
+    }
+    return flag;
+}
+
+
+/***************************************************************************
+ * DIST_CORE D_RUN_STATE - This method simulates the local part of the
+ * batch for sim_time_sec seconds and sim_time_msec ms, exchanging the
+ * spikes with the other ranks at every step, and writes the spike files
+ * of the local groups. All the ranks have to call it.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, when the network has been simulated
+ *  successfully. On an exception the whole communicator is aborted.
+ ***************************************************************************/
+int dist_core::d_run_state() {
+    int flag = 0;
+    int num_proj = batch->connx.size();
+
+    try {
+        for (auto &rec : batch->records) rec.clear();
+        if (batch->input_type != "poisson") batch->build_schedule();
+
+        batch->start_counting();
+        for (int t = batch->sim_step;
+             t < batch->sim_step + batch->num_steps; ++t) {
+            batch->spk.swap(batch->spk_prev);
+            batch->generate_inputs(t);
+
+            // Local sources first, while the remote spikes arrive
+            fill(batch->isyn_in.begin(), batch->isyn_in.end(), 0.0);
+            batch->deliver_projections(t, 0, first_remote);
+            finish_exchange(batch->spk_prev);
+            batch->deliver_projections(t, first_remote, num_proj);
+
+            batch->update_neurons(t);
+            batch->update_stdp(t);
+            batch->record_spikes(t);
+            batch->count_step(t);
+            start_exchange();
+        }
+        finish_exchange(batch->spk);
+        batch->stop_counting();
+        batch->sim_step += batch->num_steps;
+        flag = batch->write_spikes();
+    }
+    catch (int &e) {
+        flag = batch->error(e);
+        MPI_Abort(comm, e);
+    }
+    return flag;
+}
+
+#endif // NSAT_MPI
@@ -0,0 +1,298 @@
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <dirent.h>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "batch_core.h"
+#include "netgen_core.h"
+
+#define STDP_TOLERANCE 1e-3     // Largest eager/lazy weight difference
+
+
+/***************************************************************************
+ * Compares the spike files (spk*.dat) of a results directory of one
+ * instance with those of another. Returns the number of files that
+ * differ or are missing, or -1 if the first directory has no spike file.
+ ***************************************************************************/
+static int compare_spikes(const string &a, const string &b) {
+    int num_files = 0, num_diff = 0;
+    DIR *dir = opendir(a.c_str());
+    struct dirent *ent;
+
+    if (dir == NULL) return -1;
+    while ((ent = readdir(dir)) != NULL) {
+        string name = ent->d_name;
+        if (name.compare(0, 3, "spk") != 0) continue;
+        ifstream fa(a + "/" + name, ios::binary);
+        ifstream fb(b + "/" + name, ios::binary);
+        stringstream da, db;
+        da << fa.rdbuf();
+        if (fb) db << fb.rdbuf();
+        if (!fb || da.str() != db.str()) {
+            cout << "Spikes differ: " << a << "/" << name << endl;
+            num_diff++;
+        }
+        num_files++;
+    }
+    closedir(dir);
+    return (num_files > 0) ? num_diff : -1;
+}
+
+
+/***************************************************************************
+ * Sets the NSAT groups of a batch so that they cover all the update
+ * kernels: group k gets the noise (sigma), bias (b) and refractory
+ * (tau_ref) terms of the bits of k.
+ ***************************************************************************/
+static void mix_kernel_flags(const nsat_core &core, batch_core &batch) {
+    const vector<nsat_unit> &units = core.get_nsat_units();
+
+    for (int k = 0; k < units.size(); ++k) {
+        batch.set_nsat_param(units[k].unit_name, "sigma", (k & 4) ? 1.0 : 0.0);
+        batch.set_nsat_param(units[k].unit_name, "b", (k & 2) ? 0.1 : 0.0);
+        batch.set_nsat_param(units[k].unit_name, "tau_ref", (k & 1) ? 3 : 0);
+    }
+}
+
+
+/***************************************************************************
+ * Benchmark of the generic and the specialized NSAT update kernels of 
+ * batch_core, on a synthetic network that spikes (8 groups of 100
+ * neurons, written in <output dir>/kernel_net) whose groups cover all
+ * the combinations of the noise (sigma), bias (b) and refractory
+ * (tau_ref) terms. It times the neurons update alone and a full run
+ * (spikes written in <output dir>/generic and <output dir>/specialized)
+ * and fails unless both runs spike and their spikes are identical.
+ * The last instance is then run alone (a batch of 1 with its seed) and
+ * has to spike exactly as within the batch, and Philox has to match the
+ * Random123 known answers (see rng_core.h). It also runs a synthetic
+ * network with STDP (4
+ * groups of 200 neurons, see netgen_core.h, written in 
+ * <output dir>/stdp_net) with eager and lazy STDP (results in 
+ * <output dir>/stdp_eager and <output dir>/stdp_lazy) and reports their 
+ * run times, weight updates and largest weight difference. Both modes 
+ * must update some weights, and the difference has to stay below 
+ * STDP_TOLERANCE.
+ * Finally, it compares the per-synapse and the skip sampled blankout:
+ * the number of blanked out events of a full run has to match its 
+ * expected value (|z| < 4), and the synaptic events per second are 
+ * measured over whole runs (at least <steps> steps each, spike files
+ * excluded). The run also updates the neurons, so the speedup is that
+ * of a run rather than of the delivery alone.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    int res = 0;                // return flag
+    int batch_size = 16;        // number of instances
+    int num_steps = 10000;      // kernel-only steps
+    string out_dir = "results/bench";
+    config_core cfg;            // base configuration
+    config_core kernel_cfg;     // kernels network configuration
+    config_core stdp_cfg;       // STDP network configuration
+    netgen_params p;            // synthetic networks parameters
+    double t_kernel[2], t_run[2], t_stdp[2];
+    const char *mode[2] = {"generic", "specialized"};
+    int64_t kernel_spikes = 0;
+    int kernel_diff = -1, invariance_diff = -1;
+    const char *stdp_mode[2] = {"stdp_eager", "stdp_lazy"};
+    vector<vector<float>> wt[2];
+    float max_diff = 0.0;
+    int64_t stdp_updates[2] = {0, 0};
+    const char *blk_mode[2] = {"blankout per-synapse", "blankout skip"};
+    blankout_stats blk_run[2];
+    double blk_rate[2] = {0.0, 0.0};
+
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " <config file>"
+             << " [batch size] [steps] [output dir]" << endl;
+        return 1;
+    }
+    if (argc > 2) batch_size = atoi(argv[2]);
+    if (argc > 3) num_steps = atoi(argv[3]);
+    if (argc > 4) out_dir = argv[4];
+
+    // Load the base configuration
+    if (cfg.load(argv[1]) != 0) return 1;
+
+    // The draws of every instance depend on a correct Philox
+    bool rng_pass = rng_known_answers() == 0;
+    cout << "Philox4x32-10 known answers: " << (rng_pass ? "OK" : "FAILED")
+         << endl;
+
+    // Generate the kernels and the STDP networks: they have to spike for
+    // the checks to mean anything
+    p.num_groups = 8;
+    p.num_neurons = 100;
+    p.density = 0.1;
+    p.radius = 0;
+    p.rate = 20.0;
+    p.stdp = false;
+    p.sim_time_ms = 1000;
+    p.seed = 42;
+    p.input_type = "poisson";
+    try {
+        netgen_core(p).write(out_dir + "/kernel_net");
+        p.num_groups = 4;
+        p.num_neurons = 200;
+        p.stdp = true;
+        netgen_core(p).write(out_dir + "/stdp_net");
+    }
+    catch (int &e) {
+        print_exceptions(e);
+        return 1;
+    }
+    if (kernel_cfg.load(out_dir + "/kernel_net/net.cfg") != 0) return 1;
+    if (stdp_cfg.load(out_dir + "/stdp_net/net.cfg") != 0) return 1;
+
+    try {
+        // Generic vs specialized kernels: group k gets the noise, bias
+        // and refractory terms of the bits of k (all 8 combinations)
+        nsat_core kernel_core(kernel_cfg.get_filenames(),
+                              kernel_cfg.get_carlsim(),
+                              kernel_cfg.get_simulation());
+        batch_core kernels(&kernel_core, batch_size);
+        res = kernels.b_setup_state();
+        mix_kernel_flags(kernel_core, kernels);
+
+        for (int m = 0; m < 2 && res == 0; ++m) {
+            kernels.set_generic_kernels(m == 0);
+
+            // Neurons update only
+            kernels.reset_state(true);
+            auto t0 = chrono::steady_clock::now();
+            for (int t = 0; t < num_steps; ++t) kernels.update_neurons(t);
+            t_kernel[m] = chrono::duration<double>(chrono::steady_clock::now()
+                                                   - t0).count();
+
+            // Full run
+            kernels.reset_state(true);
+            kernels.set_results_dir(out_dir + "/" + mode[m]);
+            t0 = chrono::steady_clock::now();
+            res = kernels.b_run_state();
+            t_run[m] = chrono::duration<double>(chrono::steady_clock::now()
+                                                - t0).count();
+            if (m == 0)
+                for (auto &c : kernels.get_counters())
+                    kernel_spikes += c.spikes;
+        }
+        for (int b = 0; b < batch_size && res == 0; ++b) {
+            string sub = "/batch" + to_string(b);
+            int n = compare_spikes(out_dir + "/" + mode[0] + sub,
+                                   out_dir + "/" + mode[1] + sub);
+            if (n < 0) continue;
+            kernel_diff = max(kernel_diff, 0) + n;
+        }
+
+        // Batch size invariance: the last instance alone (its seed in a
+        // batch of 1) has to spike exactly as within the batch
+        if (res == 0) {
+            batch_core single(&kernel_core, 1);
+            single.set_seeds(vector<int>(1,
+                kernel_cfg.get_carlsim()->random_seed + batch_size - 1));
+            single.set_results_dir(out_dir + "/batch_of_1");
+            res = single.b_setup_state();
+            mix_kernel_flags(kernel_core, single);
+            if (res == 0) res = single.b_run_state();
+            invariance_diff = compare_spikes(out_dir + "/batch_of_1/batch0",
+                                    out_dir + "/" + mode[1] + "/batch" +
+                                    to_string(batch_size - 1));
+        }
+
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        batch_core batch(&core, batch_size);
+        if (res == 0) res = batch.b_setup_state();
+
+        // Eager vs lazy STDP
+        nsat_core stdp_core(stdp_cfg.get_filenames(),
+                            stdp_cfg.get_carlsim(),
+                            stdp_cfg.get_simulation());
+        for (int m = 0; m < 2 && res == 0; ++m) {
+            batch_core plastic(&stdp_core, batch_size);
+            plastic.set_stdp_mode(m == 0 ? STDP_EAGER : STDP_LAZY);
+            plastic.set_results_dir(out_dir + "/" + stdp_mode[m]);
+            res = plastic.b_setup_state();
+            if (res != 0) break;
+
+            auto t0 = chrono::steady_clock::now();
+            res = plastic.b_run_state();
+            t_stdp[m] = chrono::duration<double>(chrono::steady_clock::now()
+                                                 - t0).count();
+            for (auto &c : plastic.get_counters())
+                stdp_updates[m] += c.stdp_updates;
+            for (int k = 0; k < stdp_core.get_projections().size(); ++k)
+                for (int b = 0; b < batch_size; ++b)
+                    wt[m].push_back(plastic.get_weights(k, b));
+        }
+        // Per-synapse vs skip sampled blankout: the same runs (seeds) for
+        // both, timed by the activity counters (see GET_SIM_RATE)
+        simulation *sim = cfg.get_simulation();
+        int run_steps = sim->sim_time_sec * 1000 + sim->sim_time_msec;
+        int num_runs = max(1, (num_steps + run_steps - 1) / max(1, run_steps));
+        for (int m = 0; m < 2 && res == 0; ++m) {
+            double events = 0.0, secs = 0.0;
+            batch.set_skip_blankout(m == 1);
+            batch.set_results_dir(out_dir + "/blankout" + to_string(m));
+            for (int r = 0; r < num_runs && res == 0; ++r) {
+                batch.reset_state(true);
+                res = batch.b_run_state();
+                if (r == 0) blk_run[m] = batch.get_blankout_stats();
+                events += batch.get_blankout_stats().events;
+                if (batch.get_sim_rate() > 0.0)       // ms / (ms/s)
+                    secs += run_steps / batch.get_sim_rate();
+            }
+            if (secs > 0.0) blk_rate[m] = events / secs;
+        }
+        for (int i = 0; i < wt[1].size(); ++i)
+            for (int k = 0; k < wt[1][i].size(); ++k)
+                max_diff = max(max_diff, fabsf(wt[0][i][k] - wt[1][i][k]));
+    }
+    catch (int &e) {
+        print_exceptions(e);                // Custom exceptions - see auxiliary.cpp
+        res = e;
+    }
+    if (res != 0) return 1;
+
+    for (int m = 0; m < 2; ++m)
+        cout << mode[m] << ": update " << t_kernel[m] << " s ("
+             << num_steps << " steps), run " << t_run[m] << " s" << endl;
+    // Without spikes the identical outputs would prove nothing
+    bool kernel_pass = kernel_diff == 0 && kernel_spikes > 0;
+    cout << "Speedup: update " << t_kernel[0] / t_kernel[1]
+         << "x, run " << t_run[0] / t_run[1] << "x, " << kernel_spikes
+         << " spikes (" << (kernel_pass ? "OK" : "FAILED") << ")" << endl;
+    bool invariance_pass = invariance_diff == 0;
+    cout << "Batch of 1 vs instance " << batch_size - 1 << " of "
+         << batch_size << ": " << (invariance_pass ? "OK" : "FAILED")
+         << endl;
+    // No weight updates would make the comparison vacuous
+    bool stdp_pass = max_diff <= STDP_TOLERANCE && stdp_updates[0] > 0 &&
+                     stdp_updates[1] > 0;
+    for (int m = 0; m < 2; ++m)
+        cout << stdp_mode[m] << ": run " << t_stdp[m] << " s, "
+             << stdp_updates[m] << " weight updates" << endl;
+    cout << "STDP speedup " << t_stdp[0] / t_stdp[1]
+         << "x, max weight difference " << max_diff << " ("
+         << (stdp_pass ? "OK" : "FAILED") << ")" << endl;
+
+    bool pass = true;
+    for (int m = 0; m < 2; ++m) {
+        const blankout_stats &st = blk_run[m];
+        double z = (st.var > 0.0) ? (st.dropped - st.mean) / sqrt(st.var) : 0.0;
+        pass = pass && fabs(z) < 4.0;
+        cout << blk_mode[m] << ": dropped " << st.dropped << " of "
+             << st.events << " events (expected " << st.mean << ", z = "
+             << z << "), " << blk_rate[m] << " events/s" << endl;
+    }
+    // A network without events cannot give a speed
+    if (blk_rate[0] > 0.0 && blk_rate[1] > 0.0)
+        cout << "Blankout speedup " << blk_rate[1] / blk_rate[0] << "x";
+    else
+        cout << "Blankout speedup n/a (no events)";
+    cout << ", drop rate " << (pass ? "OK" : "FAILED") << endl;
+    if (!pass || !stdp_pass || !kernel_pass || !invariance_pass || !rng_pass)
+        return 1;
+    return 0;
+}
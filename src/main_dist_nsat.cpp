@@ -0,0 +1,74 @@
+#include <chrono>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "batch_core.h"
+#include "dist_core.h"
+
+/***************************************************************************
+ * Distributed batch run. Every rank simulates its part of the network 
+ * and writes the spike files of its groups in <output dir>, so the 
+ * directory ends up identical for any number of ranks, e.g.
+ *
+ *      mpirun -np 1 bin/dist_nsat net.cfg 4 results/np1
+ *      mpirun -np 4 bin/dist_nsat net.cfg 4 results/np4
+ *      diff -r results/np1 results/np4
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    int res = 0;                // return flag
+    int rank;                   // MPI rank
+    int batch_size = 1;         // number of instances
+    string out_dir = "results/dist";
+    config_core cfg;            // base configuration
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (argc < 2) {
+        if (rank == 0)
+            cout << "Usage: " << argv[0] << " <config file>"
+                 << " [batch size] [output dir]" << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    if (argc > 2) batch_size = atoi(argv[2]);
+    if (argc > 3) out_dir = argv[3];
+
+    // Load the base configuration
+    if (cfg.load(argv[1]) != 0) MPI_Abort(MPI_COMM_WORLD, 1);
+
+    try {
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        batch_core batch(&core, batch_size);
+        dist_core dist(&batch, MPI_COMM_WORLD);
+
+        batch.set_results_dir(out_dir);
+        res = dist.d_setup_state();
+        if (res != 0) MPI_Abort(MPI_COMM_WORLD, res);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        auto t0 = chrono::steady_clock::now();
+        res = dist.d_run_state();
+        MPI_Barrier(MPI_COMM_WORLD);
+        double dt = chrono::duration<double>(chrono::steady_clock::now()
+                                             - t0).count();
+
+        if (rank == 0) {
+            const vector<int> &owner = dist.get_owner();
+            int n_inp = core.get_input_units().size();
+            for (int g = n_inp; g < owner.size(); ++g)
+                cout << core.get_nsat_units()[g-n_inp].unit_name
+                     << " -> rank " << owner[g] << endl;
+            cout << "Run time: " << dt << " s" << endl;
+        }
+    }
+    catch (int &e) {
+        print_exceptions(e);                // Custom exceptions - see auxiliary.cpp
+        MPI_Abort(MPI_COMM_WORLD, e);
+    }
+
+    MPI_Finalize();
+    return res;
+}
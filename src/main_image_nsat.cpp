@@ -0,0 +1,65 @@
+#include <chrono>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "batch_core.h"
+
+/***************************************************************************
+ * Network images. The compile mode parses the parameters files of a base
+ * configuration, sets up a batch and writes its network image. The run
+ * mode loads an image (no parameters files are read) and runs it:
+ *
+ *      image_nsat compile <config file> <image> [stdp mode]
+ *      image_nsat run <image> [batch size] [output dir]
+ *
+ * The startup time (parse and set up, or load and set up) is reported.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    int res = 0;                // return flag
+    string mode = (argc > 1) ? argv[1] : "";
+    config_core cfg;            // base configuration
+
+    if (argc < 4 && !(mode == "run" && argc == 3)) {
+        cout << "Usage: " << argv[0] << " compile <config file> <image>"
+             << " [stdp mode]" << endl;
+        cout << "       " << argv[0] << " run <image> [batch size]"
+             << " [output dir]" << endl;
+        return 1;
+    }
+
+    try {
+        auto t0 = chrono::steady_clock::now();
+        if (mode == "compile") {
+            if (cfg.load(argv[2]) != 0) return 1;
+            nsat_core core(cfg.get_filenames(),
+                           cfg.get_carlsim(),
+                           cfg.get_simulation());
+            batch_core batch(&core, 1);
+            if (argc > 4) batch.set_stdp_mode(atoi(argv[4]));
+            res = batch.b_setup_state();
+            if (res == 0) res = batch.compile(argv[3]);
+        } else if (mode == "run") {
+            int batch_size = (argc > 3) ? atoi(argv[3]) : 1;
+            batch_core batch(argv[2], batch_size);
+            if (argc > 4) batch.set_results_dir(argv[4]);
+            res = batch.b_setup_state();
+            double dt = chrono::duration<double>(chrono::steady_clock::now()
+                                                 - t0).count();
+            cout << "Image loaded in " << dt * 1000.0 << " ms" << endl;
+            if (res == 0) res = batch.b_run_state();
+            return res;
+        } else {
+            cout << "Unknown mode: " << mode << endl;
+            return 1;
+        }
+        double dt = chrono::duration<double>(chrono::steady_clock::now()
+                                             - t0).count();
+        cout << "Network parsed, set up and compiled in " << dt * 1000.0
+             << " ms" << endl;
+    }
+    catch (int &e) {
+        print_exceptions(e);                // Custom exceptions - see auxiliary.cpp
+        res = e;
+    }
+    return res;
+}
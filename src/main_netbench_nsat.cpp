@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cstdio>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "netgen_core.h"
+
+
+/***************************************************************************
+ * Returns num / t, or 0 if t is not positive.
+ ***************************************************************************/
+static double per_sec(double num, double t) {
+    return (t > 0.0) ? num / t : 0.0;
+}
+
+
+/***************************************************************************
+ * Scaling benchmark of NSAT Core on synthetic networks (see
+ * netgen_core.h). It generates a network of <groups> NSAT groups of
+ * <neurons> neurons each (connection probability <density>, Poisson
+ * input at <rate> Hz, STDP on the excitatory groups if <stdp> is 1) in
+ * <output dir>, then builds and runs it for <ms> ms and measures each
+ * phase separately:
+ *      - parse  : parameters and connection files (bytes/s, synapses/s),
+ *      - config : CARLsim groups, connections and STDP (neurons/s,
+ *                 synapses/s),
+ *      - setup  : CARLsim setup state (neurons/s, synapses/s),
+ *      - run    : the simulation (spikes/s and simulated ms/s).
+ * The results (and all the phase timings and the memory accounting) are
+ * printed as JSON and written to <output dir>/netbench.json.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    netgen_params p;
+    string out_dir = "results/netbench";
+    config_core cfg;
+    double t_gen, t_parse, t_config, t_setup, t_run;
+    int64_t num_neurons, num_synapses, num_spikes, num_bytes = 0;
+    char buf[1024];
+
+    if (argc < 5) {
+        cout << "Usage: " << argv[0] << " <groups> <neurons> <density>"
+             << " <rate> [stdp] [ms] [output dir]" << endl;
+        return 1;
+    }
+    // The phases are measured from the construction on (timer_core.h)
+    setenv("NSAT_TIMING", "mem", 1);
+    p.num_groups = atoi(argv[1]);
+    p.num_neurons = atoi(argv[2]);
+    p.density = atof(argv[3]);
+    p.radius = 0;
+    p.rate = atof(argv[4]);
+    p.stdp = (argc > 5) ? atoi(argv[5]) != 0 : false;
+    p.sim_time_ms = (argc > 6) ? atoi(argv[6]) : 1000;
+    p.seed = 42;
+    p.input_type = "poisson";
+    if (argc > 7) out_dir = argv[7];
+
+    try {
+        // Generate the network files
+        netgen_core gen(p);
+        auto t0 = chrono::steady_clock::now();
+        gen.write(out_dir);
+        t_gen = chrono::duration<double>(chrono::steady_clock::now()
+                                         - t0).count();
+        num_neurons = gen.get_num_neurons();
+        num_synapses = gen.get_num_synapses();
+        if (cfg.load(out_dir + "/net.cfg") != 0) return 1;
+
+        // Build and run it
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        core.set_results_dir(out_dir + "/spikes");
+        core.c_config_state();
+        core.c_setup_state();
+        core.c_run_state();
+        num_spikes = core.get_num_spikes();
+
+        const timer_core &timer = core.get_timer();
+        for (auto &r : timer.get_records())
+            if (r.parent < 0) num_bytes += r.bytes;
+        t_parse = timer.total("construct") +
+                  timer.total("read_connexions") +
+                  timer.total("read_stdp");
+        t_config = timer.total("config") -
+                   timer.total("read_connexions") -
+                   timer.total("read_stdp");
+        t_setup = timer.total("setup");
+        t_run = timer.total("run");
+
+        // Results
+        string json = "{\n";
+        snprintf(buf, sizeof(buf),
+                 "  \"network\": {\"groups\": %d, \"neurons_per_group\": %d, "
+                 "\"density\": %g, \"rate\": %g, \"stdp\": %s, \"ms\": %d, "
+                 "\"neurons\": %lld, \"synapses\": %lld},\n",
+                 p.num_groups, p.num_neurons, p.density, p.rate,
+                 p.stdp ? "true" : "false", p.sim_time_ms,
+                 (long long)num_neurons, (long long)num_synapses);
+        json += buf;
+        snprintf(buf, sizeof(buf),
+                 "  \"generate\": {\"wall_s\": %.6f},\n"
+                 "  \"parse\": {\"wall_s\": %.6f, \"bytes\": %lld, "
+                 "\"bytes_per_s\": %.1f, \"synapses_per_s\": %.1f},\n"
+                 "  \"config\": {\"wall_s\": %.6f, \"neurons_per_s\": %.1f, "
+                 "\"synapses_per_s\": %.1f},\n"
+                 "  \"setup\": {\"wall_s\": %.6f, \"neurons_per_s\": %.1f, "
+                 "\"synapses_per_s\": %.1f},\n"
+                 "  \"run\": {\"wall_s\": %.6f, \"spikes\": %lld, "
+                 "\"spikes_per_s\": %.1f, \"sim_ms_per_s\": %.1f},\n",
+                 t_gen, t_parse, (long long)num_bytes,
+                 per_sec(num_bytes, t_parse), per_sec(num_synapses, t_parse),
+                 t_config, per_sec(num_neurons, t_config),
+                 per_sec(num_synapses, t_config),
+                 t_setup, per_sec(num_neurons, t_setup),
+                 per_sec(num_synapses, t_setup),
+                 t_run, (long long)num_spikes, per_sec(num_spikes, t_run),
+                 per_sec(p.sim_time_ms, t_run));
+        json += buf;
+        json += "  \"phases\": " + timer.to_json() + ",\n";
+        json += "  \"memory\": " + core.get_memory().to_json() + "\n}\n";
+
+        cout << json;
+        ofstream out(out_dir + "/netbench.json");
+        if (!out) { throw 15; }
+        out << json;
+
+        core.c_cleanup();
+    }
+    catch (int &e) {
+        print_exceptions(e);
+        return e;
+    }
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "netgen_core.h"
+
+
+#define NUM_METRICS 4
+#define MIN_TIME 1e-3       // metrics faster than this (s) are not checked
+#define NO_BASELINE 2       // exit status of run without a baseline
+
+static const char *metrics[NUM_METRICS] = {"parse", "config", "setup", "run"};
+
+
+/* ----------------------------------
+ * Regression scenario struct
+ * ----------------------------------*/
+typedef struct scenario_s {
+    const char *name;
+    int num_groups, num_neurons;
+    float density, rate;
+    bool stdp;
+    int sim_time_ms;
+    const char *input_type;
+} scenario;
+
+
+/* ----------------------------------
+ * Summary of a metric struct
+ * ----------------------------------*/
+typedef struct metric_stats_s {
+    double median, ci_low, ci_high;
+} metric_stats;
+
+
+/***************************************************************************
+ * The fixed scenarios. The load scenarios stress the text parsing and
+ * the connections build (dense: all-to-all, sparse: 1% of the synapses),
+ * the others the simulation itself.
+ ***************************************************************************/
+static const scenario scenarios[] = {
+    {"dense_load",  4, 400, 1.00, 10.0, false,  100, "poisson"},
+    {"sparse_load", 4, 2000, 0.01, 10.0, false,  100, "poisson"},
+    {"poisson",     4, 500, 0.05, 20.0, false, 1000, "poisson"},
+    {"vector",      4, 500, 0.05, 20.0, false, 1000, "vectorial"},
+    {"stdp_off",    8, 250, 0.10, 20.0, false, 1000, "poisson"},
+    {"stdp_on",     8, 250, 0.10, 20.0, true,  1000, "poisson"},
+};
+static const int num_scenarios = sizeof(scenarios) / sizeof(scenario);
+
+
+/***************************************************************************
+ * Builds and runs the network of a scenario (files in dir) once and
+ * returns the wall time of each metric: parse (parameters and connection
+ * files), config (CARLsim state without the parsing), setup and run.
+ ***************************************************************************/
+static void measure(const string &dir, const scenario &s,
+                    double t[NUM_METRICS]) {
+    config_core cfg;
+
+    if (cfg.load(dir + "/net.cfg") != 0) { throw 18; }
+    nsat_core core(cfg.get_filenames(),
+                   cfg.get_carlsim(),
+                   cfg.get_simulation());
+    core.set_results_dir(dir + "/spikes");
+
+    // A regular 100 Hz train for the vectorial input
+    if (string(s.input_type) == "vectorial") {
+        vector<int> times;
+        for (int ms = 0; ms < s.sim_time_ms; ms += 10) times.push_back(ms);
+        core.initialize_custom_input(times.data(), 1, times.size());
+    }
+
+    core.c_config_state();
+    core.c_setup_state();
+    core.c_run_state();
+
+    const timer_core &timer = core.get_timer();
+    double t_read = timer.total("read_connexions") + timer.total("read_stdp");
+    t[0] = timer.total("construct") + t_read;
+    t[1] = timer.total("config") - t_read;
+    t[2] = timer.total("setup");
+    t[3] = timer.total("run");
+    core.c_cleanup();
+}
+
+
+/***************************************************************************
+ * Median of the samples and its distribution-free ~95% confidence
+ * interval: the order statistics k and n-1-k, k = (n - 1.96 sqrt(n)) / 2
+ * (the whole range for fewer than 6 samples).
+ ***************************************************************************/
+static metric_stats summarize(vector<double> x) {
+    metric_stats st;
+    int n = x.size();
+    int k = max(0, static_cast<int>(floor((n - 1.96 * sqrt(n)) / 2.0)));
+
+    sort(x.begin(), x.end());
+    st.median = (n % 2) ? x[n/2] : 0.5 * (x[n/2-1] + x[n/2]);
+    st.ci_low = x[k];
+    st.ci_high = x[n-1-k];
+    return st;
+}
+
+
+/***************************************************************************
+ * Returns the value of a key ("key": value) of a JSON object as text.
+ ***************************************************************************/
+static string json_value(const string &obj, const string &key) {
+    size_t pos = obj.find("\"" + key + "\"");
+
+    if (pos == string::npos) return "";
+    pos = obj.find(':', pos);
+    if (pos == string::npos) return "";
+    pos = obj.find_first_not_of(" \t\n\"", pos + 1);
+    size_t end = obj.find_first_of(",}\"\n", pos);
+    return obj.substr(pos, end - pos);
+}
+
+
+/***************************************************************************
+ * Reads the medians of a baseline file (written by update) into a map
+ * "scenario/metric" -> median (s). A missing file gives an empty map.
+ ***************************************************************************/
+static map<string, double> read_baseline(const string &fname) {
+    map<string, double> base;
+    ifstream in(fname);
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    size_t pos = 0, end;
+
+    while ((pos = text.find('{', pos)) != string::npos) {
+        if ((end = text.find('}', pos)) == string::npos) break;
+        string obj = text.substr(pos, end - pos + 1);
+        string name = json_value(obj, "scenario");
+        string metric = json_value(obj, "metric");
+        string median = json_value(obj, "median");
+        if (!name.empty() && !metric.empty() && !median.empty())
+            base[name + "/" + metric] = stod(median);
+        pos = end + 1;
+    }
+    return base;
+}
+
+
+/***************************************************************************
+ * Performance regression harness of NSAT Core. It runs the fixed
+ * scenarios (synthetic networks, see netgen_core.h) <repeats> times each
+ * and summarizes the wall time of every phase (parse, config, setup,
+ * run) by its median and ~95% confidence interval.
+ *
+ *  update <baseline> [repeats] [output dir] : Writes the results as the
+ *      new baseline file (to be committed, measured on the reference
+ *      machine).
+ *  run <baseline> [repeats] [threshold] [output dir] : Compares the
+ *      results with the baseline and exits with 1 if a metric regresses,
+ *      i.e. its median is more than <threshold> (default 0.10) slower
+ *      than the baseline's median and even its confidence interval is
+ *      above the baseline. Metrics under 1 ms in the baseline are only
+ *      reported. The results are written to <output dir>/regress.json.
+ *      Without a baseline file it exits with NO_BASELINE (2) instead.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    string mode, baseline, out_dir = "results/regress";
+    int repeats = 5;
+    float threshold = 0.10;
+    int num_regressions = 0;
+    map<string, double> base;
+    char buf[512];
+
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " update <baseline>"
+             << " [repeats] [output dir]" << endl;
+        cout << "       " << argv[0] << " run <baseline>"
+             << " [repeats] [threshold] [output dir]" << endl;
+        return 1;
+    }
+    // The phases are measured from the construction on (timer_core.h)
+    setenv("NSAT_TIMING", "1", 1);
+    mode = argv[1];
+    baseline = argv[2];
+    if (argc > 3) repeats = max(1, atoi(argv[3]));
+    if (mode == "update") {
+        if (argc > 4) out_dir = argv[4];
+    } else if (mode == "run") {
+        if (argc > 4) threshold = atof(argv[4]);
+        if (argc > 5) out_dir = argv[5];
+        base = read_baseline(baseline);
+        if (base.empty()) {
+            cout << "No baseline recorded in " << baseline << ", run "
+                 << argv[0] << " update " << baseline << " first (make "
+                 << "regress_baseline, on the reference machine)" << endl;
+            return NO_BASELINE;
+        }
+    } else {
+        cout << "Not a valid mode: " << mode << endl;
+        return 1;
+    }
+
+    string json = "[";
+    snprintf(buf, sizeof(buf), "%-12s %-7s %10s %10s %10s %10s %8s\n",
+             "scenario", "metric", "median", "ci_low", "ci_high",
+             "baseline", "ratio");
+    cout << buf;
+
+    try {
+        for (int s = 0; s < num_scenarios; ++s) {
+            const scenario &sc = scenarios[s];
+            string dir = out_dir + "/" + sc.name;
+            netgen_params p;
+            vector<double> samples[NUM_METRICS];
+
+            p.num_groups = sc.num_groups;
+            p.num_neurons = sc.num_neurons;
+            p.density = sc.density;
+            p.radius = 0;
+            p.rate = sc.rate;
+            p.stdp = sc.stdp;
+            p.sim_time_ms = sc.sim_time_ms;
+            p.seed = 42;
+            p.input_type = sc.input_type;
+            netgen_core(p).write(dir);
+
+            for (int r = 0; r < repeats; ++r) {
+                double t[NUM_METRICS];
+                measure(dir, sc, t);
+                for (int m = 0; m < NUM_METRICS; ++m)
+                    samples[m].push_back(t[m]);
+            }
+
+            for (int m = 0; m < NUM_METRICS; ++m) {
+                metric_stats st = summarize(samples[m]);
+                string key = string(sc.name) + "/" + metrics[m];
+                const char *status = "ok";
+                double b = -1.0, ratio = 0.0;
+
+                if (base.count(key)) {
+                    b = base[key];
+                    ratio = (b > 0.0) ? st.median / b : 0.0;
+                    if (b < MIN_TIME) {
+                        status = "unchecked";
+                    } else if (st.median > b * (1.0 + threshold) &&
+                               st.ci_low > b) {
+                        status = "regression";
+                        num_regressions++;
+                    }
+                } else if (mode == "run") {
+                    status = "new";
+                }
+
+                snprintf(buf, sizeof(buf),
+                         "%-12s %-7s %10.6f %10.6f %10.6f %10.6f %8.3f %s\n",
+                         sc.name, metrics[m], st.median, st.ci_low,
+                         st.ci_high, b, ratio, status);
+                cout << buf;
+                snprintf(buf, sizeof(buf),
+                         "%s\n  {\"scenario\": \"%s\", \"metric\": \"%s\", "
+                         "\"repeats\": %d, \"median\": %.9f, "
+                         "\"ci_low\": %.9f, \"ci_high\": %.9f, "
+                         "\"baseline\": %.9f, \"status\": \"%s\"}",
+                         (json.size() > 1) ? "," : "", sc.name, metrics[m],
+                         repeats, st.median, st.ci_low, st.ci_high, b,
+                         status);
+                json += buf;
+            }
+        }
+        json += "\n]\n";
+
+        string fname = (mode == "update") ? baseline
+                                          : out_dir + "/regress.json";
+        ofstream out(fname);
+        if (!out) { throw 15; }
+        out << json;
+    }
+    catch (int &e) {
+        print_exceptions(e);
+        return e;
+    }
+
+    if (mode == "run") {
+        cout << num_regressions << " regression(s) (threshold "
+             << threshold * 100 << "%)" << endl;
+    }
+    return num_regressions > 0;
+}
@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "batch_core.h"
+#include "netgen_core.h"
+
+
+/***************************************************************************
+ * Opens a hardware counter of the cache misses of this process (user
+ * space only). Returns -1 where there is none (no PMU, or not allowed).
+ ***************************************************************************/
+static int perf_open() {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+/***************************************************************************
+ * Runs a set up batch and returns its simulation speed (simulated ms per
+ * wall second). The cache misses of the run are added to misses if the
+ * counter is open.
+ ***************************************************************************/
+static double run_batch(batch_core &batch, int fd, long long &misses) {
+    long long count = 0;
+
+    batch.reset_state(true);
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (batch.b_run_state() != 0) { throw 15; }
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) == sizeof(count)) misses += count;
+    }
+    return batch.get_sim_rate();
+}
+
+
+/***************************************************************************
+ * Returns the contents of a file (empty if it cannot be read).
+ ***************************************************************************/
+static string read_file(const string &fname) {
+    ifstream in(fname, ios::binary);
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+
+/***************************************************************************
+ * Locality reordering benchmark (see batch_core::set_reorder). It
+ * generates a network of <groups> NSAT groups of <neurons> neurons with
+ * local connectivity (synapses between neurons at most <radius> ring
+ * positions apart, scattered ids; radius 0 is uniform, see netgen_core.h)
+ * in <output dir>, then builds it in batch mode (batch size <batch>)
+ * with the original and with the reordered neurons, runs each one
+ * <repeats> times and reports for both:
+ *      - the mean cache lines touched by a fan-out (from the CSR),
+ *      - the cache misses per run (hardware counter, where available),
+ *      - the simulation speed (simulated ms per wall second).
+ * The runs with and without reordering must give identical spike files
+ * (<output dir>/original and <output dir>/reordered); otherwise it
+ * exits with 1.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    netgen_params p;
+    string out_dir = "results/reorder";
+    config_core cfg;
+    int batch_size = 4, repeats = 5, num_diff = 0;
+    double rate[2] = {0.0, 0.0}, lines[2];
+    long long misses[2] = {0, 0};
+    char buf[512];
+
+    if (argc < 5) {
+        cout << "Usage: " << argv[0] << " <groups> <neurons> <density>"
+             << " <radius> [batch] [repeats] [ms] [output dir]" << endl;
+        return 1;
+    }
+    p.num_groups = atoi(argv[1]);
+    p.num_neurons = atoi(argv[2]);
+    p.density = atof(argv[3]);
+    p.radius = atoi(argv[4]);
+    if (argc > 5) batch_size = atoi(argv[5]);
+    if (argc > 6) repeats = max(1, atoi(argv[6]));
+    p.sim_time_ms = (argc > 7) ? atoi(argv[7]) : 1000;
+    if (argc > 8) out_dir = argv[8];
+    p.rate = 20.0;
+    p.stdp = false;
+    p.seed = 42;
+    p.input_type = "poisson";
+
+    int fd = perf_open();
+    try {
+        netgen_core gen(p);
+        gen.write(out_dir);
+        if (cfg.load(out_dir + "/net.cfg") != 0) return 1;
+
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        for (int r = 0; r < 2; ++r) {
+            batch_core batch(&core, batch_size);
+            batch.set_reorder(r == 1);
+            batch.set_results_dir(out_dir + (r ? "/reordered" : "/original"));
+            if (batch.b_setup_state() != 0) return 1;
+            lines[r] = batch.get_fanout_lines();
+            for (int k = 0; k < repeats; ++k)
+                rate[r] += run_batch(batch, fd, misses[r]) / repeats;
+        }
+
+        // Identical spikes
+        vector<string> names;
+        for (auto &u : core.get_input_units()) names.push_back(u.unit_name);
+        for (auto &u : core.get_nsat_units()) names.push_back(u.unit_name);
+        for (int b = 0; b < batch_size; ++b) {
+            string dir = "/batch" + to_string(b) + "/spk";
+            for (auto &name : names)
+                if (read_file(out_dir + "/original" + dir + name + ".dat") !=
+                    read_file(out_dir + "/reordered" + dir + name + ".dat"))
+                    num_diff++;
+        }
+    }
+    catch (int &e) {
+        print_exceptions(e);
+        if (fd >= 0) close(fd);
+        return e;
+    }
+    if (fd >= 0) close(fd);
+
+    snprintf(buf, sizeof(buf), "%-10s %14s %16s %14s\n", "order",
+             "lines/fan-out", "misses/run", "sim ms/s");
+    cout << buf;
+    for (int r = 0; r < 2; ++r) {
+        string m = (fd >= 0) ? to_string(misses[r] / repeats) : "n/a";
+        snprintf(buf, sizeof(buf), "%-10s %14.2f %16s %14.1f\n",
+                 r ? "reordered" : "original", lines[r], m.c_str(), rate[r]);
+        cout << buf;
+    }
+    snprintf(buf, sizeof(buf), "lines reduction %8.2fx\n"
+             "speedup         %8.2fx\n", lines[0] / lines[1],
+             rate[1] / rate[0]);
+    cout << buf;
+    if (fd >= 0 && misses[1] > 0) {
+        snprintf(buf, sizeof(buf), "miss reduction  %8.2fx\n",
+                 static_cast<double>(misses[0]) / misses[1]);
+        cout << buf;
+    }
+    cout << ((num_diff == 0) ? "Spikes are identical"
+                             : to_string(num_diff) + " spike file(s) differ")
+         << endl;
+    return num_diff > 0;
+}
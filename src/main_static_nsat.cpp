@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cstdio>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "batch_core.h"
+#include "static_core.h"
+
+
+/***************************************************************************
+ * The params/bs network (see params/bs/bs.cfg): excitatory and inhibitory
+ * Poisson inputs onto a visible group, which is connected both ways to a
+ * hidden group. Both NSAT groups have a bias and a refractory period but
+ * no noise, and all the projections are blanked out. The synapse counts
+ * come from "static_nsat describe" (see static_describe).
+ ***************************************************************************/
+typedef static_core<
+    static_list<static_input<18, EXCITATORY_NEURON>,        // 0: excinput
+                static_input<18, INHIBITORY_NEURON>>,       // 1: inhinput
+    static_list<static_nsat<18, EXCITATORY_NEURON, false, true, true>,  // 2: visible
+                static_nsat<46, EXCITATORY_NEURON, false, true, true>>, // 3: hidden
+    static_list<static_projection<0, 2, 18>,                // excinput -> visible
+                static_projection<1, 2, 18>,                // inhinput -> visible
+                static_projection<3, 2, 828>,               // hidden -> visible
+                static_projection<2, 3, 828>>               // visible -> hidden
+> bs_network;
+
+
+/***************************************************************************
+ * Returns the contents of a file (empty if it cannot be read).
+ ***************************************************************************/
+static string read_file(const string &fname) {
+    ifstream in(fname, ios::binary);
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+
+/***************************************************************************
+ * Compile-time network example and benchmark. It builds the params/bs
+ * network both with its compile-time description (static_core) and with
+ * the runtime-configured batch mode (batch_core, batch size 1), runs each
+ * one <repeats> times for the configured time and compares their
+ * simulation speeds (simulated ms per wall second). Both draw the same
+ * random numbers, so their spike files (<output dir>/static and
+ * <output dir>/runtime/batch0) have to be identical; otherwise it exits
+ * with 1.
+ *
+ *  describe [config file] : Prints the compile-time description of a
+ *      network instead (see static_describe), e.g. to update bs_network.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    string cfg_file = "params/bs/bs.cfg", out_dir = "results/static";
+    int repeats = 10;
+    config_core cfg;
+    double t_static = 0.0, t_runtime = 0.0;
+    int num_steps, num_diff = 0;
+    char buf[256];
+
+    if (argc > 1 && string(argv[1]) == "describe") {
+        if (argc > 2) cfg_file = argv[2];
+        if (cfg.load(cfg_file) != 0) return 1;
+        try {
+            nsat_core core(cfg.get_filenames(),
+                           cfg.get_carlsim(),
+                           cfg.get_simulation());
+            cout << static_describe(&core, "network");
+        }
+        catch (int &e) {
+            print_exceptions(e);
+            return e;
+        }
+        return 0;
+    }
+    if (argc > 1) cfg_file = argv[1];
+    if (argc > 2) repeats = max(1, atoi(argv[2]));
+    if (argc > 3) out_dir = argv[3];
+    if (cfg.load(cfg_file) != 0) return 1;
+
+    try {
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        num_steps = cfg.get_simulation()->sim_time_sec * 1000 +
+                    cfg.get_simulation()->sim_time_msec;
+
+        // Runtime-configured network
+        batch_core batch(&core, 1);
+        batch.set_results_dir(out_dir + "/runtime");
+        if (batch.b_setup_state() != 0) return 1;
+        for (int r = 0; r < repeats; ++r) {
+            batch.reset_state(true);
+            if (batch.b_run_state() != 0) return 1;
+            t_runtime += num_steps / batch.get_sim_rate();
+        }
+
+        // Compile-time network
+        bs_network *net = new bs_network(&core);
+        net->set_results_dir(out_dir + "/static");
+        if (net->s_setup_state() != 0) return 1;
+        for (int r = 0; r < repeats; ++r) {
+            net->reset_state();
+            auto t0 = chrono::steady_clock::now();
+            net->run(num_steps);
+            t_static += chrono::duration<double>(chrono::steady_clock::now()
+                                                 - t0).count();
+        }
+        net->write_spikes();
+
+        // Identical spikes
+        for (auto &u : core.get_input_units()) {
+            string name = "/spk" + u.unit_name + ".dat";
+            if (read_file(out_dir + "/static" + name) !=
+                read_file(out_dir + "/runtime/batch0" + name)) num_diff++;
+        }
+        for (auto &u : core.get_nsat_units()) {
+            string name = "/spk" + u.unit_name + ".dat";
+            if (read_file(out_dir + "/static" + name) !=
+                read_file(out_dir + "/runtime/batch0" + name)) num_diff++;
+        }
+        delete net;
+    }
+    catch (int &e) {
+        print_exceptions(e);
+        return e;
+    }
+
+    double rate_runtime = repeats * num_steps / t_runtime;
+    double rate_static = repeats * num_steps / t_static;
+    snprintf(buf, sizeof(buf), "%-8s %14s\n%-8s %14.1f\n%-8s %14.1f\n"
+             "speedup  %14.2f\n", "network", "sim ms/s", "runtime",
+             rate_runtime, "static", rate_static, rate_static / rate_runtime);
+    cout << buf;
+    cout << ((num_diff == 0) ? "Spikes are identical"
+                             : to_string(num_diff) + " spike file(s) differ")
+         << endl;
+    return num_diff > 0;
+}
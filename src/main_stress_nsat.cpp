@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <dirent.h>
+
+#include "nsat_core.h"
+#include "config_core.h"
+#include "netgen_core.h"
+
+
+#define NUM_INSTANCES 32
+
+
+/* ----------------------------------
+ * Outcome of an instance struct
+ * ----------------------------------*/
+typedef struct outcome_s {
+    int rc;                 // first non-zero code of the states (0: ok)
+    int last_error;         // instance's last error
+    int64_t spikes;         // spikes of the NSAT groups
+    bool files;             // all the monitor files exist
+} outcome;
+
+
+/***************************************************************************
+ * Number of monitor files (spk<group name>.dat) in a directory.
+ ***************************************************************************/
+static int count_monitor_files(const string &dir) {
+    DIR *d = opendir(dir.c_str());
+    struct dirent *ent;
+    int n = 0;
+
+    if (d == NULL) return 0;
+    while ((ent = readdir(d)) != NULL) {
+        string name = ent->d_name;
+        if (name.size() > 7 && name.compare(0, 3, "spk") == 0 &&
+            name.compare(name.size() - 4, 4, ".dat") == 0) n++;
+    }
+    closedir(d);
+    return n;
+}
+
+
+/***************************************************************************
+ * Builds, runs and cleans up one instance of the network (files in dir,
+ * num_groups monitored NSAT groups) with its own results directory and
+ * log file, and records its outcome.
+ ***************************************************************************/
+static void run_instance(const string &dir, int num_groups, int i,
+                         outcome &out) {
+    string inst = dir + "/inst" + to_string(i);
+    config_core cfg;
+
+    out.rc = 0;
+    out.last_error = 0;
+    out.spikes = -1;
+    out.files = false;
+    if (cfg.load(dir + "/net.cfg") != 0) { out.rc = 18; return; }
+
+    nsat_core core(cfg.get_filenames(),
+                   cfg.get_carlsim(),
+                   cfg.get_simulation());
+    try {
+        core.set_results_dir(inst);
+        core.set_log_file(inst + "/nsat.log");
+        if ((out.rc = core.c_config_state()) == 0 &&
+            (out.rc = core.c_setup_state()) == 0 &&
+            (out.rc = core.c_run_state()) == 0) {
+            out.spikes = core.get_num_spikes();
+        }
+    }
+    catch (int &e) { out.rc = core.error(e); }
+    catch (...) { out.rc = -1; }
+    out.last_error = core.get_last_error();
+    core.c_cleanup();
+
+    // Every monitored group wrote its own file
+    out.files = count_monitor_files(inst) >= num_groups;
+}
+
+
+/***************************************************************************
+ * Concurrency stress test of NSAT Core. It generates a small network
+ * (see netgen_core.h) in <output dir> and runs <instances> (default 32)
+ * independent nsat_core instances of it at once, one thread each, every
+ * one with its own results directory and log file (<output dir>/inst<i>).
+ * Since they share the seed, all the instances must succeed (no error
+ * returned, none recorded), write their monitor files and count the same
+ * spikes; otherwise the failing instances are reported and it exits with
+ * 1. The inputs are counter-based (poisson_schedule): the poisson type
+ * draws from drand48, which all the instances share (see
+ * NSAT_CORE::INITIALIZE_INSTANCE), so their spikes would differ.
+ ***************************************************************************/
+int main(int argc, char **argv) {
+    string out_dir = "results/stress";
+    int num_instances = NUM_INSTANCES;
+    netgen_params p;
+    int num_failed = 0;
+    char buf[256];
+
+    if (argc > 1) num_instances = max(1, atoi(argv[1]));
+    if (argc > 2) out_dir = argv[2];
+
+    p.num_groups = 2;
+    p.num_neurons = 100;
+    p.density = 0.1;
+    p.radius = 0;
+    p.rate = 20.0;
+    p.stdp = false;
+    p.sim_time_ms = 500;
+    p.seed = 42;
+    p.input_type = "poisson_schedule";
+
+    try { netgen_core(p).write(out_dir); }
+    catch (int &e) {
+        print_exceptions(e);
+        return e;
+    }
+
+    vector<outcome> outcomes(num_instances);
+    vector<thread> threads;
+    for (int i = 0; i < num_instances; ++i)
+        threads.push_back(thread(run_instance, out_dir, p.num_groups, i,
+                                 ref(outcomes[i])));
+    for (auto &t : threads) t.join();
+
+    for (int i = 0; i < num_instances; ++i) {
+        const outcome &o = outcomes[i];
+        bool ok = (o.rc == 0) && (o.last_error == 0) && o.files &&
+                  (o.spikes == outcomes[0].spikes);
+        snprintf(buf, sizeof(buf), "%-6d %6d %6d %10lld %6s %s\n", i, o.rc,
+                 o.last_error, static_cast<long long>(o.spikes),
+                 o.files ? "yes" : "no", ok ? "ok" : "FAILED");
+        cout << buf;
+        if (!ok) num_failed++;
+    }
+    cout << num_failed << " of " << num_instances << " instance(s) failed"
+         << endl;
+    return num_failed > 0;
+}
@@ -0,0 +1,38 @@
+#include "nsat_core.h"
+#include "config_core.h"
+#include "sweep_core.h"
+
+int main(int argc, char **argv) {
+    int res;                    // return flag
+    int num_workers = 4;        // number of worker processes
+    string out_dir = "results/sweep";
+    config_core cfg;            // base configuration
+
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <config file> <sweep file>"
+             << " [workers] [output dir]" << endl;
+        return 1;
+    }
+    if (argc > 3) num_workers = atoi(argv[3]);
+    if (argc > 4) out_dir = argv[4];
+
+    // Load the base configuration
+    if (cfg.load(argv[1]) != 0) return 1;
+
+    // Run the sweep - at most two jobs per worker are in flight
+    try {
+        sweep_core sweep(cfg, out_dir);
+        res = sweep.load_sweep(argv[2]);
+        res = sweep.run(num_workers, 2 * num_workers);
+    }
+    catch (int &e) {
+        print_exceptions(e);                // Custom exceptions - see auxiliary.cpp
+        res = e;
+    }
+    catch(runtime_error &e) {
+        cout << e.what() << endl;           // Generic runtime exceptions
+        res = 1;
+    }
+
+    return (res == 0) ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#include "nsat_core.h"
+#include "config_core.h"
+#include "trial_core.h"
+
+int main(int argc, char **argv) {
+    int res;                    // return flag
+    int max_children = 4;       // maximum concurrent trials
+    string out_dir = "results/trials";
+    config_core cfg;            // base configuration
+
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <config file> <trials file>"
+             << " [max children] [output dir]" << endl;
+        return 1;
+    }
+    if (argc > 3) max_children = atoi(argv[3]);
+    if (argc > 4) out_dir = argv[4];
+
+    // Load the base configuration
+    if (cfg.load(argv[1]) != 0) return 1;
+
+    // Build the network once, then fork a child per trial
+    try {
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        res = core.c_config_state();        // CARLsim config state
+        res = core.c_setup_state();         // CARLsim setup state
+
+        trial_core runner(&core, out_dir);
+        res = runner.load_trials(argv[2]);
+        res = runner.run(max_children);
+        core.c_cleanup();
+    }
+    catch (int &e) {
+        print_exceptions(e);                // Custom exceptions - see auxiliary.cpp
+        res = e;
+    }
+    catch(runtime_error &e) {
+        cout << e.what() << endl;           // Generic runtime exceptions
+        res = 1;
+    }
+
+    return (res == 0) ? 0 : 1;
+}
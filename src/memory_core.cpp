@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "memory_core.h"
+
+using namespace std;
+
+
+#define MB (1024.0 * 1024.0)
+
+
+/***************************************************************************
+ * Reads a field (kB) of /proc/self/status and returns it in bytes (0 if
+ * it cannot be read).
+ ***************************************************************************/
+static int64_t proc_status(const char *field) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[256];
+    long long kb = 0;
+    size_t len = strlen(field);
+
+    if (fp == NULL) return 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, field, len) == 0 && line[len] == ':') {
+            sscanf(line + len + 1, "%lld", &kb);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb * 1024;
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * MEMORY_CORE Class Constructor - No budget, unless the environment
+ * variable NSAT_MEMORY_BUDGET_MB sets one (MB).
+ ***************************************************************************/
+memory_core::memory_core() {
+    const char *mb = getenv("NSAT_MEMORY_BUDGET_MB");
+
+    budget = 0;
+    out = &cout;
+    if (mb != NULL && *mb != '\0') set_budget(atof(mb) * MB);
+}
+
+
+/***************************************************************************
+ * Index of the entry of an owner (-1 if it has not been set).
+ ***************************************************************************/
+int memory_core::find(const string &subsystem, const string &name) const {
+    for (int i = 0; i < entries.size(); ++i)
+        if (entries[i].subsystem == subsystem && entries[i].name == name)
+            return i;
+    return -1;
+}
+
+
+/***************************************************************************
+ * Prints why the budget is exceeded and the breakdown, then throws 28.
+ ***************************************************************************/
+void memory_core::exceeded(const string &what, int64_t need) const {
+    char buf[256];
+
+    snprintf(buf, sizeof(buf), "Memory budget of %.2f MB exceeded by %s "
+             "(%.2f MB needed)\n", budget / MB, what.c_str(), need / MB);
+    *out << buf;
+    print(*out);
+    throw 28;
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE SET - This method sets the bytes owned by an owner of a
+ * subsystem (0 keeps the entry, so it shows in the breakdown).
+ *
+ * Args:
+ * -----
+ *  subsystem (string) : Subsystem (weights, connx, inputs, monitors,
+ *                       carlsim).
+ *  name (string)      : Owner within the subsystem.
+ *  bytes (int64_t)    : Bytes it owns.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void memory_core::set(const string &subsystem,
+                      const string &name,
+                      int64_t bytes) {
+    int i = find(subsystem, name);
+
+    if (i < 0) {
+        mem_entry e;
+        e.subsystem = subsystem;
+        e.name = name;
+        entries.push_back(e);
+        i = entries.size() - 1;
+    }
+    entries[i].bytes = bytes;
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE RESERVE - This method is called before an owner allocates
+ * bytes: it fails if the resident set plus the bytes, or the accounted
+ * total with the owner's new size, would exceed the budget. Otherwise it
+ * sets the owner's bytes.
+ *
+ * Args:
+ * -----
+ *  subsystem (string) : Subsystem.
+ *  name (string)      : Owner within the subsystem.
+ *  bytes (int64_t)    : Bytes it is about to own.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  28 : Memory budget exceeded.
+ ***************************************************************************/
+void memory_core::reserve(const string &subsystem,
+                          const string &name,
+                          int64_t bytes) {
+    if (budget > 0) {
+        int i = find(subsystem, name);
+        int64_t accounted = total() + bytes;
+        if (i >= 0) accounted -= entries[i].bytes;
+        int64_t need = max(rss() + bytes, accounted);
+        if (need > budget) exceeded(subsystem + " " + name, need);
+    }
+    set(subsystem, name, bytes);
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE CHECK - This method fails if the resident set exceeds the
+ * budget (nothing without a budget).
+ *
+ * Args:
+ * -----
+ *  what (string) : Phase just done, for the report.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  28 : Memory budget exceeded.
+ ***************************************************************************/
+void memory_core::check(const string &what) const {
+    if (budget <= 0) return;
+
+    int64_t now = rss();
+    if (now > budget) exceeded(what, now);
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE REMOVE - This method removes all the owners of a subsystem
+ * (e.g. when it is freed or rebuilt).
+ ***************************************************************************/
+void memory_core::remove(const string &subsystem) {
+    vector<mem_entry> keep;
+
+    for (auto &e : entries)
+        if (e.subsystem != subsystem) keep.push_back(e);
+    entries.swap(keep);
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE TOTAL - Bytes of all the owners.
+ ***************************************************************************/
+int64_t memory_core::total() const {
+    int64_t n = 0;
+
+    for (auto &e : entries) n += e.bytes;
+    return n;
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE TOTAL - Bytes of the owners of a subsystem.
+ ***************************************************************************/
+int64_t memory_core::total(const string &subsystem) const {
+    int64_t n = 0;
+
+    for (auto &e : entries)
+        if (e.subsystem == subsystem) n += e.bytes;
+    return n;
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE TO_JSON - This method returns the accounting as a JSON
+ * object: budget, total, rss and peak_rss (bytes) and the entries
+ * (subsystem, name, bytes).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  JSON text (string).
+ ***************************************************************************/
+string memory_core::to_json() const {
+    char buf[512];
+
+    snprintf(buf, sizeof(buf),
+             "{\"budget\": %lld, \"total\": %lld, \"rss\": %lld, "
+             "\"peak_rss\": %lld, \"entries\": [",
+             static_cast<long long>(budget), static_cast<long long>(total()),
+             static_cast<long long>(rss()),
+             static_cast<long long>(peak_rss()));
+    string out = buf;
+    for (int i = 0; i < entries.size(); ++i) {
+        snprintf(buf, sizeof(buf),
+                 "%s\n  {\"subsystem\": \"%s\", \"name\": \"%s\", "
+                 "\"bytes\": %lld}",
+                 i ? "," : "", entries[i].subsystem.c_str(),
+                 entries[i].name.c_str(),
+                 static_cast<long long>(entries[i].bytes));
+        out += buf;
+    }
+    out += entries.empty() ? "]}" : "\n]}";
+    return out;
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE PRINT - This method prints the breakdown: the total of
+ * every subsystem (in the order they were first set) followed by its
+ * owners, then the accounted total and the resident set.
+ *
+ * Args:
+ * -----
+ *  out (ostream &) : Output stream.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void memory_core::print(ostream &out) const {
+    vector<string> subsystems;
+    char buf[256];
+
+    for (auto &e : entries)
+        if (std::find(subsystems.begin(), subsystems.end(), e.subsystem)
+            == subsystems.end())
+            subsystems.push_back(e.subsystem);
+
+    snprintf(buf, sizeof(buf), "%-40s %12s\n", "memory", "MB");
+    out << buf;
+    for (auto &s : subsystems) {
+        snprintf(buf, sizeof(buf), "%-40s %12.2f\n", s.c_str(),
+                 total(s) / MB);
+        out << buf;
+        for (auto &e : entries) {
+            if (e.subsystem != s) continue;
+            string name = "  " + e.name;
+            snprintf(buf, sizeof(buf), "%-40s %12.2f\n", name.c_str(),
+                     e.bytes / MB);
+            out << buf;
+        }
+    }
+    snprintf(buf, sizeof(buf), "%-40s %12.2f\n%-40s %12.2f\n%-40s %12.2f\n",
+             "accounted", total() / MB, "rss", rss() / MB,
+             "peak rss", peak_rss() / MB);
+    out << buf;
+    if (budget > 0) {
+        snprintf(buf, sizeof(buf), "%-40s %12.2f\n", "budget", budget / MB);
+        out << buf;
+    }
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE RSS - Resident set size of the process (bytes).
+ ***************************************************************************/
+int64_t memory_core::rss() {
+    return proc_status("VmRSS");
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE PEAK_RSS - High-water mark of the resident set size of the
+ * process (bytes) since the start or the last RESET_PEAK_RSS.
+ ***************************************************************************/
+int64_t memory_core::peak_rss() {
+    return proc_status("VmHWM");
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE SAMPLE - Resident set size and its high-water mark (bytes),
+ * read in one pass of /proc/self/status (0 if they cannot be read).
+ *
+ * Args:
+ * -----
+ *  rss (int64_t &)  : Resident set size (output).
+ *  peak (int64_t &) : High-water mark (output).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void memory_core::sample(int64_t &rss, int64_t &peak) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[256];
+    long long kb;
+
+    rss = peak = 0;
+    if (fp == NULL) return;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "VmHWM: %lld", &kb) == 1) peak = kb * 1024;
+        else if (sscanf(line, "VmRSS: %lld", &kb) == 1) rss = kb * 1024;
+        if (rss > 0 && peak > 0) break;
+    }
+    fclose(fp);
+}
+
+
+/***************************************************************************
+ * MEMORY_CORE RESET_PEAK_RSS - Resets the high-water mark of the
+ * resident set size to the current one. Returns false if the kernel does
+ * not support it (the mark then keeps growing from the start).
+ ***************************************************************************/
+bool memory_core::reset_peak_rss() {
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+
+    if (fp == NULL) return false;
+    bool ok = fputs("5", fp) >= 0;
+    return (fclose(fp) == 0) && ok;
+}
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "netgen_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * NETGEN_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * NETGEN_CORE Class Constructor.
+ *
+ * Args:
+ * -----
+ *  p (netgen_params) : The network parameters.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural groups/neurons.
+ ***************************************************************************/
+netgen_core::netgen_core(const netgen_params &p) {
+    if (p.num_groups <= 0 || p.num_neurons <= 0) { throw 7; }
+    params = p;
+    num_synapses = 0;
+}
+
+
+/***************************************************************************
+ * NETGEN_CORE GROUP_NAME - Name of a NSAT group: e<k> (excitatory) or
+ * i<k> (inhibitory, every fourth group).
+ ***************************************************************************/
+string netgen_core::group_name(int k) const {
+    return ((k % 4 == 3) ? "i" : "e") + to_string(k);
+}
+
+
+/***************************************************************************
+ * NETGEN_CORE POSITIONS - Ring position of each neuron of a group (NSAT
+ * group k, or the input group for k = num_groups): a random permutation
+ * when the connectivity is local.
+ ***************************************************************************/
+vector<int> netgen_core::positions(int k) const {
+    seed_seq seq{static_cast<uint32_t>(params.seed),
+                 static_cast<uint32_t>(2 * params.num_groups + k)};
+    mt19937 gen(seq);
+    vector<int> pos(params.num_neurons);
+
+    for (int i = 0; i < pos.size(); ++i) pos[i] = i;
+    if (params.radius > 0) shuffle(pos.begin(), pos.end(), gen);
+    return pos;
+}
+
+
+/***************************************************************************
+ * NETGEN_CORE WRITE_PROJECTION - This method writes a connection file:
+ * the header (source, destination, source is input, blankout) and the
+ * num_neurons x num_neurons weights matrix.
+ *
+ * Args:
+ * -----
+ *  fname (string) : Connection file name.
+ *  src (int)      : Source group (num_groups for the input group).
+ *  dest (int)     : Destination group.
+ *  stream (uint32_t) : Index of the random stream of the projection.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write results file.
+ ***************************************************************************/
+void netgen_core::write_projection(const string &fname,
+                                   int src,
+                                   int dest,
+                                   uint32_t stream) {
+    seed_seq seq{static_cast<uint32_t>(params.seed), stream};
+    mt19937 gen(seq);
+    uniform_real_distribution<float> u01(0.0, 1.0);
+    int n = params.num_neurons;
+    bool src_input = (src == params.num_groups);
+    vector<int> pos_src = positions(src), pos_dest = positions(dest);
+    FILE *fp = fopen(fname.c_str(), "w");
+
+    if (fp == NULL) { throw 15; }
+    fprintf(fp, "%s %s %s 0.0\n",
+            src_input ? "input" : group_name(src).c_str(),
+            group_name(dest).c_str(), src_input ? "true" : "false");
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            int d = abs(pos_src[i] - pos_dest[j]);
+            bool near = params.radius <= 0 || min(d, n - d) <= params.radius;
+            float w = 0.0;
+            if (near && u01(gen) < params.density) {
+                w = 1.0 + 4.0 * u01(gen);
+                num_synapses++;
+            }
+            fprintf(fp, (j < n - 1) ? "%.2f " : "%.2f\n", w);
+        }
+    }
+    fclose(fp);
+}
+
+
+/***************************************************************************
+ * NETGEN_CORE WRITE - This method writes the network into a directory
+ * (created if needed): spkg_params.dat, nsat_params.dat, stdp_params.dat,
+ * delay_params.dat, the connection files <src>_<dest>.dat and the
+ * configuration file net.cfg (CPU mode).
+ *
+ * Args:
+ * -----
+ *  dir (string) : Output directory.
+ *
+ * Returns:
+ * --------
+ *  0 if the files are succesfully written.
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write results file.
+ ***************************************************************************/
+int netgen_core::write(const string &dir) {
+    int G = params.num_groups, N = params.num_neurons;
+    vector<string> conns;
+    FILE *fp;
+
+    make_dirs(dir);
+    num_synapses = 0;
+
+    // Input group
+    if ((fp = fopen((dir + "/spkg_params.dat").c_str(), "w")) == NULL) {
+        throw 15;
+    }
+    fprintf(fp, "# Name N Type OnGPU Rate Freq SAZ M\n");
+    fprintf(fp, "input %d EXCITATORY_NEURON false %.2f 0.0 false true\n",
+            N, params.rate);
+    fclose(fp);
+
+    // NSAT groups
+    if ((fp = fopen((dir + "/nsat_params.dat").c_str(), "w")) == NULL) {
+        throw 15;
+    }
+    fprintf(fp, "# Name N Type Alpha Beta Sigma Vth Vreset b t_ref alphaS mflag\n");
+    for (int k = 0; k < G; ++k) {
+        fprintf(fp, "%s %d %s 0.9 1.0 0.0 20.0 0.0 0.1 3 0.9 true\n",
+                group_name(k).c_str(), N,
+                (k % 4 == 3) ? "INHIBITORY_NEURON" : "EXCITATORY_NEURON");
+    }
+    fclose(fp);
+
+    // STDP on the excitatory groups (header only if it is off)
+    if ((fp = fopen((dir + "/stdp_params.dat").c_str(), "w")) == NULL) {
+        throw 15;
+    }
+    fprintf(fp, "# GroupName Type DA_Mode STDP_Fun is_set alphaPlus tauPlus "
+                "alphaMinus tauMinus betaLtP betaLTD lambda delta gamma\n");
+    for (int k = 0; k < G && params.stdp; ++k) {
+        if (k % 4 == 3) continue;
+        fprintf(fp, "%s E STANDARD 0 true 0.05 20.0 0.05 20.0 "
+                    "0 0 0 0 0\n", group_name(k).c_str());
+    }
+    fclose(fp);
+
+    if ((fp = fopen((dir + "/delay_params.dat").c_str(), "w")) == NULL) {
+        throw 15;
+    }
+    fprintf(fp, "1 1\n");
+    fclose(fp);
+
+    // Input onto every group, then the ring of groups
+    for (int k = 0; k < G; ++k) {
+        string fname = dir + "/input_" + group_name(k) + ".dat";
+        write_projection(fname, G, k, conns.size());
+        conns.push_back(fname);
+    }
+    for (int k = 0; k < G; ++k) {
+        string src = group_name(k), dest = group_name((k + 1) % G);
+        string fname = dir + "/" + src + "_" + dest + ".dat";
+        write_projection(fname, k, (k + 1) % G, conns.size());
+        conns.push_back(fname);
+    }
+
+    // Configuration file
+    if ((fp = fopen((dir + "/net.cfg").c_str(), "w")) == NULL) {
+        throw 15;
+    }
+    fprintf(fp, "# Synthetic network: %d groups x %d neurons, density %g, "
+                "radius %d\n", G, N, params.density, params.radius);
+    fprintf(fp, "sim_name          synthetic\n");
+    fprintf(fp, "mode              cpu\n");
+    fprintf(fp, "logger            silent\n");
+    fprintf(fp, "random_seed       %d\n", params.seed);
+    fprintf(fp, "int_method        forward_euler\n");
+    fprintf(fp, "int_num_steps     2\n");
+    fprintf(fp, "maxWt             10.0\n");
+    fprintf(fp, "sim_time_sec      %d\n", params.sim_time_ms / 1000);
+    fprintf(fp, "sim_time_msec     %d\n", params.sim_time_ms % 1000);
+    fprintf(fp, "input_type        %s\n", params.input_type.c_str());
+    fprintf(fp, "spkg_fname        %s/spkg_params.dat\n", dir.c_str());
+    fprintf(fp, "nsat_fname        %s/nsat_params.dat\n", dir.c_str());
+    fprintf(fp, "stdp_fname        %s/stdp_params.dat\n", dir.c_str());
+    fprintf(fp, "delay_fname       %s/delay_params.dat\n", dir.c_str());
+    for (auto &c : conns) fprintf(fp, "conn_fname        %s\n", c.c_str());
+    fclose(fp);
+    return 0;
+}
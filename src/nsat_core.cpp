@@ -8,6 +8,9 @@ using namespace std;
  * NSAT_CORE Class Implementation
  ***************************************************************************/
 
+// Instances created so far (ids)
+static atomic<int> next_instance(0);
+
 /***************************************************************************
  * NSAT_CORE Class Constructor - The NSAT Core Class constructor is 
  * responsible for initializing all the CARLsim and simulation parameters.
@@ -27,6 +30,9 @@ nsat_core::nsat_core(filenames *f, carlsim *c, simulation *s) {
     int flag;
     string tmp;
 
+    initialize_instance();
+    timer_scope scope(timer, "construct");
+
     // Load core parameters
     load_core_params(c, s, f);
 
@@ -43,17 +49,115 @@ nsat_core::nsat_core(filenames *f, carlsim *c, simulation *s) {
                              &nsat_core::load_params);
     
     // Initialize neural layers
-    flag = initialize_layers();
+    {
+        timer_scope layers_scope(timer, "initialize_layers");
+        flag = initialize_layers();
+    }
 
     // Instantiate CARLsim and allocate memory for it
-    sim = new CARLsim(carl_p.sim_name, carl_p.mode,
-                      carl_p.logger, carl_p.gpu_index,
-                      carl_p.random_seed);
+    create_carlsim();
 
     // Count groups that have to be monitored
     count_lies_truths();
 }
 
+/***************************************************************************
+ * NSAT_CORE Class Constructor - In-memory construction: it loads the
+ * CARLsim and simulation parameters and instantiates CARLsim, without any
+ * parameters file. The groups and the connections are then declared by
+ * ADD_INPUT_GROUP, ADD_NSAT_GROUP and ADD_PROJECTION(_CSR) before the
+ * config state (STDP is off, the number of connections of the simulation
+ * struct is ignored).
+ *
+ * Args:
+ * -----
+ *  c (carlsim *)    : A pointer to CARLsim struct.
+ *  s (simulation *) : A pointer to simulation struct.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+nsat_core::nsat_core(carlsim *c, simulation *s) {
+    initialize_instance();
+    num_in_groups = num_nsat_groups = 0;
+    timer_scope scope(timer, "construct");
+
+    load_core_params(c, s, NULL);
+    sim_p.num_connections = 0;
+
+    create_carlsim();
+}
+
+
+/***************************************************************************
+ * NSAT_CORE INITIALIZE_INSTANCE - This method initializes the state of a
+ * new instance (both constructors). Several instances can be built and
+ * run concurrently (one thread each): every instance has its own id, log
+ * stream (standard output by default, see SET_LOG_FILE) and last error.
+ * Its monitors and CARLsim log go to CARLsim's default files unless a
+ * results directory is set (see SET_RESULTS_DIR), so instances that run
+ * concurrently have to be given one results directory (and log file)
+ * each. The one state they share is drand48, which CARLsim draws its CPU
+ * random numbers from (e.g. the poisson input type): it is process-wide,
+ * so concurrent instances that use it interleave their random streams and
+ * their runs are not reproducible. Counter-based inputs
+ * (poisson_schedule, periodical, vectorial) and batch mode (batch_core)
+ * do not use it.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void nsat_core::initialize_instance() {
+    sim = NULL;
+    shared_projs = NULL;
+    restored_time = 0;
+    carl_state = 0;
+    ckpt_enabled = false;
+    grid_input_layers = grid_nsat_layers = NULL;
+    connex = NULL;
+    psn_spkg = NULL;
+    calendar = NULL;
+    async_slice = 0;
+    async_running = async_cancel = false;
+    async_ms = 0;
+    async_spikes = 0;
+    async_rc = 0;
+
+    instance_id = next_instance++;
+    log = &cout;
+    mem.set_output(cout);
+    last_error = 0;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE CREATE_CARLSIM - This method instantiates CARLsim (both
+ * constructors) and accounts the memory it takes.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void nsat_core::create_carlsim() {
+    timer_scope scope(timer, "CARLsim");
+    int64_t rss0 = memory_core::rss();
+
+    sim = new CARLsim(carl_p.sim_name, carl_p.mode,
+                      carl_p.logger, carl_p.gpu_index,
+                      carl_p.random_seed);
+    mem.set("carlsim", "instance", max<int64_t>(0, memory_core::rss() - rss0));
+}
+
 
 /***************************************************************************
  * NSAT_CORE Class Destructor - The NSAT Core Class destructor. It 
@@ -69,6 +173,9 @@ nsat_core::nsat_core(filenames *f, carlsim *c, simulation *s) {
  *  Void
  ***************************************************************************/
 nsat_core::~nsat_core() {
+    // Stop an asynchronous run
+    cancel();
+
     // Clean up CARLsim obejct - instance
     delete sim;
 }
@@ -88,41 +195,48 @@ nsat_core::~nsat_core() {
  *  it throws bad allocation exception. 
  ***************************************************************************/
 int nsat_core::c_cleanup() {
+    timer_scope scope(timer, "cleanup");
+
     try {
         // Cast char* to string and make convert to lowercase
         string tmp = static_cast<string>(sim_p.input_type);
         transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
     
-        // Clean up input and nsat layers arrays
-        for (int i = 0; i < num_in_groups; ++i) {
+        // Clean up input and nsat layers arrays (built by the config
+        // state of an in-memory network)
+        // state of an in-memory network). Every pointer is reset, so a
+        // second cleanup (or one before the config state) is safe.
+        for (int i = 0; grid_input_layers && i < num_in_groups; ++i) {
             delete grid_input_layers[i];
         }
         delete[] grid_input_layers;
-        for (int i = 0; i < num_nsat_groups; ++i) {
+        grid_input_layers = NULL;
+        for (int i = 0; grid_nsat_layers && i < num_nsat_groups; ++i) {
             delete grid_nsat_layers[i];
         }
         delete[] grid_nsat_layers;
+        grid_nsat_layers = NULL;
 
         // Clean up input arrays
         if (tmp == "poisson" ) {
-            for (int i = 0; i < num_in_groups; ++i)
+            for (int i = 0; psn_spkg && i < num_in_groups; ++i)
                 delete psn_spkg[i];
             delete[] psn_spkg;
-        } else if (tmp == "periodical") {
-            for (int i = 0; i < num_in_groups; ++i)
-                delete prd_spkg[i];
-            delete[] prd_spkg;
-        } else if (tmp == "vectorial") {
-            for (int i = 0; i < num_in_groups; ++i)
-                delete vec_spkg[i];
-            delete[] vec_spkg;
-        } else { cerr << "Not a recognized input type!" << endl; }
+            psn_spkg = NULL;
+        } else if (tmp == "poisson_schedule" || tmp == "periodical" ||
+                   tmp == "vectorial" || tmp == "fromfile") {
+            delete calendar;
+            calendar = NULL;
+        } else { *log << "Not a recognized input type!" << endl; }
 
         // Clean up connections arrays
-        delete connex;
+        for (int k = 0; connex && k < sim_p.num_connections; ++k)
+            delete connex[k];
+        delete[] connex;
+        connex = NULL;
     }
     catch (...) {
-        cout << "Memory Exception: Memory cannot be freed!" << endl;
+        *log << "Memory Exception: Memory cannot be freed!" << endl;
     }
     return 0;
 }
@@ -135,7 +249,7 @@ int nsat_core::c_cleanup() {
  *
  * Args:
  * -----
- *  f (filenames *)  : A pointer to filenames struct.  
+ *  f (filenames *)  : A pointer to filenames struct (NULL: no files).  
  *  c (carlsim *)    : A pointer to CARLsim struct.
  *  s (simulation *) : A pointer to simulation struct.
  *
@@ -147,12 +261,18 @@ void nsat_core::load_core_params(carlsim *c,
                                  simulation *s,
                                  filenames *f) {
     // Assign filenames
-    fnames.spkg_fname = f->spkg_fname;
-    fnames.nsat_fname = f->nsat_fname;
-    fnames.stdp_fname = f->stdp_fname;
-    fnames.conn_fname = f->conn_fname;
-    fnames.delay_fname = f->delay_fname;
-    fnames.finp_spikes = f->finp_spikes;
+    if (f != NULL) {
+        fnames.spkg_fname = f->spkg_fname;
+        fnames.nsat_fname = f->nsat_fname;
+        fnames.stdp_fname = f->stdp_fname;
+        fnames.conn_fname = f->conn_fname;
+        fnames.delay_fname = f->delay_fname;
+        fnames.finp_spikes = f->finp_spikes;
+    } else {
+        fnames.spkg_fname = fnames.nsat_fname = fnames.stdp_fname = NULL;
+        fnames.delay_fname = NULL;
+        fnames.conn_fname = fnames.finp_spikes = NULL;
+    }
 
     // Assign CARLsim parameters
     carl_p.sim_name = c->sim_name;
@@ -243,6 +363,7 @@ int nsat_core::load_params(ifstream &file, int &count_lines, string &flag) {
         count_lines = 0;
         while (getline(file, line)) {
             count_lines++;
+            timer.add_bytes(line.size() + 1);
             if (line.empty()) { continue; }     // Empty lines
             else if (regex_search(line, com_sec)) { continue; } // Non-numerics
             else {
@@ -277,6 +398,7 @@ int nsat_core::load_params(ifstream &file, int &count_lines, string &flag) {
         count_lines = 0;
         while (getline(file, line)) {
             count_lines++;
+            timer.add_bytes(line.size() + 1);
             if (line.empty()) { continue; }
             else if (regex_search(line, com_sec)) { continue; }
             else {
@@ -384,6 +506,7 @@ int nsat_core::initialize_params(char *fname, string &type,
     int count_lines;
     ifstream infile;
     infile.exceptions(ifstream::badbit);
+    timer_scope scope(timer, "load_params (" + type + ")");
 
     // Try to open a file and read parameters
     try {
@@ -392,11 +515,12 @@ int nsat_core::initialize_params(char *fname, string &type,
     }
     // Catch file I/O exceptions
     catch (ifstream::failure &e){
-        cout << e.what() << endl;
+        *log << e.what() << endl;
     }
     // Catch other exceptions - see auxiliary.cpp
     catch (int &e) {
-        print_exceptions(e, count_lines, fname);
+        log_exceptions(*log, e, count_lines, fname);
+        last_error = e;
     }
     infile.close();
     return flag;
@@ -422,6 +546,8 @@ int nsat_core::initialize_params(char *fname, string &type,
  *  7  : Not a valid number of neural input groups.
  ***************************************************************************/
 int nsat_core::initialize_groups() {
+    timer_scope scope(timer, "initialize_groups");
+
     // Check numbers of input and NSAT neural groups
     if (num_in_groups <= 0 &&
         num_nsat_groups <= 0) { throw 7; }
@@ -442,20 +568,37 @@ int nsat_core::initialize_groups() {
                                                 nsatc[i].unit_type);
     
         // Set NSAT parameters to each group
-        sim->setNeuronParametersNSAT(nsatc[i].unit_id,
-                                     nsatc[i].nsat_p.alphaS,
-                                     nsatc[i].nsat_p.alpha,
-                                     nsatc[i].nsat_p.beta,
-                                     nsatc[i].nsat_p.sigma,
-                                     nsatc[i].nsat_p.v_th,
-                                     nsatc[i].nsat_p.v_reset,
-                                     nsatc[i].nsat_p.tau_ref,
-                                     nsatc[i].nsat_p.b); 
+        apply_nsat(i);
     }
     return 0;
 }
 
 
+/***************************************************************************
+ * NSAT_CORE APPLY_NSAT - This method passes the NSAT parameters of a 
+ * group to CARLsim (config state only).
+ *
+ * Args:
+ * -----
+ *  i (int) : NSAT group's index.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void nsat_core::apply_nsat(int i) {
+    sim->setNeuronParametersNSAT(nsatc[i].unit_id,
+                                 nsatc[i].nsat_p.alphaS,
+                                 nsatc[i].nsat_p.alpha,
+                                 nsatc[i].nsat_p.beta,
+                                 nsatc[i].nsat_p.sigma,
+                                 nsatc[i].nsat_p.v_th,
+                                 nsatc[i].nsat_p.v_reset,
+                                 nsatc[i].nsat_p.tau_ref,
+                                 nsatc[i].nsat_p.b); 
+}
+
+
 /***************************************************************************
  * NSAT_CORE GROUP_INDEX - This method takes as arguments a vector of 
  * strings and a key string, searches for the key in the string vector and
@@ -534,10 +677,13 @@ int nsat_core::count_lines(ifstream &file) {
 
 
 /***************************************************************************
- * NSAT_CORE INITIALIZE_CONNEXIONS - This method takes as input two 2D
- * vectors, one for synaptic connections and a second one for delays, 
- * and initializes the synaptic weights and delays according to CARLsim'
- * ConnectionGenerator methods.
+ * NSAT_CORE READ_CONNEXIONS - This method parses all the synaptic 
+ * connections files (one per connection) into projection structs. The 
+ * first line of each file names the source and destination groups, the 
+ * type of the source (input or not) and the blankout probability (and
+ * optionally its standard deviation). The rest of the lines hold the
+ * synaptic weights matrix. CARLsim is not touched here, so the parsed 
+ * projections can be shared (e.g. by batch_core).
  *
  * Args:
  * -----
@@ -545,7 +691,7 @@ int nsat_core::count_lines(ifstream &file) {
  *
  * Returns:
  * --------
- *  0 if all synaptic connections are succesfully initialized, otherwise
+ *  0 if all synaptic connections files are succesfully parsed, otherwise
  *  it throws an exception.
  *
  * Exceptions:
@@ -554,86 +700,79 @@ int nsat_core::count_lines(ifstream &file) {
  *  7  : Not a valid number of neural input groups.
  *  10 : Missing blankout probability.
  ***************************************************************************/
-// FIXIT: Need to be more generic
-int nsat_core::initialize_connexions() {
-    int prob_flag;
+int nsat_core::read_connexions() {
     int idx_src, idx_dest;
-    int row, col;
-    int src_id, dest_id;
-    bool flag(false);
-    float prob(0.0), std(0.0);
     string line;
 
-    connex = new Connx*[sim_p.num_connections];
-    
+    projs.clear();
+    projs.reserve(sim_p.num_connections);
+    mem.remove("weights");
+
     for (int k = 0; k < sim_p.num_connections; ++k) {
-        vector<vector<float>> wt_ij;
+        projection proj;
+        trace_scope scope("connection file", fnames.conn_fname[k]);
         ifstream infile(static_cast<string>(fnames.conn_fname[k]));
         getline(infile, line);
+        timer.add_bytes(line.size() + 1);
         istringstream iss(line);
         vector<string> tokens{istream_iterator<string>{iss},
                               istream_iterator<string>{}};
 
         if ((tokens.size() == 4) || (tokens.size() == 5)) {
+            proj.src_name = tokens[0];
+            proj.dest_name = tokens[1];
+            proj.src_input = (tokens[2] == "true");
+
             // Source: Input group
-            if (tokens[2] == "true") {
+            if (proj.src_input) {
                 // Either check_name for checking for existence of -1 from group_index
                 if (!check_name(inp_names, tokens[0])) { throw 6; }
                 idx_src = group_index(inp_names, tokens[0]);
-                row = inpc[idx_src].num_neurons;
-                src_id = inpc[idx_src].unit_id;
+                proj.num_pre = inpc[idx_src].num_neurons;
             // Source: NSAT group
             } else {
                 if (!check_name(nsat_names, tokens[0])) { throw 6; }
                 idx_src = group_index(nsat_names, tokens[0]);
-                row = nsatc[idx_src].num_neurons;
-                src_id = nsatc[idx_src].unit_id;
+                proj.num_pre = nsatc[idx_src].num_neurons;
             }
             // Destination: NSAT group
             if (!check_name(nsat_names, tokens[1])) { throw 6; }
             idx_dest = group_index(nsat_names, tokens[1]);
-            col = nsatc[idx_dest].num_neurons;
-            dest_id = nsatc[idx_dest].unit_id;
+            proj.num_post = nsatc[idx_dest].num_neurons;
 
             // Blankout probability
-            prob_flag = tokens.size();
-            if (prob_flag == 4) { prob = stof(tokens[3]); }
-            else {
-                prob = stof(tokens[3]);
-                std = stof(tokens[4]);
-            }
-
-            // Assign synaptic strengths
-            for(int i = 0; i < row; ++i) {
+            proj.prob_flag = tokens.size();
+            proj.prob = stof(tokens[3]);
+            proj.std = (proj.prob_flag == 5) ? stof(tokens[4]) : 0.0;
+
+            // Account the weights before they are read
+            string name = proj.src_name + "->" + proj.dest_name;
+            mem.reserve("weights", name,
+                        proj.num_pre * (sizeof(vector<float>) +
+                                        proj.num_post * sizeof(float)));
+
+            // Read synaptic strengths
+            proj.wt.reserve(proj.num_pre);
+            for(int i = 0; i < proj.num_pre; ++i) {
                 getline(infile, line);
+                timer.add_bytes(line.size() + 1);
                 istringstream iss(line);
                 vector <string> tokens = {istream_iterator<string>{iss},
                                           istream_iterator<string>{}};
 
-                if (tokens.size() != col) {
+                if (tokens.size() != proj.num_post) {
                     throw 7;
                 }
                 vector<float> temp;
+                temp.reserve(proj.num_post);
                 for (auto &t: tokens) {
                     temp.push_back(stof(t));
                 }
-                wt_ij.push_back(temp);
+                proj.wt.push_back(move(temp));
             }
 
-            // Allocate space for the new connection
-            connex[k] = new Connx(row, col, flag, sim_p.maxWt);
-            connex[k]->setWeightMatrix(wt_ij);
-
-            // Create the new connection
-            if (prob_flag == 4) {
-                sim->connectNSAT(src_id, dest_id, connex[k],
-                                 BlankOutProb(prob), 
-                                 SYN_PLASTIC);
-            }else{
-                sim->connectNSAT(src_id, dest_id, connex[k],
-                                 BlankOutProb(prob, std),
-                                 SYN_PLASTIC);
-            }
+            projs.push_back(move(proj));
+            mem.set("weights", name, mem_bytes(projs.back().wt));
 
             // Close the file :p
             infile.close();
@@ -644,8 +783,11 @@ int nsat_core::initialize_connexions() {
 
 
 /***************************************************************************
- * NSAT_CORE INITIALIZE_STDP - This method reads STDP parameters and 
- * initializes all the STDP methods on NSAT groups. 
+ * NSAT_CORE INITIALIZE_CONNEXIONS - This method takes the parsed 
+ * projections (see READ_CONNEXIONS) and initializes the synaptic weights
+ * and delays according to CARLsim' ConnectionGenerator methods. If the 
+ * connections files have not been parsed yet (and no shared projections
+ * have been given), it parses them first.
  *
  * Args:
  * -----
@@ -653,89 +795,135 @@ int nsat_core::initialize_connexions() {
  *
  * Returns:
  * --------
- *  (int) 0 if succesfully assigns all the STDP parameters, otherwise it
- *  throws an exception. 
+ *  0 if all synaptic connections are succesfully initialized, otherwise
+ *  it throws an exception.
  *
  * Exceptions:
  * -----------
+ *  6  : Mismatch between group names.
  *  7  : Not a valid number of neural input groups.
+ *  10 : Missing blankout probability.
+ ***************************************************************************/
+// FIXIT: Need to be more generic
+int nsat_core::initialize_connexions() {
+    int src_id, dest_id;
+    short int conn_id;
+    bool flag(false);
+    timer_scope scope(timer, "initialize_connexions");
+
+    if (get_projections().empty()) {
+        timer_scope scope(timer, "read_connexions");
+        read_connexions();
+    }
+    const vector<projection> &conns = get_projections();
+
+    connex = new Connx*[sim_p.num_connections]();
+    conn_ids.clear();
+    conn_grps.clear();
+    mem.remove("connx");
+    int64_t rss0 = memory_core::rss();
+    
+    for (int k = 0; k < sim_p.num_connections; ++k) {
+        const projection &proj = conns[k];
+
+        // Source and destination CARLsim group ids
+        if (proj.src_input) {
+            src_id = inpc[group_index(inp_names, proj.src_name)].unit_id;
+        } else {
+            src_id = nsatc[group_index(nsat_names, proj.src_name)].unit_id;
+        }
+        dest_id = nsatc[group_index(nsat_names, proj.dest_name)].unit_id;
+
+        // Allocate space for the new connection
+        string name = proj.src_name + "->" + proj.dest_name;
+        mem.reserve("connx", name, mem_bytes(proj.wt));
+        connex[k] = new Connx(proj.num_pre, proj.num_post, flag, sim_p.maxWt);
+        connex[k]->setWeightMatrix(proj.wt);
+        mem.set("connx", name, connex[k]->get_bytes());
+        if (timer.is_enabled()) {
+            int64_t num_syn = 0;
+            for (auto &row : proj.wt)
+                for (auto w : row) num_syn += (fabsf(w) > 0.0f);
+            timer.add_synapses(num_syn);
+        }
+
+        // Create the new connection
+        if (proj.prob_flag == 4) {
+            conn_id = sim->connectNSAT(src_id, dest_id, connex[k],
+                                       BlankOutProb(proj.prob), 
+                                       SYN_PLASTIC);
+        }else{
+            conn_id = sim->connectNSAT(src_id, dest_id, connex[k],
+                                       BlankOutProb(proj.prob, proj.std),
+                                       SYN_PLASTIC);
+        }
+        conn_ids.push_back(conn_id);
+        conn_grps.push_back(make_pair(src_id, dest_id));
+    }
+
+    // CARLsim's share of the growth (the rest is accounted above)
+    int64_t grown = memory_core::rss() - rss0 - mem.total("connx");
+    mem.set("carlsim", "connections", max<int64_t>(0, grown));
+    return 0;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE READ_STDP - This method parses the STDP parameters file into
+ * stdp_unit structs (one per line). Comment lines start with #. 
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  (int) 0 if succesfully reads all the STDP parameters, otherwise it
+ *  throws an exception. 
+ *
+ * Exceptions:
+ * -----------
  *  11 : Wrong group/type in STDP parameters file.
  *  12 : Missing parameters in STDP parameters file.
- *  50 : Not a valid STDP curve function.
  ***************************************************************************/
-int nsat_core::initialize_stdp() {
-    int group_id;
+int nsat_core::read_stdp() {
     string line;
+
+    stdpc.clear();
+    if (fnames.stdp_fname == NULL) return 0;    // in-memory construction
     ifstream infile(static_cast<string>(fnames.stdp_fname));
 
     while(getline(infile, line)) {
+        timer.add_bytes(line.size() + 1);
         istringstream iss(line);
         vector<string> tokens{istream_iterator<string>{iss},
                               istream_iterator<string>{}};
 
-        if (tokens[0] == "#") {
+        if (tokens.empty() || tokens[0] == "#") {
             continue;
         }else {
             if (tokens.size() != 14) {
                 throw 12;
             }
-            group_id = group_index(nsat_names, tokens[0]);
-            if (tokens[1] == "E") {
-                switch(stoi(tokens[3])) {
-                    case 0:
-                        sim->setESTDP(nsatc[group_id].unit_id,
-                                      str2bool(tokens[4]),
-                                      str2stdpt(tokens[2]),
-                                      ExpCurve(stof(tokens[5]),
-                                               stof(tokens[6]),
-                                               -stof(tokens[7]),
-                                               stof(tokens[8])));
-                        break;
-                    // Time-based STDP curve
-                    case 1:
-                        sim->setESTDP(nsatc[group_id].unit_id,
-                                      str2bool(tokens[4]),
-                                      str2stdpt(tokens[2]),
-                                      TimingBasedCurve(stof(tokens[5]),
-                                                       stof(tokens[6]),
-                                                       -stof(tokens[7]),
-                                                       stof(tokens[8]),
-                                                       stof(tokens[13])));
-                        break;
-                    // Not valid STDP curve - throws exception
-                    default:
-                        throw 50;
-                        break;
-                }
-            }else if (tokens[1] == "I") {
-                switch(stoi(tokens[3])) {
-                    case 0:
-                        sim->setISTDP(nsatc[group_id].unit_id,
-                                      str2bool(tokens[4]),
-                                      str2stdpt(tokens[2]),
-                                      ExpCurve(-stof(tokens[5]),
-                                               stof(tokens[6]),
-                                               stof(tokens[7]),
-                                               stof(tokens[8])));
-                        break;
-                    // Time-based STDP curve
-                    case 1:
-                        sim->setISTDP(nsatc[group_id].unit_id,
-                                      str2bool(tokens[4]),
-                                      str2stdpt(tokens[2]),
-                                      PulseCurve(stof(tokens[9]),
-                                                 stof(tokens[10]),
-                                                 stof(tokens[11]),
-                                                 stof(tokens[12])));
-                        break;
-                    // Not valid STDP curve - throws exception
-                    default:
-                        throw 50;
-                        break;
-                }
-            }else{
-                throw 11;
-            }
+            if (!check_name(nsat_names, tokens[0])) { throw 11; }
+            if (tokens[1] != "E" && tokens[1] != "I") { throw 11; }
+
+            stdp_unit tmp_unit;
+            tmp_unit.unit_name = tokens[0];
+            tmp_unit.type = tokens[1];
+            tmp_unit.da_mode = tokens[2];
+            tmp_unit.stdp_fun = stoi(tokens[3]);
+            tmp_unit.is_set = str2bool(tokens[4]);
+            tmp_unit.alpha_plus = stof(tokens[5]);
+            tmp_unit.tau_plus = stof(tokens[6]);
+            tmp_unit.alpha_minus = stof(tokens[7]);
+            tmp_unit.tau_minus = stof(tokens[8]);
+            tmp_unit.beta_ltp = stof(tokens[9]);
+            tmp_unit.beta_ltd = stof(tokens[10]);
+            tmp_unit.lambda = stof(tokens[11]);
+            tmp_unit.delta = stof(tokens[12]);
+            tmp_unit.gamma = stof(tokens[13]);
+            stdpc.push_back(tmp_unit);
         }
     }
     infile.close();
@@ -744,227 +932,1145 @@ int nsat_core::initialize_stdp() {
 
 
 /***************************************************************************
- * NSAT_CORE INITIALIZE_INTEGRATION_METHOD - This method sets the numerical 
- * integration method. The user can choose between Forward Euler's method
- * and Runge-Kutta 4. 
- *for auto iterator c++
+ * NSAT_CORE INITIALIZE_STDP - This method initializes all the STDP 
+ * methods on NSAT groups according to the parsed STDP parameters (see 
+ * READ_STDP). If the STDP file has not been parsed yet, it parses it
+ * first.
+ *
  * Args:
  * -----
  *  Void
  *
  * Returns:
  * --------
- *  (int) 0 if succesfully initializes the integration method, otherwise
- *  it throws an exception. 
+ *  (int) 0 if succesfully assigns all the STDP parameters, otherwise it
+ *  throws an exception. 
  *
  * Exceptions:
  * -----------
- *  60 : Not a valid integration method.
- *  70 : Not allowed integration steps size.
+ *  7  : Not a valid number of neural input groups.
+ *  11 : Wrong group/type in STDP parameters file.
+ *  12 : Missing parameters in STDP parameters file.
+ *  50 : Not a valid STDP curve function.
  ***************************************************************************/
-int nsat_core::initialize_integration_method() {
-    if ((sim_p.int_method != FORWARD_EULER) && 
-        (sim_p.int_method != RUNGE_KUTTA4)) throw 60;
-    else if (1 > sim_p.int_num_steps || sim_p.int_num_steps > 100) throw 70;
-    else sim->setIntegrationMethod(sim_p.int_method, sim_p.int_num_steps);
+int nsat_core::initialize_stdp() {
+    timer_scope scope(timer, "initialize_stdp");
+
+    if (stdpc.empty()) {
+        timer_scope scope(timer, "read_stdp");
+        read_stdp();
+    }
+
+    for (auto &p : stdpc) apply_stdp(p);
     return 0;
 }
 
 
 /***************************************************************************
- * NSAT_CORE INITIALIZE_CONDUCTANCES - This method sets the conductances 
- * on or off. It permits for conductance-based or current-based simulations
- * (COBA or CUBA).
+ * NSAT_CORE APPLY_STDP - This method passes one STDP entry (see 
+ * READ_STDP) to CARLsim (config state only).
  *
  * Args:
  * -----
- *  Void
+ *  p (stdp_unit) : STDP parameters of a NSAT group.
  *
  * Returns:
  * --------
- *  (int) 0 if a succesful choice has been made, otherwise it throws an
- *  exception. 
+ *  Void
  *
  * Exceptions:
  * -----------
- *  80 : Not a valid conductance flag (true or false).
+ *  11 : Wrong group/type in STDP parameters file.
+ *  50 : Not a valid STDP curve function.
  ***************************************************************************/
-int nsat_core::initialize_conductances() {
-    // Check if conductances flag is valid (true of false)
-    if (sim_p.coba_enabled != true &&
-        sim_p.coba_enabled != false) { throw 80; }
-    
-    // Enable (true) or disable (false) conductances
-    sim->setConductances(sim_p.coba_enabled);
-    return 0;
+void nsat_core::apply_stdp(const stdp_unit &p) {
+    int group_id = group_index(nsat_names, p.unit_name);
+
+    if (p.type == "E") {
+        switch(p.stdp_fun) {
+            case 0:
+                sim->setESTDP(nsatc[group_id].unit_id,
+                              p.is_set,
+                              str2stdpt(p.da_mode),
+                              ExpCurve(p.alpha_plus,
+                                       p.tau_plus,
+                                       -p.alpha_minus,
+                                       p.tau_minus));
+                break;
+            // Time-based STDP curve
+            case 1:
+                sim->setESTDP(nsatc[group_id].unit_id,
+                              p.is_set,
+                              str2stdpt(p.da_mode),
+                              TimingBasedCurve(p.alpha_plus,
+                                               p.tau_plus,
+                                               -p.alpha_minus,
+                                               p.tau_minus,
+                                               p.gamma));
+                break;
+            // Not valid STDP curve - throws exception
+            default:
+                throw 50;
+                break;
+        }
+    }else if (p.type == "I") {
+        switch(p.stdp_fun) {
+            case 0:
+                sim->setISTDP(nsatc[group_id].unit_id,
+                              p.is_set,
+                              str2stdpt(p.da_mode),
+                              ExpCurve(-p.alpha_plus,
+                                       p.tau_plus,
+                                       p.alpha_minus,
+                                       p.tau_minus));
+                break;
+            // Time-based STDP curve
+            case 1:
+                sim->setISTDP(nsatc[group_id].unit_id,
+                              p.is_set,
+                              str2stdpt(p.da_mode),
+                              PulseCurve(p.beta_ltp,
+                                         p.beta_ltd,
+                                         p.lambda,
+                                         p.delta));
+                break;
+            // Not valid STDP curve - throws exception
+            default:
+                throw 50;
+                break;
+        }
+    }else{
+        throw 11;
+    }
 }
 
 
 /***************************************************************************
- * SAT_CORE Class C_CONFIG_STATE - This method implements CARLsim's 
- * Config State. Here the initialization of the whole neural network 
- * takes place. 
+ * NSAT_CORE OVERRIDE_NSAT - This method overrides a NSAT parameter of a
+ * group (e.g. for parameter sweeps). It has to be called before 
+ * C_CONFIG_STATE.
  *
  * Args:
  * -----
- *  Void
+ *  group (string) : NSAT group's name.
+ *  param (string) : Parameter's name (alpha, beta, sigma, v_th, v_reset,
+ *                   alphaS, b, tau_ref).
+ *  value (float)  : New value.
  *
  * Returns:
  * --------
- *  flag (int), which is normally 0, if successfully initializes the 
- *  network, otherwise it throws an exception. 
+ *  Void
  *
  * Exceptions:
  * -----------
- *  See auxiliary.cpp for more about exceptions. 
+ *  6  : Mismatch between group names.
+ *  17 : Not a valid parameter name.
  ***************************************************************************/
-int nsat_core::c_config_state() {
-    int flag;
-
-    // Try to initialize everything
-    try {
-        flag = initialize_groups();             
-        flag = initialize_connexions();                
-        flag = initialize_stdp();               
-        flag = initialize_conductances();
-        flag = initialize_integration_method(); 
-    }
-    // Catch possible exceptions - see auxiliary.cpp
-    catch (int &e) {
-        print_exceptions(e);
-    }
-
-    return flag;
+void nsat_core::override_nsat(const string &group,
+                              const string &param,
+                              float value) {
+    if (!check_name(nsat_names, group)) { throw 6; }
+    set_nsat_param(nsatc[group_index(nsat_names, group)].nsat_p, param, value);
 }
 
 
 /***************************************************************************
- * NSAT_CORE POISSON_SPIKES - This method initializes Poisson spike 
- * generators as inputs. Each input group can be associated with one 
- * Poisson spike generator.
+ * NSAT_CORE OVERRIDE_STDP - This method overrides a STDP parameter of a
+ * group (all its STDP entries). It has to be called before 
+ * C_CONFIG_STATE.
  *
  * Args:
  * -----
- *  Void
+ *  group (string) : NSAT group's name.
+ *  param (string) : Parameter's name (alphaPlus, tauPlus, alphaMinus,
+ *                   tauMinus, betaLTP, betaLTD, lambda, delta, gamma).
+ *  value (float)  : New value.
  *
  * Returns:
  * --------
- *  0 (int) if successfully creates Poisson spike generators. Otherwise
- *  it throws an exception. 
+ *  Void
  *
  * Exceptions:
  * -----------
- *  7  : Not a valid number of neural input groups.
+ *  6  : Mismatch between group names.
+ *  17 : Not a valid parameter name.
  ***************************************************************************/
-int nsat_core::poisson_spikes() {
-    // Check if the number of input groups is valid
-    if (num_in_groups <= 0) { throw 7; }
-
-    psn_spkg = new PoissonRate*[num_in_groups];
-
-    // Construct PoissonRate objects
-    for (int i = 0; i < num_in_groups; ++i)
-        psn_spkg[i] = new PoissonRate(inpc[i].num_neurons,
-                                      inpc[i].spkg_p.on_gpu);
-
-    // Assign PoissonRates to input neural groups
-    for (int i = 0; i < num_in_groups; ++i) {
-        psn_spkg[i]->setRates(inpc[i].spkg_p.rate);
-        sim->setSpikeRate(inpc[i].unit_id, psn_spkg[i]);
+void nsat_core::override_stdp(const string &group,
+                              const string &param,
+                              float value) {
+    bool found = false;
+
+    if (stdpc.empty()) { read_stdp(); }
+    for (auto &p : stdpc) {
+        if (p.unit_name != group) continue;
+        found = true;
+
+        if (param == "alphaPlus") p.alpha_plus = value;
+        else if (param == "tauPlus") p.tau_plus = value;
+        else if (param == "alphaMinus") p.alpha_minus = value;
+        else if (param == "tauMinus") p.tau_minus = value;
+        else if (param == "betaLTP") p.beta_ltp = value;
+        else if (param == "betaLTD") p.beta_ltd = value;
+        else if (param == "lambda") p.lambda = value;
+        else if (param == "delta") p.delta = value;
+        else if (param == "gamma") p.gamma = value;
+        else throw 17;
     }
-    return 0;
+    if (!found) { throw 6; }
 }
 
 
 /***************************************************************************
- * NSAT_CORE PERIODICAL_SPIKES - This method builds periocic spike 
- * generators. Each input group can be associated with one periodic
- * spike generator.
+ * NSAT_CORE UPDATE_NSAT - This method changes a NSAT parameter of a group
+ * on a created or configured network. On a configured network the new
+ * parameters are passed straight to CARLsim (no need to configure again).
+ * CARLsim fixes the neurons parameters at the setup state, so a set up
+ * network cannot be updated (batch_core networks can).
  *
  * Args:
  * -----
- *  Void
+ *  group (string) : NSAT group's name.
+ *  param (string) : Parameter's name (see OVERRIDE_NSAT).
+ *  value (float)  : New value.
  *
  * Returns:
  * --------
- *  0 (int) if successfully creates periodic spike generators. Otherwise
- *  it throws an exception. 
+ *  Void
  *
  * Exceptions:
  * -----------
- *  7  : Not a valid number of neural input groups.
+ *  6  : Mismatch between group names.
+ *  17 : Not a valid parameter name.
+ *  25 : Not allowed in the current simulation state.
  ***************************************************************************/
-int nsat_core::periodical_spikes() {
-    // Check if the number of input groups is valid
-    if (num_in_groups <= 0) { throw 7; }
-
-    prd_spkg = new PeriodicSpikeGenerator*[num_in_groups];
-
-    // Construct PeriodicSpikeGenerator objects
-    for (int i = 0; i < num_in_groups; ++i)
-        prd_spkg[i] = new PeriodicSpikeGenerator(inpc[i].spkg_p.freq,
-                                                 inpc[i].spkg_p.spk_at_zero);
+void nsat_core::update_nsat(const string &group,
+                            const string &param,
+                            float value) {
+    if (carl_state == 2) { throw 25; }
 
-    // Assign PeriodicSpikeGenerators to input neural groups
-    for (int i = 0; i < num_in_groups; ++i)
-        sim->setSpikeGenerator(inpc[i].unit_id, prd_spkg[i]);
-    return 0;
+    override_nsat(group, param, value);
+    if (carl_state == 1) apply_nsat(group_index(nsat_names, group));
 }
 
 
 /***************************************************************************
- * NSAT_CORE VECTORIAL_SPIKES - This method builds spike generators from a
- * input 2D vector. Each input group can be associated with a 1D vector of
- * spike trains.
+ * NSAT_CORE UPDATE_STDP - This method changes a STDP parameter of a group
+ * on a created or configured network (see UPDATE_NSAT).
  *
  * Args:
  * -----
- *  Void
+ *  group (string) : NSAT group's name.
+ *  param (string) : Parameter's name (see OVERRIDE_STDP).
+ *  value (float)  : New value.
  *
  * Returns:
  * --------
- *  0 (int) if successfully builds spike generators. Otherwise it throws
- *  an exception. 
+ *  Void
  *
  * Exceptions:
  * -----------
- *  7  : Not a valid number of neural input groups.
+ *  6  : Mismatch between group names.
+ *  17 : Not a valid parameter name.
+ *  25 : Not allowed in the current simulation state.
+ *  50 : Not a valid STDP curve function.
  ***************************************************************************/
-int nsat_core::vectorial_spikes() {
-    // Check if the number of input groups is valid
-    if (num_in_groups <= 0) { throw 7; }
-
-    vec_spkg = new SpikeGeneratorFromVector*[num_in_groups];
-
-    // Construct SpikeGeneratorFromVector objects
-    for (int i = 0; i < num_in_groups; ++i)
-        vec_spkg[i] = new SpikeGeneratorFromVector(spike_trains[i]);
-
-    // Assign SpikeGeneratorFromVector to input neural groups
-    for (int i = 0; i < num_in_groups; ++i)
-        sim->setSpikeGenerator(inpc[i].unit_id, vec_spkg[i]);
-    return 0;
+void nsat_core::update_stdp(const string &group,
+                            const string &param,
+                            float value) {
+    if (carl_state == 2) { throw 25; }
+
+    override_stdp(group, param, value);
+    if (carl_state == 1) {
+        for (auto &p : stdpc)
+            if (p.unit_name == group) apply_stdp(p);
+    }
 }
 
 
-/* FIXME : Put some comments here :p */
-int nsat_core::file_spikes() {
-    string str;
-    // Check if the number of input groups is valid
-    if (num_in_groups <= 0) { throw 7; }
-
-    file_spkg = new SpikeGeneratorFromFile*[num_in_groups];
-
-    // For each input group set its spike gen
-    for (int i = 0; i < num_in_groups; ++i) {
-        str = static_cast<string>(fnames.finp_spikes[i]);
-        file_spkg[i] = new SpikeGeneratorFromFile(str);
+/***************************************************************************
+ * NSAT_CORE SET_WEIGHTS - This method replaces the synaptic weights of a
+ * connection from a dense [pre][post] (row-major) buffer. On a set up 
+ * network the weights of the existing synapses are changed in place 
+ * (CARLsim's setWeight) and the rest of the buffer is ignored. Before 
+ * the setup state the weight matrix of the connection is replaced.
+ *
+ * Args:
+ * -----
+ *  conn (int)          : Connection's index (order of the connections 
+ *                        files).
+ *  wt (vector<float>)  : New weights, num_pre * num_post values.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  24 : Mismatch between input size and number of neurons.
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+void nsat_core::set_weights(int conn, const vector<float> &wt) {
+    if (carl_state == 0 && get_projections().empty()) { read_connexions(); }
+    if (conn < 0 || conn >= get_projections().size()) { throw 6; }
+
+    int num_pre = get_projections()[conn].num_pre;
+    int num_post = get_projections()[conn].num_post;
+    if (wt.size() != num_pre * num_post) { throw 24; }
+    if (carl_state != 0 && connex == NULL) { throw 25; }    // cleaned up
+
+    // The synapses are those of the nonzero weights the connection was
+    // built from (see Connx::connect)
+    if (carl_state == 2) {
+        const vector<vector<float>> &syn = connex[conn]->get_weight_matrix();
+        for (int i = 0; i < num_pre; ++i)
+            for (int j = 0; j < num_post; ++j)
+                if (fabsf(syn[i][j]) > 0.0f)
+                    sim->setWeight(conn_ids[conn], i, j, wt[i*num_post+j],
+                                   true);
+        return;
     }
 
-    for(int i = 0; i < num_in_groups; ++i) {
-        sim->setSpikeGenerator(inpc[i].unit_id, file_spkg[i]);
+    vector<vector<float>> dense(num_pre);
+    for (int i = 0; i < num_pre; ++i)
+        dense[i].assign(wt.begin() + i * num_post,
+                        wt.begin() + (i + 1) * num_post);
+
+    if (carl_state == 1) {
+        connex[conn]->setWeightMatrix(dense);
+    } else {
+        // Shared projections are read-only
+        if (shared_projs != NULL) { throw 25; }
+        projs[conn].wt = dense;
+    }
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SET_PROJECTIONS - This method makes the core use projections
+ * that have been parsed elsewhere instead of parsing its own connections 
+ * files. The projections are only read, never copied or modified, so 
+ * they can be shared (e.g. copy-on-write pages of forked workers).
+ *
+ * Args:
+ * -----
+ *  p (vector<projection> *) : Shared projections (NULL to use the own 
+ *                             ones).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void nsat_core::set_projections(const vector<projection> *p) {
+    shared_projs = p;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE ADD_INPUT_GROUP - This method declares an input (spike
+ * generator) group of an in-memory network, like a line of the SPKG
+ * parameters file (created state only, before the first config state).
+ *
+ * Args:
+ * -----
+ *  name (string)     : Unique group's name.
+ *  num_neurons (int) : Number of neurons.
+ *  type (string)     : Neuron type (e.g. EXCITATORY_NEURON).
+ *  p (spkg)          : Spike generator parameters.
+ *  mflag (bool)      : True to monitor the group.
+ *
+ * Returns:
+ * --------
+ *  Index of the group (int).
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state.
+ *  29 : Not a valid group (name, size or neuron type).
+ ***************************************************************************/
+int nsat_core::add_input_group(const string &name,
+                               int num_neurons,
+                               const string &type,
+                               const spkg &p,
+                               bool mflag) {
+    input_unit unit;
+
+    if (carl_state != 0 || grid_nsat_layers != NULL) { throw 25; }
+    if (name.empty() || num_neurons <= 0 || check_name(inp_names, name) ||
+        check_name(nsat_names, name)) { throw 29; }
+
+    unit.unit_name = name;
+    unit.num_neurons = num_neurons;
+    unit.unit_type = str2nrtype(type);
+    if (unit.unit_type == 135) { throw 29; }
+    unit.spkg_p = p;
+    unit.mflag = mflag;
+
+    inp_names.push_back(name);
+    inpc.push_back(unit);
+    return num_in_groups++;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE ADD_NSAT_GROUP - This method declares a NSAT group of an
+ * in-memory network, like a line of the NSAT parameters file (created
+ * state only, before the first config state).
+ *
+ * Args:
+ * -----
+ *  name (string)     : Unique group's name.
+ *  num_neurons (int) : Number of neurons.
+ *  type (string)     : Neuron type (e.g. EXCITATORY_NEURON).
+ *  p (nsat)          : NSAT parameters.
+ *  mflag (bool)      : True to monitor the group.
+ *
+ * Returns:
+ * --------
+ *  Index of the group (int).
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state.
+ *  29 : Not a valid group (name, size or neuron type).
+ ***************************************************************************/
+int nsat_core::add_nsat_group(const string &name,
+                              int num_neurons,
+                              const string &type,
+                              const nsat &p,
+                              bool mflag) {
+    nsat_unit unit;
+
+    if (carl_state != 0 || grid_nsat_layers != NULL) { throw 25; }
+    if (name.empty() || num_neurons <= 0 || check_name(inp_names, name) ||
+        check_name(nsat_names, name)) { throw 29; }
+
+    unit.unit_name = name;
+    unit.num_neurons = num_neurons;
+    unit.unit_type = str2nrtype(type);
+    if (unit.unit_type == 135) { throw 29; }
+    unit.nsat_p = p;
+    unit.mflag = mflag;
+
+    nsat_names.push_back(name);
+    nsatc.push_back(unit);
+    return num_nsat_groups++;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE CHECK_PROJECTION - This method validates a connection of an
+ * in-memory network: its groups and the size of its weights matrix.
+ *
+ * Args:
+ * -----
+ *  src (string)   : Source group's name (input or NSAT).
+ *  dest (string)  : Destination NSAT group's name.
+ *  num_pre (int)  : Rows of the weights matrix (source's size).
+ *  num_post (int) : Columns of the weights matrix (destination's size).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  24 : Mismatch between input size and number of neurons.
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+void nsat_core::check_projection(const string &src,
+                                 const string &dest,
+                                 int num_pre,
+                                 int num_post) {
+    int pre;
+
+    if (carl_state != 0 || shared_projs != NULL) { throw 25; }
+
+    if (check_name(inp_names, src)) {
+        pre = inpc[group_index(inp_names, src)].num_neurons;
+    } else if (check_name(nsat_names, src)) {
+        pre = nsatc[group_index(nsat_names, src)].num_neurons;
+    } else { throw 6; }
+    if (!check_name(nsat_names, dest)) { throw 6; }
+    if (num_pre != pre ||
+        num_post != nsatc[group_index(nsat_names, dest)].num_neurons) {
+        throw 24;
+    }
+}
+
+
+/***************************************************************************
+ * NSAT_CORE NEW_PROJECTION - This method validates a connection of an
+ * in-memory network and appends it to the projections with all its
+ * weights zero (see ADD_PROJECTION).
+ *
+ * Args:
+ * -----
+ *  src (string)   : Source group's name (input or NSAT).
+ *  dest (string)  : Destination NSAT group's name.
+ *  num_pre (int)  : Rows of the weights matrix (source's size).
+ *  num_post (int) : Columns of the weights matrix (destination's size).
+ *  prob (float)   : Blankout probability.
+ *  std (float)    : Its standard deviation (0: none).
+ *
+ * Returns:
+ * --------
+ *  The new projection (projection &).
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  24 : Mismatch between input size and number of neurons.
+ *  25 : Not allowed in the current simulation state.
+ *  28 : Memory budget exceeded.
+ ***************************************************************************/
+projection &nsat_core::new_projection(const string &src,
+                                      const string &dest,
+                                      int num_pre,
+                                      int num_post,
+                                      float prob,
+                                      float std) {
+    projection proj;
+
+    check_projection(src, dest, num_pre, num_post);
+    proj.src_input = check_name(inp_names, src);
+    proj.num_pre = num_pre;
+    proj.num_post = num_post;
+    proj.src_name = src;
+    proj.dest_name = dest;
+    proj.prob_flag = (std > 0.0) ? 5 : 4;
+    proj.prob = prob;
+    proj.std = (std > 0.0) ? std : 0.0;
+
+    mem.reserve("weights", src + "->" + dest,
+                num_pre * (sizeof(vector<float>) + num_post * sizeof(float)));
+    proj.wt.assign(num_pre, vector<float>(num_post, 0.0));
+    projs.push_back(move(proj));
+    sim_p.num_connections = projs.size();
+    return projs.back();
+}
+
+
+/***************************************************************************
+ * NSAT_CORE ADD_PROJECTION - This method adds a connection of an
+ * in-memory network from a dense weights matrix, like a connection file
+ * (created state only, the groups declared first).
+ *
+ * Args:
+ * -----
+ *  src (string)      : Source group's name (input or NSAT).
+ *  dest (string)     : Destination NSAT group's name.
+ *  wt (const float *) : Weights, row-major [pre][post] (0: no synapse).
+ *  num_pre (int)     : Rows (source's size).
+ *  num_post (int)    : Columns (destination's size).
+ *  prob (float)      : Blankout probability.
+ *  std (float)       : Its standard deviation (0: none).
+ *
+ * Returns:
+ * --------
+ *  Index of the connection (int).
+ *
+ * Exceptions:
+ * -----------
+ *  See NEW_PROJECTION.
+ ***************************************************************************/
+int nsat_core::add_projection(const string &src,
+                              const string &dest,
+                              const float *wt,
+                              int num_pre,
+                              int num_post,
+                              float prob,
+                              float std) {
+    projection &proj = new_projection(src, dest, num_pre, num_post, prob,
+                                      std);
+
+    for (int i = 0; i < num_pre; ++i)
+        copy(wt + i * num_post, wt + (i + 1) * num_post, proj.wt[i].begin());
+    return projs.size() - 1;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE ADD_PROJECTION_CSR - This method adds a connection of an
+ * in-memory network from a CSR weights matrix: the synapses of the
+ * presynaptic neuron i are indices/data[indptr[i] ... indptr[i+1]-1]
+ * (as scipy.sparse.csr_matrix). The connection keeps the dense matrix
+ * of the connection files.
+ *
+ * Args:
+ * -----
+ *  src (string)       : Source group's name (input or NSAT).
+ *  dest (string)      : Destination NSAT group's name.
+ *  indptr (const int *)  : Row pointers (num_pre + 1).
+ *  indices (const int *) : Postsynaptic neurons.
+ *  data (const float *)  : Weights.
+ *  num_pre (int)      : Rows (source's size).
+ *  num_post (int)     : Columns (destination's size).
+ *  prob (float)       : Blankout probability.
+ *  std (float)        : Its standard deviation (0: none).
+ *
+ * Returns:
+ * --------
+ *  Index of the connection (int).
+ *
+ * Exceptions:
+ * -----------
+ *  24 : Not a valid CSR (indptr not starting at 0 or decreasing, or a
+ *       postsynaptic index out of range).
+ *  See CHECK_PROJECTION and NEW_PROJECTION.
+ ***************************************************************************/
+int nsat_core::add_projection_csr(const string &src,
+                                  const string &dest,
+                                  const int *indptr,
+                                  const int *indices,
+                                  const float *data,
+                                  int num_pre,
+                                  int num_post,
+                                  float prob,
+                                  float std) {
+    // The sizes first: indptr has num_pre + 1 entries
+    check_projection(src, dest, num_pre, num_post);
+    if (indptr[0] != 0) { throw 24; }
+    for (int i = 0; i < num_pre; ++i)
+        if (indptr[i+1] < indptr[i]) { throw 24; }
+    for (int k = 0; k < indptr[num_pre]; ++k)
+        if (indices[k] < 0 || indices[k] >= num_post) { throw 24; }
+
+    projection &proj = new_projection(src, dest, num_pre, num_post, prob,
+                                      std);
+    for (int i = 0; i < num_pre; ++i)
+        for (int k = indptr[i]; k < indptr[i+1]; ++k)
+            proj.wt[i][indices[k]] = data[k];
+    return projs.size() - 1;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SET_RESULTS_DIR - This method sets the directory where the 
+ * spike monitors write their files (dir/spk<group name>.dat). If it is
+ * not set, CARLsim's "DEFAULT" names are used. Before the config state
+ * the CARLsim log is moved there too (dir/carlsim.log).
+ *
+ * Args:
+ * -----
+ *  dir (string) : Results directory.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void nsat_core::set_results_dir(const string &dir) {
+    results_dir = dir;
+    make_dirs(dir);
+    if (sim != NULL && carl_state == 0)
+        sim->setLogFile(dir + "/carlsim.log");
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SET_LOG_FILE - This method writes the messages of the
+ * instance (errors, phase timings and memory summaries) to a file instead
+ * of the standard output, so concurrent instances do not interleave.
+ *
+ * Args:
+ * -----
+ *  fname (string) : Log file (truncated).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write results file.
+ ***************************************************************************/
+void nsat_core::set_log_file(const string &fname) {
+    if (log_file.is_open()) log_file.close();
+    log = &cout;
+    mem.set_output(cout);
+    log_file.open(fname.c_str(), ofstream::out | ofstream::trunc);
+    if (!log_file) { throw 15; }
+    log = &log_file;
+    mem.set_output(log_file);
+}
+
+
+/***************************************************************************
+ * NSAT_CORE ERROR - This method reports an exception of the instance: it
+ * is written to the instance's log (see auxiliary.cpp) and kept as its
+ * last error.
+ *
+ * Args:
+ * -----
+ *  e (int) : Exception's code.
+ *
+ * Returns:
+ * --------
+ *  The code (int), so the callers can return it.
+ ***************************************************************************/
+int nsat_core::error(int e) {
+    last_error = e;
+    log_exceptions(*log, e);
+    *log << flush;
+    return e;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE INITIALIZE_INTEGRATION_METHOD - This method sets the numerical 
+ * integration method. The user can choose between Forward Euler's method
+ * and Runge-Kutta 4. 
+ *for auto iterator c++
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  (int) 0 if succesfully initializes the integration method, otherwise
+ *  it throws an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  60 : Not a valid integration method.
+ *  70 : Not allowed integration steps size.
+ ***************************************************************************/
+int nsat_core::initialize_integration_method() {
+    if ((sim_p.int_method != FORWARD_EULER) && 
+        (sim_p.int_method != RUNGE_KUTTA4)) throw 60;
+    else if (1 > sim_p.int_num_steps || sim_p.int_num_steps > 100) throw 70;
+    else sim->setIntegrationMethod(sim_p.int_method, sim_p.int_num_steps);
+    return 0;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE INITIALIZE_CONDUCTANCES - This method sets the conductances 
+ * on or off. It permits for conductance-based or current-based simulations
+ * (COBA or CUBA).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  (int) 0 if a succesful choice has been made, otherwise it throws an
+ *  exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  80 : Not a valid conductance flag (true or false).
+ ***************************************************************************/
+int nsat_core::initialize_conductances() {
+    // Check if conductances flag is valid (true of false)
+    if (sim_p.coba_enabled != true &&
+        sim_p.coba_enabled != false) { throw 80; }
+    
+    // Enable (true) or disable (false) conductances
+    sim->setConductances(sim_p.coba_enabled);
+    return 0;
+}
+
+
+/***************************************************************************
+ * SAT_CORE Class C_CONFIG_STATE - This method implements CARLsim's 
+ * Config State. Here the initialization of the whole neural network 
+ * takes place. 
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  flag (int), which is normally 0, if successfully initializes the 
+ *  network, otherwise it throws an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  See auxiliary.cpp for more about exceptions. They are printed and
+ *  only 28 (memory budget exceeded) is thrown again.
+ ***************************************************************************/
+int nsat_core::c_config_state() {
+    int flag;
+    timer_scope scope(timer, "config");
+
+    // Try to initialize everything
+    try {
+        // Outputs of the instance (and its CARLsim log)
+        if (!results_dir.empty()) set_results_dir(results_dir);
+
+        // In-memory construction: the layers of the declared groups
+        if (grid_nsat_layers == NULL) {
+            flag = initialize_layers();
+            count_lies_truths();
+        }
+        flag = initialize_groups();             
+        flag = initialize_connexions();                
+        flag = initialize_stdp();               
+        flag = initialize_conductances();
+        flag = initialize_integration_method(); 
+        carl_state = 1;
+        mem.check("config");
+    }
+    // Catch possible exceptions - see auxiliary.cpp
+    catch (int &e) {
+        flag = error(e);
+        if (e == 28) throw;     // out of memory budget: stop here
+    }
+
+    return flag;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE POISSON_SPIKES - This method initializes Poisson spike 
+ * generators as inputs. Each input group can be associated with one 
+ * Poisson spike generator.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 (int) if successfully creates Poisson spike generators. Otherwise
+ *  it throws an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural input groups.
+ ***************************************************************************/
+int nsat_core::poisson_spikes() {
+    // Check if the number of input groups is valid
+    if (num_in_groups <= 0) { throw 7; }
+
+    psn_spkg = new PoissonRate*[num_in_groups];
+
+    // Construct PoissonRate objects
+    for (int i = 0; i < num_in_groups; ++i)
+        psn_spkg[i] = new PoissonRate(inpc[i].num_neurons,
+                                      inpc[i].spkg_p.on_gpu);
+
+    // Assign PoissonRates to input neural groups
+    for (int i = 0; i < num_in_groups; ++i) {
+        psn_spkg[i]->setRates(inpc[i].spkg_p.rate);
+        sim->setSpikeRate(inpc[i].unit_id, psn_spkg[i]);
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE CALENDAR_SPIKES - This method builds the spike source that
+ * serves all the generator-based input groups (pre-generated Poisson, 
+ * periodical, vectorial and file inputs): a single ScheduleSpkg 
+ * (calendar queue) assigned to every input group. Before each run the 
+ * spikes of all the groups are merged into one time-sorted schedule 
+ * (see BUILD_CALENDAR), so CARLsim polls one object that only stores 
+ * the spikes that are due.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 (int) if successfully builds the spike source. Otherwise it throws
+ *  an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural input groups.
+ ***************************************************************************/
+int nsat_core::calendar_spikes() {
+    int offset = 0;
+
+    // Check if the number of input groups is valid
+    if (num_in_groups <= 0) { throw 7; }
+
+    calendar = new ScheduleSpkg();
+    inp_start.clear();
+
+    // Assign the calendar to all the input groups
+    for (int i = 0; i < num_in_groups; ++i) {
+        inp_start.push_back(offset);
+        calendar->addGroup(inpc[i].unit_id, offset);
+        sim->setSpikeGenerator(inpc[i].unit_id, calendar);
+        offset += inpc[i].num_neurons;
+    }
+    inp_start.push_back(offset);
+    return 0;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE BUILD_CALENDAR - This method merges the spikes of all the 
+ * input groups for the next run, which starts at t0 (ms), into the 
+ * calendar. Pre-generated Poisson trains are keyed by (random seed, 
+ * group, neuron, t0) (see rng_core.h).
+ *
+ * Args:
+ * -----
+ *  t0 (int) : First step (ms) of the next run.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void nsat_core::build_calendar(int t0) {
+    spike_schedule sched;
+    int steps = sim_p.sim_time_sec * 1000 + sim_p.sim_time_msec;
+    string tmp = static_cast<string>(sim_p.input_type);
+    transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+
+    sched.reset(t0, steps);
+    for (int i = 0; i < num_in_groups; ++i) {
+        int num = inpc[i].num_neurons;
+
+        if (tmp == "poisson_schedule")
+            sched.add_poisson(input_rates[i], inp_start[i], 1, 0,
+                              RNG_STREAM(RNG_SCHEDULE, i),
+                              carl_p.random_seed);
+        else if (tmp == "periodical")
+            sched.add_periodic(num, inpc[i].spkg_p.freq,
+                               inpc[i].spkg_p.spk_at_zero,
+                               inp_start[i], 1, 0);
+        else if (tmp == "vectorial")
+            sched.add_train(spike_trains[i], num, train_offsets[i],
+                            inp_start[i], 1, 0);
+        else if (tmp == "fromfile")
+            sched.add_events(file_times[i], file_nids[i], num,
+                             inp_start[i], 1, 0);
+    }
+    sched.finalize();
+    mem.reserve("inputs", "calendar",
+                (sched.size() + inp_start[num_in_groups] + 1) * sizeof(int));
+    calendar->setSchedule(sched, inp_start[num_in_groups]);
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SCHEDULED_SPIKES - This method sets up pre-generated Poisson
+ * inputs (poisson_schedule input type). Instead of drawing a Bernoulli 
+ * sample per neuron and step, the spike trains of a whole run are 
+ * generated in bulk before the run (see BUILD_CALENDAR). Rates are 
+ * static within a run.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 (int) if successfully creates the spike generators. Otherwise it 
+ *  throws an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural input groups.
+ ***************************************************************************/
+int nsat_core::scheduled_spikes() {
+    input_rates.clear();
+    for (int i = 0; i < num_in_groups; ++i)
+        input_rates.push_back(vector<float>(inpc[i].num_neurons,
+                                            inpc[i].spkg_p.rate));
+    mem.set("inputs", "rates", mem_bytes(input_rates));
+    return calendar_spikes();
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SET_INPUT_RATE - This method changes the rate of a Poisson 
+ * input group. It can be called once the network has been set up (Poisson
+ * input type), e.g. between runs or in a forked trial. Pre-generated
+ * Poisson inputs use the new rate from the next run on.
+ *
+ * Args:
+ * -----
+ *  grp (int)    : Index of the input group (order of the SPKG file).
+ *  rate (float) : New rate (Hz) of all the group's neurons.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  8  : Not a valid input type.
+ ***************************************************************************/
+void nsat_core::set_input_rate(int grp, float rate) {
+    string tmp = static_cast<string>(sim_p.input_type);
+    transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+
+    if (tmp != "poisson" && tmp != "poisson_schedule") { throw 8; }
+    if (grp < 0 || grp >= num_in_groups) { throw 6; }
+
+    inpc[grp].spkg_p.rate = rate;
+    if (tmp == "poisson_schedule") {
+        input_rates[grp].assign(inpc[grp].num_neurons, rate);
+        return;
+    }
+    psn_spkg[grp]->setRates(rate);
+    sim->setSpikeRate(inpc[grp].unit_id, psn_spkg[grp]);
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SET_INPUT_RATES - This method sets one rate per neuron of a
+ * Poisson input group once the network has been set up. 
+ *
+ * Args:
+ * -----
+ *  grp (int)            : Input group's index.
+ *  rates (vector<float>) : New rates (Hz), one per neuron of the group.
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  8  : Not a valid input type.
+ *  24 : Mismatch between input size and number of neurons.
+ ***************************************************************************/
+void nsat_core::set_input_rates(int grp, const vector<float> &rates) {
+    string tmp = static_cast<string>(sim_p.input_type);
+    transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+
+    if (tmp != "poisson" && tmp != "poisson_schedule") { throw 8; }
+    if (grp < 0 || grp >= num_in_groups) { throw 6; }
+    if (rates.size() != inpc[grp].num_neurons) { throw 24; }
+
+    if (tmp == "poisson_schedule") {
+        input_rates[grp] = rates;
+        return;
     }
-    return 0;
+    psn_spkg[grp]->setRates(rates);
+    sim->setSpikeRate(inpc[grp].unit_id, psn_spkg[grp]);
+}
+
+
+/***************************************************************************
+ * NSAT_CORE SET_INPUT_VECTOR - This method swaps the spike train of a 
+ * vectorial input group once the network has been set up. The new spike
+ * times are counted from the current simulation time, so the same train
+ * can be replayed in every trial.
+ *
+ * Args:
+ * -----
+ *  grp (int)            : Input group's index.
+ *  times (vector<int>)  : New spike times (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  6  : Mismatch between group names.
+ *  8  : Not a valid input type.
+ ***************************************************************************/
+void nsat_core::set_input_vector(int grp, const vector<int> &times) {
+    string tmp = static_cast<string>(sim_p.input_type);
+    transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+
+    if (tmp != "vectorial") { throw 8; }
+    if (grp < 0 || grp >= num_in_groups) { throw 6; }
+
+    spike_trains[grp] = times;
+    train_offsets[grp] = sim->getSimTime();
+    mem.set("inputs", "spike trains", mem_bytes(spike_trains));
+}
+
+
+/***************************************************************************
+ * NSAT_CORE PERIODICAL_SPIKES - This method sets up periodic inputs: all
+ * the neurons of an input group spike every 1000/freq ms. The spikes are
+ * served by the calendar (see CALENDAR_SPIKES).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 (int) if successfully sets up the periodic inputs. Otherwise it 
+ *  throws an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural input groups.
+ ***************************************************************************/
+int nsat_core::periodical_spikes() {
+    return calendar_spikes();
+}
+
+
+/***************************************************************************
+ * NSAT_CORE VECTORIAL_SPIKES - This method sets up inputs from a input 2D
+ * vector. Each input group can be associated with a 1D vector of spike
+ * times. The spikes are served by the calendar (see CALENDAR_SPIKES).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 (int) if successfully sets up the vectorial inputs. Otherwise it 
+ *  throws an exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural input groups.
+ *  16 : Missing spike trains for input groups.
+ ***************************************************************************/
+int nsat_core::vectorial_spikes() {
+    if (spike_trains.size() < num_in_groups) { throw 16; }
+
+    train_offsets.assign(num_in_groups, 0);
+    return calendar_spikes();
+}
+
+
+/***************************************************************************
+ * NSAT_CORE FILE_SPIKES - This method sets up inputs from binary CARLsim
+ * spike files (one per input group, see filenames::finp_spikes). The 
+ * files are read once and their spikes are served by the calendar (see
+ * CALENDAR_SPIKES).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 (int) if successfully reads the spike files. Otherwise it throws an
+ *  exception. 
+ *
+ * Exceptions:
+ * -----------
+ *  7  : Not a valid number of neural input groups.
+ *  26 : Cannot read an input spike file.
+ ***************************************************************************/
+int nsat_core::file_spikes() {
+    // Check if the number of input groups is valid
+    if (num_in_groups <= 0) { throw 7; }
+    if (fnames.finp_spikes == NULL) { throw 26; }
+
+    file_times.assign(num_in_groups, vector<int>());
+    file_nids.assign(num_in_groups, vector<int>());
+    for (int i = 0; i < num_in_groups; ++i)
+        read_spike_file(static_cast<string>(fnames.finp_spikes[i]),
+                        file_times[i], file_nids[i]);
+    mem.set("inputs", "spike files",
+            mem_bytes(file_times) + mem_bytes(file_nids));
+    return calendar_spikes();
 }
 
 
@@ -996,6 +2102,7 @@ void nsat_core::initialize_custom_input(void *ptr,
         }
         spike_trains.push_back(temp);
     }
+    mem.set("inputs", "spike trains", mem_bytes(spike_trains));
 }
 
 
@@ -1021,33 +2128,282 @@ int nsat_core::c_setup_state() {
     string tmp = static_cast<string>(sim_p.input_type);
     // Convert all characters to lowercase  !!
     transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+    timer_scope scope(timer, "setup");
+    auto setup_network = [&]() {
+        timer_scope scope(timer, "setupNetwork");
+        int64_t rss0 = memory_core::rss();
+        sim->setupNetwork(sim_p.remove_tmp_mem);
+        mem.set("carlsim", "setupNetwork",
+                max<int64_t>(0, memory_core::rss() - rss0));
+        mem.check("setupNetwork");
+    };
 
     // Poisson spikes
     if (tmp == "poisson") {
-        sim->setupNetwork(sim_p.remove_tmp_mem);
+        setup_network();
         flag = poisson_spikes();
     }
+    // Pre-generated Poisson spike trains
+    else if (tmp == "poisson_schedule") {
+        flag = scheduled_spikes();
+        setup_network();
+    }
     // Periodical spike trains
     else if (tmp == "periodical") {
         flag = periodical_spikes();
-        sim->setupNetwork(sim_p.remove_tmp_mem);
+        setup_network();
     }
     // Spikes from c++ vector 
     else if (tmp == "vectorial") {
         flag = vectorial_spikes();
-        sim->setupNetwork(sim_p.remove_tmp_mem);
+        setup_network();
     }
     // Spikes from file
     else if (tmp == "fromfile") {
         flag = file_spikes();
-        sim->setupNetwork(sim_p.remove_tmp_mem);
+        setup_network();
     }
     // Throw an exception
     else { throw 8; }
+
+    // Connection monitors (no files) - checkpoints take the weights
+    // snapshots from them (each keeps the current and the last weights
+    // matrices), so they are only created on request
+    conn_mons.clear();
+    if (ckpt_enabled) {
+        timer_scope mons_scope(timer, "connection monitors");
+        int64_t num_wt = 0;
+        for (auto &p : get_projections())
+            num_wt += static_cast<int64_t>(p.num_pre) * p.num_post;
+        mem.reserve("monitors", "connections", 2 * num_wt * sizeof(float));
+        for (auto &g : conn_grps)
+            conn_mons.push_back(sim->setConnectionMonitor(g.first, g.second,
+                                                          "NULL"));
+    }
+    carl_state = 2;
     return flag;
 }
 
 
+/***************************************************************************
+ * NSAT_CORE GET_NUM_SPIKES - This method returns the number of spikes of
+ * the monitored NSAT groups recorded by the last run.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Number of spikes (int64_t).
+ ***************************************************************************/
+int64_t nsat_core::get_num_spikes() {
+    int64_t num_spikes = 0;
+
+    for (auto &sm : nsat_smons) num_spikes += sm->getPopNumSpikes();
+    return num_spikes;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE RESET_STATE - This method prepares a set up network for a new
+ * trial without rebuilding it: the spike monitors are cleared and the
+ * synaptic weights are either kept or set back to the weights the
+ * connections were built from. Inputs can be swapped in between through
+ * SET_INPUT_RATE(S) and SET_INPUT_VECTOR.
+ *
+ * CARLsim does not expose the membrane potentials, the refractory 
+ * counters or the synaptic currents, so they carry over to the next run
+ * (they relax back within a few time constants without input). Use 
+ * batch_core for trials that need an exact reset.
+ *
+ * Args:
+ * -----
+ *  keep_weights (bool) : If false the initial weights are restored.
+ *
+ * Returns:
+ * --------
+ *  0 if the state is succesfully reset.
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state (cleaned up).
+ ***************************************************************************/
+int nsat_core::reset_state(bool keep_weights) {
+    for (auto &sm : inp_smons) sm->clear();
+    for (auto &sm : nsat_smons) sm->clear();
+
+    if (!keep_weights && carl_state == 2) {
+        if (connex == NULL) { throw 25; }                   // cleaned up
+        for (int c = 0; c < conn_ids.size(); ++c) {
+            const vector<vector<float>> &wt = connex[c]->get_weight_matrix();
+            for (int i = 0; i < wt.size(); ++i)
+                for (int j = 0; j < wt[i].size(); ++j)
+                    if (fabsf(wt[i][j]) > 0.0f)
+                        sim->setWeight(conn_ids[c], i, j, wt[i][j], true);
+        }
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE ENABLE_CHECKPOINTS - This method requests checkpoints of the
+ * network: the setup state then creates a connection monitor for each
+ * connection (about two dense weights matrices each), which CHECKPOINT
+ * reads the current weights from. It has to be called before the setup
+ * state.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+void nsat_core::enable_checkpoints() {
+    if (carl_state == 2) { throw 25; }
+    ckpt_enabled = true;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE CHECKPOINT - This method writes the state of a set up network
+ * to a checkpoint file (see ckpt_core.h): the simulation time, the random
+ * seed, the state of drand48 (CARLsim's CPU random numbers, shared by
+ * all the instances of the process), the input rates and the current
+ * synaptic weights of all the connections (NaN for missing synapses).
+ * Membrane potentials, refractory counters and STDP traces live inside
+ * CARLsim, which does not expose them, so they are not saved (batch_core
+ * checkpoints save them). The weights are read from connection monitors,
+ * which only exist if ENABLE_CHECKPOINTS was called before the setup
+ * state.
+ *
+ * Args:
+ * -----
+ *  path (string) : Checkpoint file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the checkpoint is succesfully written, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ *  25 : Not allowed in the current simulation state (no monitors).
+ ***************************************************************************/
+int nsat_core::checkpoint(const string &path) {
+    ckpt_core ckpt;
+    vector<int> meta;
+    vector<float> weights, rates;
+    unsigned short rng[3] = {0, 0, 0}, *cur;
+
+    if (carl_state != 2 || conn_mons.size() != conn_ids.size()) { throw 25; }
+    meta.push_back(sim->getSimTime());
+    meta.push_back(carl_p.random_seed);
+    meta.push_back(conn_mons.size());
+
+    // Read drand48 state without changing it
+    {
+        lock_guard<mutex> lock(drand48_mutex);
+        cur = seed48(rng);
+        copy(cur, cur + 3, rng);
+        seed48(rng);
+    }
+
+    for (auto &u : inpc) rates.push_back(u.spkg_p.rate);
+
+    for (auto &cm : conn_mons) {
+        vector<vector<float>> wt = cm->takeSnapshot();
+        meta.push_back(wt.size());
+        meta.push_back(wt.empty() ? 0 : wt[0].size());
+        for (auto &row : wt)
+            weights.insert(weights.end(), row.begin(), row.end());
+    }
+
+    ckpt.add("meta", meta);
+    ckpt.add("drand48", rng, sizeof(unsigned short), 3);
+    ckpt.add("rates", rates);
+    ckpt.add("weights", weights);
+    return ckpt.write(path);
+}
+
+
+/***************************************************************************
+ * NSAT_CORE RESTORE - This method restores a checkpoint (see CHECKPOINT)
+ * on a set up network with the same connections: it sets all the 
+ * synaptic weights, the drand48 state and the Poisson input rates. The
+ * checkpoint's simulation time is kept in restored_time (CARLsim's clock
+ * cannot be moved).
+ *
+ * Args:
+ * -----
+ *  path (string) : Checkpoint file name.
+ *
+ * Returns:
+ * --------
+ *  0 if the checkpoint is succesfully restored, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  22 : Cannot read/write checkpoint file.
+ *  23 : Not a valid (or not compatible) checkpoint file.
+ *  25 : Not allowed in the current simulation state.
+ ***************************************************************************/
+int nsat_core::restore(const string &path) {
+    ckpt_core ckpt;
+    vector<int> meta;
+    vector<float> weights, rates;
+    vector<unsigned short> rng;
+    size_t k = 0;
+
+    if (carl_state != 2) { throw 25; }
+    ckpt.open(path);
+    ckpt.get("meta", meta);
+    ckpt.get("drand48", rng);
+    ckpt.get("rates", rates);
+    ckpt.get("weights", weights);
+
+    if (meta.size() != 3 + 2 * conn_ids.size() ||
+        meta[2] != conn_ids.size() ||
+        rates.size() != inpc.size() || rng.size() != 3) { throw 23; }
+
+    for (int c = 0; c < conn_ids.size(); ++c) {
+        int rows = meta[3+2*c], cols = meta[4+2*c];
+        if (rows != get_projections()[c].num_pre ||
+            cols != get_projections()[c].num_post ||
+            k + rows * cols > weights.size()) { throw 23; }
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j, ++k) {
+                if (!isnan(weights[k]))
+                    sim->setWeight(conn_ids[c], i, j, weights[k], true);
+            }
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(drand48_mutex);
+        seed48(rng.data());
+    }
+
+    string tmp = static_cast<string>(sim_p.input_type);
+    transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+    if (tmp == "poisson" || tmp == "poisson_schedule") {
+        for (int i = 0; i < num_in_groups; ++i) set_input_rate(i, rates[i]);
+    }
+
+    restored_time = meta[0];
+    return 0;
+}
+
+
 /***************************************************************************
  * SAT_CORE Class COUNT_LIES_TRUTHS - This method counts the number of 
  * bool flags for momitoring neural populations. If a flag is true then
@@ -1082,6 +2438,25 @@ void nsat_core::count_lies_truths() {
 }
 
 
+/***************************************************************************
+ * NSAT_CORE MONITOR_FNAME - This method returns the spike monitor file 
+ * name of a group: dir/spk<group name>.dat if a results directory has
+ * been set, otherwise "DEFAULT".
+ *
+ * Args:
+ * -----
+ *  name (string) : Group's name.
+ *
+ * Returns:
+ * --------
+ *  File name (string).
+ ***************************************************************************/
+string nsat_core::monitor_fname(const string &name) {
+    if (results_dir.empty()) return "DEFAULT";
+    return results_dir + "/spk" + name + ".dat";
+}
+
+
 /***************************************************************************
  * SAT_CORE Class RUN_STATE - This method implements CARLsim's Run State.
  * In this state the neural network is simulated and the results are 
@@ -1101,55 +2476,209 @@ void nsat_core::count_lies_truths() {
  *  Runtime errors according to CARLsim methods. 
  ***************************************************************************/
 int nsat_core::c_run_state() {
-    int flag, ii = 0;
-    int inp_size = inp_monitors.size();
-    int nsat_size = nsat_monitors.size();
+    int flag = 0;
+    {
+        // The phase ends before its timings are printed
+        timer_scope run_scope(timer, "run");
 
-    // Set the external current to NSAT groups
-    // FIXME This can be neglected later - only for test purposes here
+        // Set the external current to NSAT groups
+        // FIXME This can be neglected later - only for test purposes here
 	// sim->setExternalCurrent(nsatc[0].unit_id, 0.1f);
 
-    // ConnectionMonitor * CM = sim->setConnectionMonitor(inpc[0].unit_id,
-    //                                                    nsatc[0].unit_id,
-    //                                                    "DEFAULT");
-    // vector<vector<float>> weights = CM->takeSnapshot();
-    // cout << weights[0][0] << endl;
+        // ConnectionMonitor * CM = sim->setConnectionMonitor(inpc[0].unit_id,
+        //                                                    nsatc[0].unit_id,
+        //                                                    "DEFAULT");
+        // vector<vector<float>> weights = CM->takeSnapshot();
+        // cout << weights[0][0] << endl;
+
+        // Setup spike monitors once - the next runs (trials) reuse them
+        if (inp_smons.empty() && nsat_smons.empty()) {
+            for (auto &i : inp_monitors)
+                inp_smons.push_back(sim->setSpikeMonitor(inpc[i].unit_id,
+                                            monitor_fname(inpc[i].unit_name)));
+            for (auto &i : nsat_monitors)
+                nsat_smons.push_back(sim->setSpikeMonitor(nsatc[i].unit_id,
+                                            monitor_fname(nsatc[i].unit_name)));
+        }
 
-    SpikeMonitor **inSM, **nsatSM;
+        // Merge the inputs of this run into the calendar
+        string tmp = static_cast<string>(sim_p.input_type);
+        transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+        if (tmp != "poisson") {
+            trace_scope scope("build_calendar");
+            build_calendar(sim->getSimTime());
+        }
 
-    inSM = new SpikeMonitor*[inp_size];
-    nsatSM = new SpikeMonitor*[nsat_size];
-    
-    // Setup and start spike monitors for input groups
-    for (auto &i : inp_monitors) {
-        inSM[ii] = sim->setSpikeMonitor(inpc[i].unit_id, "DEFAULT");
-        inSM[ii]->startRecording();
-        ii++;
-    }
+        // Start spike monitors for input and NSAT (asynchronous runs keep
+        // the spikes of the NSAT monitors across the slices)
+        {
+            timer_scope scope(timer, "startRecording");
+            if (async_slice > 0)
+                for (auto &sm : nsat_smons) sm->setPersistentData(true);
+            for (auto &sm : inp_smons) sm->startRecording();
+            for (auto &sm : nsat_smons) sm->startRecording();
+        }
 
-    // Setup and start spike monitors for NSAT groups
-    ii = 0;
-    for (auto &i : nsat_monitors) {
-        nsatSM[ii] = sim->setSpikeMonitor(nsatc[i].unit_id, "DEFAULT");
-        nsatSM[ii]->startRecording();
-        ii++;
+        // Run the network - in slices of 1 s while tracing, one event each,
+        // or of async_slice ms when asynchronous: the progress is published
+        // and a cancellation takes effect between the slices.
+        {
+            timer_scope scope(timer, "runNetwork");
+            if (trace_enabled() || async_slice > 0) {
+                int total = 1000 * sim_p.sim_time_sec + sim_p.sim_time_msec;
+                int len = (async_slice > 0) ? async_slice : 1000;
+                for (int t = 0; t < total; t += len) {
+                    if (async_slice > 0 && async_cancel) break;
+                    int ms = min(len, total - t);
+                    {
+                        trace_scope slice("slice",
+                                          to_string(sim->getSimTime()) + " ms");
+                        bool last = t + ms == total;
+                        flag = sim->runNetwork(ms / 1000, ms % 1000,
+                                               sim_p.print_summary && last,
+                                               sim_p.copy_state);
+                    }
+                    if (async_slice > 0 && t + ms < total) {
+                        int64_t num_spikes = 0;
+                        for (auto &sm : nsat_smons) {
+                            sm->stopRecording();
+                            num_spikes += sm->getPopNumSpikes();
+                            sm->startRecording();
+                        }
+                        async_spikes = num_spikes;
+                        async_ms = sim->getSimTime();
+                    }
+                }
+            } else {
+                flag = sim->runNetwork(sim_p.sim_time_sec,
+                                       sim_p.sim_time_msec,
+                                       sim_p.print_summary,
+                                       sim_p.copy_state);
+            }
+        }
+
+        // Stop spike monitors for input and NSAT (flushes their files)
+        {
+            timer_scope scope(timer, "stopRecording");
+            for (auto &sm : inp_smons) sm->stopRecording();
+            for (auto &sm : nsat_smons) sm->stopRecording();
+            if (async_slice > 0)
+                for (auto &sm : nsat_smons) sm->setPersistentData(false);
+        }
+        async_spikes = get_num_spikes();
+        async_ms = sim->getSimTime();
+
+        // Spikes kept by the monitors (one int each)
+        for (int i = 0; i < inp_smons.size(); ++i)
+            mem.set("monitors", "spikes " + inpc[inp_monitors[i]].unit_name,
+                    inp_smons[i]->getPopNumSpikes() * sizeof(int));
+        for (int i = 0; i < nsat_smons.size(); ++i)
+            mem.set("monitors", "spikes " + nsatc[nsat_monitors[i]].unit_name,
+                    nsat_smons[i]->getPopNumSpikes() * sizeof(int));
+        mem.check("run");
     }
 
-    // Run the network
-	flag = sim->runNetwork(sim_p.sim_time_sec,
-                           sim_p.sim_time_msec,
-                           sim_p.print_summary,
-                           sim_p.copy_state);
+    // Phase timings and memory along with CARLsim's summary
+    if (sim_p.print_summary && timer.is_enabled()) timer.print(*log);
+    if (sim_p.print_summary) mem.print(*log);
+
+    return flag;
+}
+
 
-    // Stop spike monitors for input and NSAT
-    for (int i = 0; i < inp_size; ++i)
-        inSM[i]->stopRecording();
-    for (int i = 0; i < nsat_size; ++i)
-        nsatSM[i]->stopRecording();
+/***************************************************************************
+ * NSAT_CORE RUN_ASYNC - This method performs the Run State (see
+ * C_RUN_STATE) on an internal thread and returns at once. The network is
+ * run in slices: after every slice the simulation time and the spikes of
+ * the monitored NSAT groups are published (see POLL) and a cancellation
+ * stops the run (see CANCEL). Until WAIT returns, only POLL, WAIT and
+ * CANCEL may be called.
+ *
+ * Args:
+ * -----
+ *  slice_ms (int) : Length of the slices (ms).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  25 : Not allowed in the current simulation state (already running).
+ ***************************************************************************/
+void nsat_core::run_async(int slice_ms) {
+    if (async_running) { throw 25; }
+    if (run_thread.joinable()) run_thread.join();
+
+    async_slice = max(1, slice_ms);
+    async_cancel = false;
+    async_ms = sim->getSimTime();
+    async_spikes = 0;
+    async_rc = 0;
+    async_running = true;
+    run_thread = thread([this]() {
+        // Nothing may escape the thread (it would terminate the process)
+        try { async_rc = c_run_state(); }
+        catch (int &e) { async_rc = error(e); }
+        catch (...) { async_rc = -1; }
+        async_slice = 0;
+        async_running = false;
+    });
+}
 
-    // Cleanup memory for spike monitors
-    delete[] inSM;
-    delete[] nsatSM;
 
-    return flag;
+/***************************************************************************
+ * NSAT_CORE POLL - This method returns the progress of the asynchronous
+ * run (safe to call while it runs).
+ *
+ * Args:
+ * -----
+ *  sim_ms (int &)     : Simulation time (ms) at the end of the last slice.
+ *  spikes (int64_t &) : Spikes of the monitored NSAT groups so far.
+ *
+ * Returns:
+ * --------
+ *  True while the run is in progress.
+ ***************************************************************************/
+bool nsat_core::poll(int &sim_ms, int64_t &spikes) const {
+    sim_ms = async_ms;
+    spikes = async_spikes;
+    return async_running;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE WAIT - This method waits for the asynchronous run to finish.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  The return value of the run (C_RUN_STATE) or the exception it threw
+ *  (0 if there has been no asynchronous run).
+ ***************************************************************************/
+int nsat_core::wait() {
+    if (run_thread.joinable()) run_thread.join();
+    return async_rc;
+}
+
+
+/***************************************************************************
+ * NSAT_CORE CANCEL - This method stops the asynchronous run at the end
+ * of the current slice (the monitors are stopped as usual) and waits for
+ * it.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  See WAIT.
+ ***************************************************************************/
+int nsat_core::cancel() {
+    if (async_running) async_cancel = true;
+    return wait();
 }
@@ -0,0 +1,139 @@
+#include "rng_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * Counter-based random numbers - Batched draws
+ ***************************************************************************/
+
+/***************************************************************************
+ * rng_uniform - Draws one uniform number in [0, 1) per seed.
+ *
+ * Args:
+ * -----
+ *  stream (uint32_t) : Random stream (RNG_STREAM).
+ *  id (uint32_t)     : Neuron or synapse id within the stream.
+ *  step (uint32_t)   : Simulation step.
+ *  seeds (uint32_t *): Seed of each instance.
+ *  n (int)           : Number of seeds.
+ *  out (float *)     : n uniform numbers (output).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void rng_uniform(uint32_t stream,
+                 uint32_t id,
+                 uint32_t step,
+                 const uint32_t *seeds,
+                 int n,
+                 float *out) {
+    for (int b = 0; b < n; ++b)
+        out[b] = rng_uniform1(stream, id, step, seeds[b]);
+}
+
+
+/***************************************************************************
+ * rng_normal - Draws one standard normal number per seed. The two first
+ * words of a Philox block feed a Box-Muller transform.
+ *
+ * Args:
+ * -----
+ *  stream (uint32_t) : Random stream (RNG_STREAM).
+ *  id (uint32_t)     : Neuron or synapse id within the stream.
+ *  step (uint32_t)   : Simulation step.
+ *  seeds (uint32_t *): Seed of each instance.
+ *  n (int)           : Number of seeds.
+ *  out (float *)     : n normal numbers (output).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void rng_normal(uint32_t stream,
+                uint32_t id,
+                uint32_t step,
+                const uint32_t *seeds,
+                int n,
+                float *out) {
+    for (int b = 0; b < n; ++b)
+        out[b] = rng_normal1(stream, id, step, seeds[b]);
+}
+
+
+/***************************************************************************
+ * rng_uniform_seq - Draws n uniform numbers in [0, 1) for one seed: the
+ * k-th number has counter (id, first + k, seed, tag).
+ *
+ * Args:
+ * -----
+ *  stream (uint32_t) : Random stream (RNG_STREAM).
+ *  id (uint32_t)     : Neuron or synapse id within the stream.
+ *  seed (uint32_t)   : Seed of the instance.
+ *  tag (uint32_t)    : Extra key word (e.g. the first step of a schedule).
+ *  first (uint32_t)  : Index of the first number of the sequence.
+ *  n (int)           : Number of draws.
+ *  out (float *)     : n uniform numbers (output).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void rng_uniform_seq(uint32_t stream,
+                     uint32_t id,
+                     uint32_t seed,
+                     uint32_t tag,
+                     uint32_t first,
+                     int n,
+                     float *out) {
+    const uint32_t key[2] = {stream, 0x6E534154u};
+
+    for (int k = 0; k < n; ++k) {
+        uint32_t c[4] = {id, first + k, seed, tag};
+        philox4x32(c, key);
+        out[k] = rng_u01(c[0]);
+    }
+}
+
+
+/***************************************************************************
+ * rng_known_answers - Checks philox4x32 against the known-answer vectors
+ * of Random123 (kat_vectors: counter, key and expected output of
+ * Philox4x32-10).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Number of vectors that do not match (0 if all of them do).
+ ***************************************************************************/
+int rng_known_answers() {
+    static const uint32_t kat[3][10] = {
+        {0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u,
+         0x00000000u, 0x00000000u,
+         0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u},
+        {0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu,
+         0xffffffffu, 0xffffffffu,
+         0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu},
+        {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u,
+         0xa4093822u, 0x299f31d0u,
+         0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}};
+    int num_failed = 0;
+
+    for (int v = 0; v < 3; ++v) {
+        uint32_t c[4] = {kat[v][0], kat[v][1], kat[v][2], kat[v][3]};
+        const uint32_t key[2] = {kat[v][4], kat[v][5]};
+
+        philox4x32(c, key);
+        for (int i = 0; i < 4; ++i) {
+            if (c[i] != kat[v][6+i]) {
+                num_failed++;
+                break;
+            }
+        }
+    }
+    return num_failed;
+}
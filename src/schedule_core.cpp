@@ -0,0 +1,281 @@
+#include "schedule_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * SPIKE_SCHEDULE Class Constructor - An empty schedule.
+ ***************************************************************************/
+spike_schedule::spike_schedule() {
+    t0 = 0;
+    num_steps = 0;
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE RESET - This method empties the schedule and sets the
+ * time window of the next spikes.
+ *
+ * Args:
+ * -----
+ *  first (int) : First step of the window.
+ *  steps (int) : Length of the window (steps).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::reset(int first, int steps) {
+    t0 = first;
+    num_steps = max(steps, 0);
+    step_ptr.clear();
+    ids.clear();
+    pend_t.clear();
+    pend_id.clear();
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE ADD - This method adds one spike (spikes out of the 
+ * window are dropped).
+ *
+ * Args:
+ * -----
+ *  t (int)  : Spike's step.
+ *  id (int) : Spiking neuron's id.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::add(int t, int id) {
+    if (t < t0 || t >= t0 + num_steps) return;
+    pend_t.push_back(t);
+    pend_id.push_back(id);
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE ADD_POISSON - This method pre-generates the Poisson 
+ * spike trains of a group of neurons for the whole window. The n-th 
+ * neuron of the group is added with id (id0 + n) * stride + offset.
+ *
+ * Args:
+ * -----
+ *  rates (vector<float>) : Rate (Hz) of each neuron of the group.
+ *  id0 (int)             : Id of the first neuron of the group.
+ *  stride (int)          : Stride of the ids (e.g. batch size).
+ *  offset (int)          : Offset of the ids (e.g. instance).
+ *  stream (uint32_t)     : Random stream (RNG_STREAM).
+ *  seed (uint32_t)       : Random seed.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::add_poisson(const vector<float> &rates,
+                                 int id0,
+                                 int stride,
+                                 int offset,
+                                 uint32_t stream,
+                                 uint32_t seed) {
+    const int block = 64;
+    float u[block];
+    int last = t0 + num_steps;
+
+    for (int n = 0; n < rates.size(); ++n) {
+        float p = rates[n] / 1000.0;
+        int id = (id0 + n) * stride + offset;
+        int t = t0 - 1;
+        uint32_t k = 0;
+
+        if (p <= 0.0) continue;
+        if (p >= 1.0) {
+            for (int s = t0; s < last; ++s) add(s, id);
+            continue;
+        }
+
+        float inv_log = 1.0 / log1pf(-p);
+        while (t < last) {
+            rng_uniform_seq(stream, n, seed, t0, k, block, u);
+            k += block;
+            for (int j = 0; j < block && t < last; ++j) {
+                t += 1 + static_cast<int>(logf(1.0f - u[j]) * inv_log);
+                if (t < last) {
+                    pend_t.push_back(t);
+                    pend_id.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE ADD_PERIODIC - This method adds the spikes of a group of
+ * neurons that all spike every 1000/freq ms, i.e. at the steps that are
+ * multiples of the period (step 0 only if spk_at_zero is true).
+ *
+ * Args:
+ * -----
+ *  num_neurons (int)  : Number of neurons of the group.
+ *  freq (float)       : Frequency (Hz).
+ *  spk_at_zero (bool) : If true the neurons also spike at step 0.
+ *  id0 (int)          : Id of the first neuron of the group.
+ *  stride (int)       : Stride of the ids (e.g. batch size).
+ *  offset (int)       : Offset of the ids (e.g. instance).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::add_periodic(int num_neurons,
+                                  float freq,
+                                  bool spk_at_zero,
+                                  int id0,
+                                  int stride,
+                                  int offset) {
+    if (freq <= 0.0) return;
+
+    int isi = max(1, static_cast<int>(1000.0 / freq));
+    int t = (t0 + isi - 1) / isi * isi;
+
+    for (; t < t0 + num_steps; t += isi) {
+        if (t == 0 && !spk_at_zero) continue;
+        for (int n = 0; n < num_neurons; ++n)
+            add(t, (id0 + n) * stride + offset);
+    }
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE ADD_TRAIN - This method adds a spike train that all the
+ * neurons of a group share (vectorial inputs).
+ *
+ * Args:
+ * -----
+ *  times (vector<int>) : Spike times (ms), relative to time_offset.
+ *  num_neurons (int)   : Number of neurons of the group.
+ *  time_offset (int)   : Step that the spike times start at.
+ *  id0 (int)           : Id of the first neuron of the group.
+ *  stride (int)        : Stride of the ids (e.g. batch size).
+ *  offset (int)        : Offset of the ids (e.g. instance).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::add_train(const vector<int> &times,
+                               int num_neurons,
+                               int time_offset,
+                               int id0,
+                               int stride,
+                               int offset) {
+    for (auto &t : times)
+        for (int n = 0; n < num_neurons; ++n)
+            add(t + time_offset, (id0 + n) * stride + offset);
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE ADD_EVENTS - This method adds (time, neuron id) spike 
+ * events of a group (e.g. read from a CARLsim spike file).
+ *
+ * Args:
+ * -----
+ *  times (vector<int>) : Spike times (ms).
+ *  nids (vector<int>)  : Neuron ids (within the group) of the spikes.
+ *  num_neurons (int)   : Number of neurons of the group (larger ids are
+ *                        dropped).
+ *  id0 (int)           : Id of the first neuron of the group.
+ *  stride (int)        : Stride of the ids (e.g. batch size).
+ *  offset (int)        : Offset of the ids (e.g. instance).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::add_events(const vector<int> &times,
+                                const vector<int> &nids,
+                                int num_neurons,
+                                int id0,
+                                int stride,
+                                int offset) {
+    for (int k = 0; k < times.size(); ++k) {
+        if (nids[k] < 0 || nids[k] >= num_neurons) continue;
+        add(times[k], (id0 + nids[k]) * stride + offset);
+    }
+}
+
+
+/***************************************************************************
+ * SPIKE_SCHEDULE FINALIZE - This method sorts the added spikes by step
+ * (counting sort, stable) into the compact schedule.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void spike_schedule::finalize() {
+    vector<int> pos(num_steps + 1, 0);
+
+    for (auto &t : pend_t) pos[t - t0 + 1]++;
+    for (int i = 0; i < num_steps; ++i) pos[i+1] += pos[i];
+    step_ptr = pos;
+
+    ids.resize(pend_id.size());
+    for (int k = 0; k < pend_t.size(); ++k)
+        ids[pos[pend_t[k] - t0]++] = pend_id[k];
+
+    pend_t.clear();
+    pend_id.clear();
+}
+
+
+/***************************************************************************
+ * read_spike_file - Reads a binary CARLsim spike file: a header (signature
+ * 206661989, version and, from version 0.2 on, the grid dimensions) 
+ * followed by (time, neuron id) pairs.
+ *
+ * Args:
+ * -----
+ *  fname (string)      : Spike file name.
+ *  times (vector<int>) : Spike times (ms) (output).
+ *  nids (vector<int>)  : Neuron ids of the spikes (output).
+ *
+ * Returns:
+ * --------
+ *  Void
+ *
+ * Exceptions:
+ * -----------
+ *  26 : Cannot read an input spike file.
+ ***************************************************************************/
+void read_spike_file(const string &fname,
+                     vector<int> &times,
+                     vector<int> &nids) {
+    int signature, pair[2], grid[3];
+    float version;
+    ifstream in(fname, ios::binary);
+
+    if (!in) { throw 26; }
+    in.read((char *) &signature, sizeof(int));
+    in.read((char *) &version, sizeof(float));
+    if (!in || signature != 206661989) { throw 26; }
+    if (version >= 0.2f) in.read((char *) grid, 3 * sizeof(int));
+
+    times.clear();
+    nids.clear();
+    while (in.read((char *) pair, 2 * sizeof(int))) {
+        times.push_back(pair[0]);
+        nids.push_back(pair[1]);
+    }
+}
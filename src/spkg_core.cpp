@@ -0,0 +1,109 @@
+#include "spkg_core.h"
+
+/***************************************************************************
+ * ScheduleSpkg Class Implementation
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * SCHEDULESPKG Class Constructor - No spikes until SETSCHEDULE.
+ ***************************************************************************/
+ScheduleSpkg::ScheduleSpkg() {
+    _nrnPtr.assign(1, 0);
+}
+
+
+/***************************************************************************
+ * SCHEDULESPKG Class Destructor.
+ ***************************************************************************/
+ScheduleSpkg::~ScheduleSpkg() {
+    // void
+}
+
+
+/***************************************************************************
+ * SCHEDULESPKG ADDGROUP - This method registers an input group. Groups
+ * that are not registered have offset 0.
+ *
+ * Args:
+ * -----
+ *  grpId (int)  : CARLsim group's id.
+ *  offset (int) : Id of the group's first neuron in the schedule.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void ScheduleSpkg::addGroup(int grpId, int offset) {
+    if (grpId >= _grpOffset.size()) _grpOffset.resize(grpId + 1, 0);
+    _grpOffset[grpId] = offset;
+}
+
+
+/***************************************************************************
+ * SCHEDULESPKG SETSCHEDULE - This method replaces the spike trains with
+ * the ones of a schedule. 
+ *
+ * Args:
+ * -----
+ *  sched (spike_schedule) : Finalized schedule of all the groups.
+ *  numNeurons (int)       : Number of neurons (ids) of the schedule.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void ScheduleSpkg::setSchedule(const spike_schedule &sched, int numNeurons) {
+    int first = sched.first_step(), last = first + sched.length();
+    vector<int> pos(numNeurons + 1, 0);
+
+    // Count the spikes of each neuron, then place them (time-sorted)
+    for (int t = first; t < last; ++t)
+        for (const int *id = sched.begin(t); id != sched.end(t); ++id)
+            pos[*id + 1]++;
+    for (int i = 0; i < numNeurons; ++i) pos[i+1] += pos[i];
+    _nrnPtr = pos;
+
+    _times.resize(pos[numNeurons]);
+    for (int t = first; t < last; ++t)
+        for (const int *id = sched.begin(t); id != sched.end(t); ++id)
+            _times[pos[*id]++] = t;
+}
+
+
+/***************************************************************************
+ * SCHEDULESPKG NEXTSPIKETIME - This method implements CARLsim's 
+ * SpikeGenerator interface. It returns the first spike time after both
+ * the last scheduled spike of the neuron and the current time.
+ *
+ * Args:
+ * -----
+ *  sim (CARLsim *)              : A pointer to a CARLsim instance.
+ *  grpId (int)                  : Group's id.
+ *  nid (int)                    : Neuron's id (within the group).
+ *  currentTime (int)            : Current simulation time (ms).
+ *  lastScheduledSpikeTime (int) : Last scheduled spike of the neuron.
+ *  endOfTimeSlice (int)         : End of the current time slice (ms).
+ *
+ * Returns:
+ * --------
+ *  The next spike time, or a time after the end of the time slice if 
+ *  there are no more spikes.
+ ***************************************************************************/
+int ScheduleSpkg::nextSpikeTime(CARLsim *sim,
+                                int grpId,
+                                int nid,
+                                int currentTime,
+                                int lastScheduledSpikeTime,
+                                int endOfTimeSlice) {
+    if (grpId >= 0 && grpId < _grpOffset.size()) nid += _grpOffset[grpId];
+    if (nid < 0 || nid + 1 >= _nrnPtr.size()) return endOfTimeSlice + 1;
+
+    int after = max(lastScheduledSpikeTime + 1, currentTime);
+    vector<int>::iterator first = _times.begin() + _nrnPtr[nid];
+    vector<int>::iterator last = _times.begin() + _nrnPtr[nid+1];
+    vector<int>::iterator it = lower_bound(first, last, after);
+
+    if (it == last) return endOfTimeSlice + 1;
+    return *it;
+}
@@ -0,0 +1,429 @@
+#include "sweep_core.h"
+
+#include <chrono>
+
+using namespace std;
+
+
+/***************************************************************************
+ * SWEEP_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * SWEEP_CORE Class Constructor - It keeps a copy of the base
+ * configuration and the output directory.
+ *
+ * Args:
+ * -----
+ *  cfg (config_core) : Base configuration.
+ *  dir (string)      : Output directory.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+sweep_core::sweep_core(const config_core &cfg, const string &dir) {
+    base = cfg;
+    out_dir = dir;
+    mode = "grid";
+    num_jobs = 0;
+}
+
+
+/***************************************************************************
+ * SWEEP_CORE LOAD_SWEEP - This method reads a sweep file (see
+ * sweep_core.h for the format) and counts the jobs.
+ *
+ * Args:
+ * -----
+ *  fname (string) : Sweep file name.
+ *
+ * Returns:
+ * --------
+ *  0 if succesfully reads the file, otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  17 : Not a valid parameter name.
+ *  18 : Cannot open a configuration/sweep file.
+ *  19 : Not a valid sweep (mode, target or number of values).
+ ***************************************************************************/
+int sweep_core::load_sweep(const string &fname) {
+    string line;
+    ifstream infile(fname);
+
+    if (!infile) { throw 18; }
+
+    axes.clear();
+    while (getline(infile, line)) {
+        istringstream iss(line);
+        vector<string> tokens{istream_iterator<string>{iss},
+                              istream_iterator<string>{}};
+
+        if (tokens.empty() || tokens[0][0] == '#') { continue; }
+        if (tokens[0] == "mode") {
+            if (tokens.size() != 2) { throw 19; }
+            mode = tokens[1];
+            if (mode != "grid" && mode != "list") { throw 19; }
+            continue;
+        }
+        if (tokens.size() < 4) { throw 19; }
+        if (tokens[0] != "nsat" && tokens[0] != "stdp") { throw 19; }
+
+        sweep_axis axis;
+        axis.target = tokens[0];
+        axis.group = tokens[1];
+        axis.param = tokens[2];
+        for (int i = 3; i < tokens.size(); ++i)
+            axis.values.push_back(stof(tokens[i]));
+        axes.push_back(axis);
+    }
+    infile.close();
+
+    if (axes.empty()) { throw 19; }
+
+    // Count the jobs
+    if (mode == "grid") {
+        num_jobs = 1;
+        for (auto &a : axes) num_jobs *= a.values.size();
+    } else {
+        num_jobs = axes[0].values.size();
+        for (auto &a : axes)
+            if (a.values.size() != num_jobs) { throw 19; }
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * SWEEP_CORE JOB_VALUES - This method returns the value of every axis for
+ * a job. In grid mode the last axis varies fastest.
+ *
+ * Args:
+ * -----
+ *  job (int) : Job's index.
+ *
+ * Returns:
+ * --------
+ *  A vector with one value per axis.
+ ***************************************************************************/
+vector<float> sweep_core::job_values(int job) {
+    vector<float> vals(axes.size());
+
+    if (mode == "grid") {
+        for (int a = axes.size() - 1; a >= 0; --a) {
+            int n = axes[a].values.size();
+            vals[a] = axes[a].values[job % n];
+            job /= n;
+        }
+    } else {
+        for (int a = 0; a < axes.size(); ++a)
+            vals[a] = axes[a].values[job];
+    }
+    return vals;
+}
+
+
+/***************************************************************************
+ * SWEEP_CORE RUN_JOB - This method runs one job: it builds a NSAT Core
+ * from the base configuration, overrides the swept parameters, uses the
+ * shared projections and runs all the CARLsim states.
+ *
+ * Args:
+ * -----
+ *  job (int) : Job's index.
+ *
+ * Returns:
+ * --------
+ *  0 if the job has been succesfully simulated, otherwise the number of
+ *  the exception.
+ ***************************************************************************/
+int sweep_core::run_job(int job) {
+    char name[32];
+    config_core cfg(base);
+    vector<float> vals = job_values(job);
+
+    snprintf(name, sizeof(name), "/job_%04d", job);
+
+    try {
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+
+        for (int a = 0; a < axes.size(); ++a) {
+            if (axes[a].target == "nsat")
+                core.override_nsat(axes[a].group, axes[a].param, vals[a]);
+            else
+                core.override_stdp(axes[a].group, axes[a].param, vals[a]);
+        }
+        core.set_projections(&shared);
+        core.set_results_dir(out_dir + name);
+
+        core.c_config_state();
+        core.c_setup_state();
+        core.c_run_state();
+        core.c_cleanup();
+    }
+    catch (int &e) {
+        print_exceptions(e);
+        return e;
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * SWEEP_CORE WORKER - This is the loop of a worker process. It reads job
+ * indices from the jobs pipe (a negative index stops the worker), runs
+ * them and writes a sweep_result for each one to the results pipe.
+ *
+ * Args:
+ * -----
+ *  jobs_fd (int)    : Read end of the worker's jobs pipe.
+ *  results_fd (int) : Write end of the results pipe.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void sweep_core::worker(int jobs_fd, int results_fd) {
+    int job;
+
+    while (read(jobs_fd, &job, sizeof(int)) == sizeof(int) && job >= 0) {
+        sweep_result res;
+        auto t0 = chrono::steady_clock::now();
+
+        res.job_id = job;
+        res.status = run_job(job);
+        res.wall_time = chrono::duration<double>(chrono::steady_clock::now()
+                                                 - t0).count();
+        cout.flush();
+        if (write(results_fd, &res, sizeof(res)) != sizeof(res)) break;
+    }
+}
+
+
+/***************************************************************************
+ * SWEEP_CORE WRITE_INDEX - This method writes out_dir/index.dat with one
+ * line per job: its index, status, wall time and swept values.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if the index is succesfully written, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  15 : Cannot write results file.
+ ***************************************************************************/
+int sweep_core::write_index() {
+    ofstream out(out_dir + "/index.dat");
+    if (!out) { throw 15; }
+
+    out << "# job status wall_time(s)";
+    for (auto &a : axes)
+        out << " " << a.target << ":" << a.group << ":" << a.param;
+    out << endl;
+
+    for (auto &r : results) {
+        vector<float> vals = job_values(r.job_id);
+        out << r.job_id << " " << r.status << " " << r.wall_time;
+        for (auto &v : vals) out << " " << v;
+        out << endl;
+    }
+    out.close();
+    return 0;
+}
+
+
+/***************************************************************************
+ * SWEEP_CORE RUN - This method runs all the jobs on a pool of worker
+ * processes. The connections files are parsed once, before forking. Each
+ * worker has its own jobs pipe, so the parent knows which jobs every
+ * worker holds; it keeps at most queue_len jobs in flight (queued or
+ * running) and hands out a new one whenever a result comes back. The
+ * parent polls the results pipe and reaps the workers in between: a
+ * worker that dies (CARLsim exit, crash, OOM kill) fails the job it was
+ * running (exception 31) and its queued jobs go to the other workers. At
+ * the end it reports the per-job wall times and the throughput.
+ *
+ * Args:
+ * -----
+ *  num_workers (int) : Number of worker processes.
+ *  queue_len (int)   : Maximum number of jobs in flight (>= num_workers).
+ *
+ * Returns:
+ * --------
+ *  The number of failed (or not run) jobs, otherwise it throws an
+ *  exception.
+ *
+ * Exceptions:
+ * -----------
+ *  20 : Cannot create a worker process.
+ ***************************************************************************/
+int sweep_core::run(int num_workers, int queue_len) {
+    int results_fd[2];
+    int next = 0, in_flight = 0, num_alive, failed = 0, stop = -1;
+    double sim_sec, total;
+    vector<pid_t> pids;
+    vector<int> jobs_fd;
+    vector<deque<int>> queued;
+    vector<int> owner(num_jobs, -1);
+    deque<int> retry;
+
+    num_workers = max(1, min(num_workers, num_jobs));
+    queue_len = max(queue_len, num_workers);
+
+    // Parse the connections once - workers share them (copy-on-write)
+    {
+        config_core cfg(base);
+        cfg.get_carlsim()->mode = CPU_MODE;
+        nsat_core core(cfg.get_filenames(),
+                       cfg.get_carlsim(),
+                       cfg.get_simulation());
+        core.read_connexions();
+        shared = core.get_projections();
+    }
+    make_dirs(out_dir);
+
+    if (pipe(results_fd) != 0) { throw 20; }
+
+    auto t0 = chrono::steady_clock::now();
+    cout.flush();
+    for (int w = 0; w < num_workers; ++w) {
+        int fd[2];
+        if (pipe(fd) != 0) { throw 20; }
+        pid_t pid = fork();
+        if (pid < 0) { throw 20; }
+        if (pid == 0) {
+            close(fd[1]);
+            for (auto f : jobs_fd) close(f);
+            close(results_fd[0]);
+            worker(fd[0], results_fd[1]);
+            _exit(0);
+        }
+        close(fd[0]);
+        pids.push_back(pid);
+        jobs_fd.push_back(fd[1]);
+        queued.push_back(deque<int>());
+    }
+    close(results_fd[1]);
+    num_alive = num_workers;
+
+    // A write to a dead worker's pipe must fail, not kill the parent
+    void (*old_sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    // Sends jobs (retried ones first) to the least loaded live workers
+    auto dispatch = [&]() {
+        while (in_flight < queue_len && (!retry.empty() || next < num_jobs)) {
+            int w = -1;
+            for (int k = 0; k < num_workers; ++k)
+                if (pids[k] > 0 &&
+                    (w < 0 || queued[k].size() < queued[w].size())) w = k;
+            if (w < 0) return;
+
+            int job;
+            if (!retry.empty()) {
+                job = retry.front();
+                retry.pop_front();
+            } else {
+                job = next++;
+            }
+            if (write(jobs_fd[w], &job, sizeof(int)) != sizeof(int)) {
+                retry.push_front(job);
+                return;
+            }
+            queued[w].push_back(job);
+            owner[job] = w;
+            in_flight++;
+        }
+    };
+
+    // Records a result and frees its slot
+    auto finish = [&](const sweep_result &res) {
+        int w = owner[res.job_id];
+        if (w >= 0) {
+            auto it = find(queued[w].begin(), queued[w].end(), res.job_id);
+            if (it != queued[w].end()) queued[w].erase(it);
+        }
+        owner[res.job_id] = -1;
+        in_flight--;
+        results.push_back(res);
+        if (res.status != 0) failed++;
+
+        cout << "Job " << res.job_id << " finished (status " << res.status
+             << ") in " << res.wall_time << " s" << endl;
+    };
+
+    // Reads the results already in the pipe (waits up to timeout ms)
+    auto drain = [&](int timeout) {
+        struct pollfd pfd = {results_fd[0], POLLIN, 0};
+        while (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+            sweep_result res;
+            if (read(results_fd[0], &res, sizeof(res)) != sizeof(res)) break;
+            finish(res);
+            timeout = 0;
+        }
+    };
+
+    results.clear();
+    dispatch();
+    while (results.size() < num_jobs && num_alive > 0) {
+        drain(100);
+
+        // Reap dead workers: their writes are all in the pipe by now
+        for (int w = 0; w < num_workers; ++w) {
+            if (pids[w] <= 0 || waitpid(pids[w], NULL, WNOHANG) != pids[w])
+                continue;
+            drain(0);
+            pids[w] = -1;
+            close(jobs_fd[w]);
+            num_alive--;
+            if (queued[w].empty()) continue;
+
+            // The first queued job was running, the others go elsewhere
+            sweep_result res;
+            res.job_id = queued[w].front();
+            res.status = 31;
+            res.wall_time = 0.0;
+            print_exceptions(31);
+            finish(res);
+            for (auto job : queued[w]) {
+                owner[job] = -1;
+                retry.push_back(job);
+                in_flight--;
+            }
+            queued[w].clear();
+        }
+        dispatch();
+    }
+
+    // Stop the workers
+    for (int w = 0; w < num_workers; ++w) {
+        if (pids[w] <= 0) continue;
+        if (write(jobs_fd[w], &stop, sizeof(int)) != sizeof(int)) {}
+        close(jobs_fd[w]);
+    }
+    close(results_fd[0]);
+    for (auto &pid : pids)
+        if (pid > 0) waitpid(pid, NULL, 0);
+    signal(SIGPIPE, old_sigpipe);
+
+    total = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    sim_sec = base.get_simulation()->sim_time_sec +
+              base.get_simulation()->sim_time_msec / 1000.0;
+
+    write_index();
+
+    cout << "Sweep: " << results.size() << "/" << num_jobs << " jobs ("
+         << failed << " failed) on " << num_workers << " workers in "
+         << total << " s" << endl;
+    cout << "Throughput: " << results.size() / total << " jobs/s, "
+         << results.size() * sim_sec / total
+         << " simulated s per wall s" << endl;
+    return failed + (num_jobs - results.size());
+}
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+#include "timer_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * TIMER_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * TIMER_CORE Class Constructor - The timer starts disabled, unless the
+ * environment variable NSAT_TIMING is set: "mem" enables the timing and
+ * the memory sampling, any other value but "0" only the timing.
+ ***************************************************************************/
+timer_core::timer_core() {
+    const char *on = getenv("NSAT_TIMING");
+
+    enabled = on != NULL && *on != '\0' && strcmp(on, "0") != 0;
+    memory = enabled && strcmp(on, "mem") == 0;
+}
+
+
+/***************************************************************************
+ * TIMER_CORE ENABLE - This method enables or disables the timer. The
+ * phases that are still open when it is disabled are dropped (their
+ * records keep the previous calls).
+ *
+ * Args:
+ * -----
+ *  on (bool) : True to measure the phases.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void timer_core::enable(bool on) {
+    enabled = on;
+    if (!on) {
+        open.clear();
+        wall0.clear();
+        cpu0.clear();
+        bytes0.clear();
+        syn0.clear();
+        rss0.clear();
+        hwm0.clear();
+    }
+}
+
+
+/***************************************************************************
+ * TIMER_CORE BEGIN - This method opens a phase inside the current one.
+ * If the current phase already has a child with the same name, its
+ * record is reused. The resident set size is sampled if the memory
+ * reporting is enabled.
+ *
+ * Args:
+ * -----
+ *  name (string) : Phase's name.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void timer_core::begin(const string &name) {
+    traced.push_back(make_pair(name, trace_enabled() ? trace_now() : -1.0));
+    if (!enabled) return;
+
+    int parent = open.empty() ? -1 : open.back();
+    int idx = -1;
+    for (int i = 0; i < records.size(); ++i) {
+        if (records[i].parent == parent && records[i].name == name) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx < 0) {
+        phase_record rec;
+        rec.name = name;
+        rec.parent = parent;
+        rec.depth = open.size();
+        rec.calls = 0;
+        rec.wall = rec.cpu = 0.0;
+        rec.bytes = rec.synapses = 0;
+        rec.rss = rec.rss_delta = rec.peak_rss = 0;
+        records.push_back(rec);
+        idx = records.size() - 1;
+    }
+    records[idx].calls++;
+    int64_t rss = 0, hwm = 0;
+    if (memory) memory_core::sample(rss, hwm);
+    rss0.push_back(rss);
+    hwm0.push_back(hwm);
+    open.push_back(idx);
+    wall0.push_back(wall_time());
+    bytes0.push_back(records[idx].bytes);
+    syn0.push_back(records[idx].synapses);
+    cpu0.push_back(cpu_time());
+}
+
+
+/***************************************************************************
+ * TIMER_CORE END - This method closes the innermost open phase and adds
+ * its bytes and synapses counted in this call to its parent (and records
+ * its trace event). With the memory reporting enabled, it also adds the
+ * growth of the resident set size within the phase and updates its peak
+ * (see the class description).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void timer_core::end() {
+    if (!traced.empty()) {
+        if (traced.back().second >= 0.0)
+            trace_complete(traced.back().first, traced.back().second,
+                           trace_now() - traced.back().second);
+        traced.pop_back();
+    }
+    if (!enabled || open.empty()) return;
+
+    phase_record &rec = records[open.back()];
+    rec.wall += wall_time() - wall0.back();
+    rec.cpu += cpu_time() - cpu0.back();
+    if (memory && hwm0.back() > 0) {
+        int64_t rss, hwm;
+        memory_core::sample(rss, hwm);
+        int64_t peak = (hwm > hwm0.back()) ? hwm : max(rss0.back(), rss);
+        rec.rss = rss;
+        rec.rss_delta += rss - rss0.back();
+        rec.peak_rss = max(rec.peak_rss, peak);
+    }
+    open.pop_back();
+    wall0.pop_back();
+    cpu0.pop_back();
+    rss0.pop_back();
+    hwm0.pop_back();
+
+    if (rec.parent >= 0) {
+        records[rec.parent].bytes += rec.bytes - bytes0.back();
+        records[rec.parent].synapses += rec.synapses - syn0.back();
+    }
+    bytes0.pop_back();
+    syn0.pop_back();
+}
+
+
+/***************************************************************************
+ * TIMER_CORE CLEAR - This method removes all the records (and closes all
+ * the open phases).
+ ***************************************************************************/
+void timer_core::clear() {
+    records.clear();
+    traced.clear();
+    open.clear();
+    wall0.clear();
+    cpu0.clear();
+    bytes0.clear();
+    syn0.clear();
+    rss0.clear();
+    hwm0.clear();
+}
+
+
+/***************************************************************************
+ * TIMER_CORE TOTAL - This method returns the sum of the wall times of
+ * all the phases named name, wherever they are nested.
+ *
+ * Args:
+ * -----
+ *  name (string) : Phase's name.
+ *
+ * Returns:
+ * --------
+ *  Wall time (s).
+ ***************************************************************************/
+double timer_core::total(const string &name) const {
+    double t = 0.0;
+
+    for (auto &r : records)
+        if (r.name == name) t += r.wall;
+    return t;
+}
+
+
+/***************************************************************************
+ * TIMER_CORE TO_JSON - This method returns the records as a JSON array
+ * of objects (name, parent, depth, calls, wall_s, cpu_s, bytes,
+ * synapses, rss, rss_delta, peak_rss), in the order the phases were first
+ * entered. The memory fields are 0 unless the memory is sampled.
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  JSON text (string).
+ ***************************************************************************/
+string timer_core::to_json() const {
+    string out = "[";
+    char buf[512];
+
+    for (int i = 0; i < records.size(); ++i) {
+        const phase_record &r = records[i];
+        snprintf(buf, sizeof(buf),
+                 "%s\n  {\"name\": \"%s\", \"parent\": %d, \"depth\": %d, "
+                 "\"calls\": %d, \"wall_s\": %.9f, \"cpu_s\": %.9f, "
+                 "\"bytes\": %lld, \"synapses\": %lld, \"rss\": %lld, "
+                 "\"rss_delta\": %lld, \"peak_rss\": %lld}",
+                 i ? "," : "", r.name.c_str(), r.parent, r.depth, r.calls,
+                 r.wall, r.cpu, static_cast<long long>(r.bytes),
+                 static_cast<long long>(r.synapses),
+                 static_cast<long long>(r.rss),
+                 static_cast<long long>(r.rss_delta),
+                 static_cast<long long>(r.peak_rss));
+        out += buf;
+    }
+    out += records.empty() ? "]" : "\n]";
+    return out;
+}
+
+
+/***************************************************************************
+ * TIMER_CORE PRINT - This method prints the records as a table, nested
+ * phases indented under their parents (and their memory, if sampled).
+ *
+ * Args:
+ * -----
+ *  out (ostream &) : Output stream.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void timer_core::print(ostream &out) const {
+    char buf[256];
+
+    snprintf(buf, sizeof(buf), "%-32s %6s %12s %12s %12s %12s",
+             "phase", "calls", "wall (s)", "cpu (s)", "bytes", "synapses");
+    out << buf;
+    if (memory) {
+        snprintf(buf, sizeof(buf), " %10s %10s", "delta (MB)", "peak (MB)");
+        out << buf;
+    }
+    out << "\n";
+
+    // Depth-first order: children right after their parent
+    vector<int> todo;
+    for (int i = records.size() - 1; i >= 0; --i)
+        if (records[i].parent < 0) todo.push_back(i);
+    while (!todo.empty()) {
+        int i = todo.back();
+        todo.pop_back();
+        const phase_record &r = records[i];
+        string name = string(2 * r.depth, ' ') + r.name;
+        snprintf(buf, sizeof(buf), "%-32s %6d %12.6f %12.6f %12lld %12lld",
+                 name.c_str(), r.calls, r.wall, r.cpu,
+                 static_cast<long long>(r.bytes),
+                 static_cast<long long>(r.synapses));
+        out << buf;
+        if (memory) {
+            snprintf(buf, sizeof(buf), " %10.1f %10.1f",
+                     r.rss_delta / (1024.0 * 1024.0),
+                     r.peak_rss / (1024.0 * 1024.0));
+            out << buf;
+        }
+        out << "\n";
+        for (int j = records.size() - 1; j > i; --j)
+            if (records[j].parent == i) todo.push_back(j);
+    }
+}
+
+
+/***************************************************************************
+ * TIMER_CORE WALL_TIME - Monotonic wall clock (s).
+ ***************************************************************************/
+double timer_core::wall_time() {
+    return chrono::duration<double>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/***************************************************************************
+ * TIMER_CORE CPU_TIME - CPU time consumed by the calling thread (s).
+ ***************************************************************************/
+double timer_core::cpu_time() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
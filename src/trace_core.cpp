@@ -0,0 +1,220 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <unistd.h>
+
+#include "trace_core.h"
+
+using namespace std;
+
+
+/***************************************************************************
+ * TRACE_CORE Implementation
+ ***************************************************************************/
+
+atomic<bool> trace_on(false);
+
+static mutex trace_mutex;               // guards buffers and trace_path
+static vector<trace_buffer *> buffers;  // all the threads' buffers
+static thread_local trace_buffer *local_buffer = NULL;
+static string trace_path;
+static chrono::steady_clock::time_point trace_t0;
+static bool trace_atexit = false;
+
+
+/***************************************************************************
+ * Returns the buffer of the calling thread (registered on first use).
+ ***************************************************************************/
+static trace_buffer *thread_buffer() {
+    if (local_buffer == NULL) {
+        lock_guard<mutex> lock(trace_mutex);
+        local_buffer = new trace_buffer;
+        local_buffer->tid = buffers.size() + 1;
+        local_buffer->events.reserve(1024);
+        buffers.push_back(local_buffer);
+    }
+    return local_buffer;
+}
+
+
+/***************************************************************************
+ * Escapes a string for JSON.
+ ***************************************************************************/
+static string json_escape(const string &s) {
+    string out;
+    char buf[8];
+
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+
+static void trace_stop_atexit() { trace_stop(); }
+
+
+/***************************************************************************
+ * TRACE_START - This function starts tracing: the events recorded from
+ * now on are written to a file by TRACE_STOP (or at exit). Starting again
+ * while tracing only changes the file.
+ *
+ * Args:
+ * -----
+ *  path (string) : Output file (Chrome trace-event JSON).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void trace_start(const string &path) {
+    lock_guard<mutex> lock(trace_mutex);
+
+    trace_path = path;
+    if (!trace_on.load()) {
+        trace_t0 = chrono::steady_clock::now();
+        for (auto b : buffers) b->events.clear();
+    }
+    if (!trace_atexit) {
+        atexit(trace_stop_atexit);
+        trace_atexit = true;
+    }
+    trace_on.store(true);
+}
+
+
+/***************************************************************************
+ * TRACE_STOP - This function stops tracing and writes the events of all
+ * the threads to the trace file. The traced threads must not record
+ * events any more (e.g. they have been joined).
+ *
+ * Args:
+ * -----
+ *  Void
+ *
+ * Returns:
+ * --------
+ *  0 if the trace is succesfully written (or tracing was off), otherwise
+ *  15 (cannot write results file).
+ ***************************************************************************/
+int trace_stop() {
+    if (!trace_on.exchange(false)) return 0;
+    lock_guard<mutex> lock(trace_mutex);
+
+    FILE *fp = fopen(trace_path.c_str(), "w");
+    if (fp == NULL) {
+        cerr << "Cannot write trace file " << trace_path << endl;
+        return 15;
+    }
+
+    int pid = getpid();
+    bool first = true;
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (auto b : buffers) {
+        fprintf(fp, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", "
+                    "\"pid\": %d, \"tid\": %d, "
+                    "\"args\": {\"name\": \"thread %d\"}}",
+                first ? "" : ",", pid, b->tid, b->tid);
+        first = false;
+        for (auto &e : b->events) {
+            fprintf(fp, ",\n{\"name\": \"%s\", \"cat\": \"nsat\", "
+                        "\"ph\": \"%c\", \"ts\": %.3f, ",
+                    json_escape(e.name).c_str(), e.ph, e.ts);
+            if (e.ph == 'X') fprintf(fp, "\"dur\": %.3f, ", e.dur);
+            else fprintf(fp, "\"s\": \"t\", ");
+            fprintf(fp, "\"pid\": %d, \"tid\": %d", pid, b->tid);
+            if (!e.detail.empty())
+                fprintf(fp, ", \"args\": {\"detail\": \"%s\"}",
+                        json_escape(e.detail).c_str());
+            fprintf(fp, "}");
+        }
+        b->events.clear();
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return 0;
+}
+
+
+/***************************************************************************
+ * TRACE_NOW - Time since the trace start (us, monotonic clock).
+ ***************************************************************************/
+double trace_now() {
+    return chrono::duration<double, micro>(chrono::steady_clock::now()
+                                           - trace_t0).count();
+}
+
+
+/***************************************************************************
+ * TRACE_COMPLETE - This function records a complete event of the calling
+ * thread (nothing if tracing is off).
+ *
+ * Args:
+ * -----
+ *  name (string)   : Event's name.
+ *  ts (double)     : Start time (us, see TRACE_NOW).
+ *  dur (double)    : Duration (us).
+ *  detail (string) : Optional argument shown with the event.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void trace_complete(const string &name, double ts, double dur,
+                    const string &detail) {
+    if (!trace_enabled()) return;
+
+    trace_event e;
+    e.name = name;
+    e.detail = detail;
+    e.ph = 'X';
+    e.ts = ts;
+    e.dur = dur;
+    thread_buffer()->events.push_back(e);
+}
+
+
+/***************************************************************************
+ * TRACE_INSTANT - This function records an instant event of the calling
+ * thread (nothing if tracing is off).
+ *
+ * Args:
+ * -----
+ *  name (string)   : Event's name.
+ *  detail (string) : Optional argument shown with the event.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void trace_instant(const string &name, const string &detail) {
+    if (!trace_enabled()) return;
+
+    trace_event e;
+    e.name = name;
+    e.detail = detail;
+    e.ph = 'i';
+    e.ts = trace_now();
+    e.dur = 0.0;
+    thread_buffer()->events.push_back(e);
+}
+
+
+/***************************************************************************
+ * Starts tracing at load time if NSAT_TRACE names an output file.
+ ***************************************************************************/
+static struct trace_env_s {
+    trace_env_s() {
+        const char *path = getenv("NSAT_TRACE");
+        if (path != NULL && *path != '\0') trace_start(path);
+    }
+} trace_env;
@@ -0,0 +1,233 @@
+#include "trial_core.h"
+
+#include <chrono>
+
+using namespace std;
+
+
+/***************************************************************************
+ * TRIAL_CORE Class Implementation
+ ***************************************************************************/
+
+/***************************************************************************
+ * TRIAL_CORE Class Constructor.
+ *
+ * Args:
+ * -----
+ *  c (nsat_core *) : A pointer to a NSAT Core that has already gone 
+ *                    through c_config_state and c_setup_state.
+ *  dir (string)    : Output directory.
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+trial_core::trial_core(nsat_core *c, const string &dir) {
+    core = c;
+    out_dir = dir;
+}
+
+
+/***************************************************************************
+ * TRIAL_CORE LOAD_TRIALS - This method reads a trials file (see 
+ * trial_core.h for the format).
+ *
+ * Args:
+ * -----
+ *  fname (string) : Trials file name.
+ *
+ * Returns:
+ * --------
+ *  0 if succesfully reads the file, otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  9  : Mismatch of rates and number of input groups.
+ *  18 : Cannot open a configuration/sweep file.
+ ***************************************************************************/
+int trial_core::load_trials(const string &fname) {
+    int num_inputs = core->get_input_units().size();
+    string line;
+    ifstream infile(fname);
+
+    if (!infile) { throw 18; }
+
+    while (getline(infile, line)) {
+        istringstream iss(line);
+        vector<string> tokens{istream_iterator<string>{iss},
+                              istream_iterator<string>{}};
+
+        if (tokens.empty() || tokens[0][0] == '#') { continue; }
+        if (tokens.size() != 1 && tokens.size() != num_inputs + 1) {
+            throw 9;
+        }
+
+        vector<float> rates;
+        for (int i = 1; i < tokens.size(); ++i)
+            rates.push_back(stof(tokens[i]));
+        add_trial(stoi(tokens[0]), rates);
+    }
+    infile.close();
+    return 0;
+}
+
+
+/***************************************************************************
+ * TRIAL_CORE ADD_TRIAL - This method appends a trial.
+ *
+ * Args:
+ * -----
+ *  seed (int)            : Random seed of the trial.
+ *  rates (vector<float>) : Poisson rates, one per input group (empty to
+ *                          keep the rates of the SPKG file).
+ *
+ * Returns:
+ * --------
+ *  Void
+ ***************************************************************************/
+void trial_core::add_trial(int seed, const vector<float> &rates) {
+    trial t;
+    t.trial_id = trials.size();
+    t.seed = seed;
+    t.rates = rates;
+    trials.push_back(t);
+}
+
+
+/***************************************************************************
+ * TRIAL_CORE RUN_TRIAL - This method runs one trial in a child process:
+ * it reseeds the random numbers generator, sets the trial's input rates
+ * and output directory and runs the network.
+ *
+ * Args:
+ * -----
+ *  t (trial) : The trial.
+ *
+ * Returns:
+ * --------
+ *  0 if the trial has been succesfully simulated, otherwise the number of
+ *  the exception.
+ ***************************************************************************/
+int trial_core::run_trial(const trial &t) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "/trial_%04d", t.trial_id);
+
+    try {
+        {
+            lock_guard<mutex> lock(drand48_mutex);
+            srand48(t.seed);
+            srand(t.seed);
+        }
+
+        core->set_results_dir(out_dir + name);
+        for (int i = 0; i < t.rates.size(); ++i)
+            core->set_input_rate(i, t.rates[i]);
+
+        core->c_run_state();
+    }
+    catch (int &e) {
+        return core->error(e);
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * TRIAL_CORE RUN - This method forks one child per trial, keeping at most
+ * max_children of them alive. Every child sends back a trial_result 
+ * through its own pipe, whose write end the parent closes right after
+ * the fork. The parent reaps the children (waitpid) and then reads
+ * their results, so a child that dies before writing its result (crash,
+ * exit from CARLsim, OOM kill) is recorded as a failed trial (exception
+ * 31) instead of being waited for. At the end it reports the mean 
+ * startup time (fork to run state) and the trials throughput.
+ *
+ * Args:
+ * -----
+ *  max_children (int) : Maximum number of concurrent children.
+ *
+ * Returns:
+ * --------
+ *  The number of failed trials, otherwise it throws an exception.
+ *
+ * Exceptions:
+ * -----------
+ *  20 : Cannot create a worker process.
+ *  21 : Forked trials need CPU mode.
+ ***************************************************************************/
+int trial_core::run(int max_children) {
+    int failed = 0;
+    double startup = 0.0, total;
+    map<pid_t, pair<int, int>> children;    // pid -> (result fd, trial)
+
+    if (core->get_carlsim_params().mode != CPU_MODE) { throw 21; }
+    max_children = max(1, max_children);
+
+    make_dirs(out_dir);
+
+    // Reaps one child and records its result (or its failure)
+    auto reap = [&]() {
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid <= 0) return false;
+        auto it = children.find(pid);
+        if (it == children.end()) return true;
+
+        trial_result res;
+        int fd = it->second.first;
+        bool exited = WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+        if (read(fd, &res, sizeof(res)) != sizeof(res) || !exited) {
+            res.trial_id = trials[it->second.second].trial_id;
+            res.status = core->error(31);
+            res.startup = res.wall_time = 0.0;
+        }
+        close(fd);
+        children.erase(it);
+
+        results.push_back(res);
+        if (res.status != 0) failed++;
+        startup += res.startup;
+        return true;
+    };
+
+    results.clear();
+    auto t0 = chrono::steady_clock::now();
+    for (int k = 0; k < trials.size(); ++k) {
+        // Wait for a child if the limit is reached
+        while (children.size() >= max_children && reap()) {}
+
+        int fd[2];
+        if (pipe(fd) != 0) { throw 20; }
+        auto t_fork = chrono::steady_clock::now();
+        cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) { throw 20; }
+        if (pid == 0) {
+            trial_result res;
+            close(fd[0]);
+            for (auto &c : children) close(c.second.first);
+
+            res.trial_id = trials[k].trial_id;
+            res.startup = chrono::duration<double>(chrono::steady_clock::now()
+                                                   - t_fork).count();
+            res.status = run_trial(trials[k]);
+            res.wall_time = chrono::duration<double>(chrono::steady_clock::now()
+                                                     - t_fork).count();
+            cout.flush();
+            if (write(fd[1], &res, sizeof(res)) != sizeof(res)) _exit(1);
+            _exit(0);
+        }
+        close(fd[1]);
+        children[pid] = make_pair(fd[0], k);
+    }
+    while (!children.empty() && reap()) {}
+
+    total = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    cout << "Trials: " << results.size() << "/" << trials.size() << " ("
+         << failed << " failed) in " << total << " s, mean startup "
+         << 1000.0 * startup / max(1, (int) results.size()) << " ms, "
+         << results.size() / total << " trials/s" << endl;
+    return failed + (trials.size() - results.size());
+}
@@ -1,3 +1,17 @@
 #include "nsat_core.cpp"
 #include "connx_core.cpp"
 #include "auxiliary.cpp"
+#include "batch_core.cpp"
+#include "config_core.cpp"
+#include "sweep_core.cpp"
+#include "trial_core.cpp"
+#include "ckpt_core.cpp"
+#include "spkg_core.cpp"
+#include "rng_core.cpp"
+#include "schedule_core.cpp"
+#include "dist_core.cpp"
+#include "timer_core.cpp"
+#include "netgen_core.cpp"
+#include "trace_core.cpp"
+#include "memory_core.cpp"
+#include "capi.cpp"